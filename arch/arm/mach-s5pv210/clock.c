@@ -19,6 +19,7 @@
 #include <linux/clk.h>
 #include <linux/sysdev.h>
 #include <linux/io.h>
+#include <linux/amba/bus.h>
 
 #include <mach/map.h>
 
@@ -625,8 +626,14 @@ static struct clk init_clocks_off[] = {
 
 static struct clk init_dmaclocks[] = {
 	{
+#ifdef CONFIG_SAMSUNG_DMADEV
+		/* amba bus looks the bus clock of its devices up by this name */
+		.name		= "apb_pclk",
+		.id		= -1,
+#else
 		.name		= "pdma",
 		.id		= 0,
+#endif
 		.parent		= &clk_hclk_dsys.clk,
 		.enable		= s5pv210_clk_ip0_ctrl,
 		.ctrlbit	= (1 << 2),
@@ -21,6 +21,7 @@
 #include <linux/regulator/consumer.h>
 #include <linux/cpufreq.h>
 #include <linux/platform_device.h> 
+#include <linux/hrtimer.h>
 
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -97,6 +98,14 @@ struct s5pv210_dvs_conf {
 const unsigned long arm_volt_max = 1350000;
 const unsigned long int_volt_max = 1250000;
 
+/*
+ * Voltages last programmed.  Each regulator write is a PMIC transaction
+ * plus ramp time, so skip the ones that would not change anything: INT
+ * stays put between L0 and L3.
+ */
+static unsigned long cur_arm_volt;
+static unsigned long cur_int_volt;
+
 static struct s5pv210_dvs_conf dvs_conf[] = {
 	[L0] = {
 		.arm_volt   = 1250000,
@@ -176,6 +185,47 @@ static void s5pv210_set_refresh(enum s5pv210_dmc_port ch, unsigned long freq)
 	__raw_writel(tmp1, reg);
 }
 
+static int s5pv210_set_volt(struct regulator *regulator, unsigned long *cur,
+			    unsigned long volt, unsigned long volt_max)
+{
+	int ret;
+
+	if (*cur == volt)
+		return 0;
+
+	ret = regulator_set_voltage(regulator, volt, volt_max);
+	if (!ret)
+		*cur = volt;
+
+	return ret;
+}
+
+/* raise ARM first when going up, lower INT first when going down */
+static int s5pv210_scale_volt(unsigned int index, int up)
+{
+	int ret;
+
+	if (IS_ERR_OR_NULL(arm_regulator) ||
+			IS_ERR_OR_NULL(internal_regulator))
+		return 0;
+
+	if (up) {
+		ret = s5pv210_set_volt(arm_regulator, &cur_arm_volt,
+				       dvs_conf[index].arm_volt, arm_volt_max);
+		if (ret)
+			return ret;
+		return s5pv210_set_volt(internal_regulator, &cur_int_volt,
+					dvs_conf[index].int_volt, int_volt_max);
+	}
+
+	ret = s5pv210_set_volt(internal_regulator, &cur_int_volt,
+			       dvs_conf[index].int_volt, int_volt_max);
+	if (ret)
+		return ret;
+	return s5pv210_set_volt(arm_regulator, &cur_arm_volt,
+				dvs_conf[index].arm_volt, arm_volt_max);
+}
+
 int s5pv210_verify_speed(struct cpufreq_policy *policy)
 {
 	if (policy->cpu)
@@ -200,7 +250,9 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 	unsigned int index, priv_index;
 	unsigned int pll_changing = 0;
 	unsigned int bus_speed_changing = 0;
-	unsigned int arm_volt, int_volt;
+	unsigned int mcs_changing = 0;
+	ktime_t start;
+	s64 latency;
 	int ret = 0;
 
 	mutex_lock(&set_freq_lock);
@@ -240,34 +292,35 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 		goto out;
 	}
 
-	arm_volt = dvs_conf[index].arm_volt;
-	int_volt = dvs_conf[index].int_volt;
-
-	if (freqs.new > freqs.old) {
-		/* Voltage up code: increase ARM first */
-		if (!IS_ERR_OR_NULL(arm_regulator) &&
-				!IS_ERR_OR_NULL(internal_regulator)) {
-			ret = regulator_set_voltage(arm_regulator,
-						    arm_volt, arm_volt_max);
-			if (ret)
-				goto out;
-			ret = regulator_set_voltage(internal_regulator,
-						    int_volt, int_volt_max);
-			if (ret)
-				goto out;
-		}
-	}
-
-	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
-
-	/* Check if there need to change PLL */
+	/*
+	 * Plan the transition: only L0 runs APLL at 1GHz and only L4 slows
+	 * the memory bus, every other pair of levels is a divider-only
+	 * change with no PLL relock and no DRAM refresh reprogramming.
+	 */
 	if ((index == L0) || (priv_index == L0))
 		pll_changing = 1;
 
-	/* Check if there need to change System bus clock */
-	if ((index == L4) || (priv_index == L4))
+	if (clkdiv_val[index][8] != clkdiv_val[priv_index][8])
 		bus_speed_changing = 1;
 
+	if ((index >= L3) != (priv_index >= L3))
+		mcs_changing = 1;
+
+	/*
+	 * Voltage steps are made inside the PRECHANGE/POSTCHANGE window so
+	 * that cpufreq_stats accounts for the whole transition.
+	 */
+	start = ktime_get();
+	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+
+	if (freqs.new > freqs.old) {
+		ret = s5pv210_scale_volt(index, 1);
+		if (ret) {
+			freqs.new = freqs.old;
+			goto post;
+		}
+	}
+
 	if (bus_speed_changing) {
 		/*
 		 * Reconfigure DRAM refresh counter value for minimum
@@ -362,14 +415,16 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 	} while (reg & 0xff);
 
 	/* ARM MCS value changed */
-	reg = __raw_readl(S5P_ARM_MCS_CON);
-	reg &= ~0x3;
-	if (index >= L3)
-		reg |= 0x3;
-	else
-		reg |= 0x1;
+	if (mcs_changing) {
+		reg = __raw_readl(S5P_ARM_MCS_CON);
+		reg &= ~0x3;
+		if (index >= L3)
+			reg |= 0x3;
+		else
+			reg |= 0x1;
 
-	__raw_writel(reg, S5P_ARM_MCS_CON);
+		__raw_writel(reg, S5P_ARM_MCS_CON);
+	}
 
 	if (pll_changing) {
 		/* 5. Set Lock time = 30us*24Mhz = 0x2cf */
@@ -470,20 +525,21 @@ static int s5pv210_target(struct cpufreq_policy *policy,
 		}
 	}
 
+	if (freqs.new < freqs.old)
+		s5pv210_scale_volt(index, 0);
+
+post:
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
-	if (freqs.new < freqs.old) {
-		/* Voltage down: decrease INT first */
-		if (!IS_ERR_OR_NULL(arm_regulator) &&
-				!IS_ERR_OR_NULL(internal_regulator)) {
-			regulator_set_voltage(internal_regulator,
-					int_volt, int_volt_max);
-			regulator_set_voltage(arm_regulator,
-					arm_volt, arm_volt_max);
-		}
-	}
+	/*
+	 * Keep transition_latency as a running average of what transitions
+	 * really cost, governors use it to weigh how often to switch.
+	 */
+	latency = ktime_to_ns(ktime_sub(ktime_get(), start));
+	policy->cpuinfo.transition_latency =
+		(policy->cpuinfo.transition_latency * 7 + (u32)latency) / 8;
 
-	printk(KERN_DEBUG "Perf changed[L%d]\n", index);
+	pr_debug("Perf changed[L%d] in %lldns\n", index, latency);
 out:
 	mutex_unlock(&set_freq_lock);
 	return ret;
@@ -646,6 +702,8 @@ static int __init s5pv210_cpufreq_probe(struct platform_device *pdev)
 		pr_err("failed to get regulater resource vddint\n");
 		goto error;
 	}
+	cur_arm_volt = regulator_get_voltage(arm_regulator);
+	cur_int_volt = regulator_get_voltage(internal_regulator);
 	goto finish;
 error:
 	pr_warn("Cannot get vddarm or vddint. CPUFREQ Will not"
@@ -16,6 +16,9 @@
 #include <linux/cpuidle.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/tick.h>
+#include <linux/hrtimer.h>
+#include <linux/bitops.h>
 #include <asm/proc-fns.h>
 #include <asm/cacheflush.h>
 
@@ -39,6 +42,33 @@ static dma_addr_t phy_regs_save;
 
 #define MAX_CHK_DEV	0xf
 
+/*
+ * Wakeup prediction for didle.  The next timer event bounds the idle
+ * period from above; interrupts that woke the CPU before it are tracked
+ * per line, and a line firing at a steady interval predicts the next
+ * early wakeup.  didle is skipped when the predicted idle period does
+ * not cover its entry and exit cost.
+ */
+#define S5P_IDLE_NR_IRQS	128
+#define S5P_IDLE_TIMER_SLACK_US	50
+#define S5P_IDLE_MAX_EXIT_US	2000
+
+struct s5p_wake_hist {
+	ktime_t		last;
+	unsigned int	interval;	/* us, running average */
+	unsigned int	deviation;	/* us, running mean deviation */
+};
+
+static struct s5p_wake_hist wake_hist[S5P_IDLE_NR_IRQS];
+static DECLARE_BITMAP(wake_tracked, S5P_IDLE_NR_IRQS);
+
+/* measured per state, us */
+static unsigned int idle_entry_us[2];
+static unsigned int idle_exit_us[2];
+
+static ktime_t idle_timer_expiry;
+static ktime_t didle_entered;
+
 /*
  * Specific device list for checking before entering
  * didle mode
@@ -162,32 +192,9 @@ static int check_power_clock_gating(void)
 /*
  * Skipping enter the didle mode when RTC & I2S interrupts be issued
  * during critical section of entering didle mode (around 20ms).
+ * The I2S side is checked by the IDMA driver, which knows where its
+ * next level interrupt is.
  */
-#ifdef CONFIG_S5P_INTERNAL_DMA
-static int check_idmapos(void)
-{
-	dma_addr_t src;
-
-	i2sdma_getpos(&src);
-
-	if (src == 0xC0000000)
-		return 1;
-
-#if 0
-	src = src & 0x3FFF; 
-	src = 0x4000 - src;		// 16KB
-
-	src = src & 0xFFFF;		// 64KB
-	src = 0x10000 - src;
-#endif
-
-	src = src & 0x1FFFF;	//128kb
-	src = 0x20000 - src;
-
-	return src < 0x150;
-}
-#endif
-
 #ifndef CONFIG_S5P_HIGH_RES_TIMERS
 #include <plat/regs-rtc.h>
 static unsigned int get_rtc_cnt(void)
@@ -254,21 +261,123 @@ static void s5p_enter_idle(void)
 	cpu_do_idle();
 }
 
+/* Lowest pending VIC line, i.e. the interrupt that ended the idle period */
+static int s5p_idle_wake_irq(void)
+{
+	unsigned long status[4];
+	int i;
+
+	status[0] = __raw_readl(S5P_VIC0REG(VIC_IRQ_STATUS));
+	status[1] = __raw_readl(S5P_VIC1REG(VIC_IRQ_STATUS));
+	status[2] = __raw_readl(S5P_VIC2REG(VIC_IRQ_STATUS));
+	status[3] = __raw_readl(S5P_VIC3REG(VIC_IRQ_STATUS));
+
+	for (i = 0; i < 4; i++)
+		if (status[i])
+			return i * 32 + __ffs(status[i]);
+
+	return -1;
+}
+
+static void s5p_idle_record_irq(int irq, ktime_t now)
+{
+	struct s5p_wake_hist *h = &wake_hist[irq];
+	s64 delta;
+	unsigned int err;
+
+	delta = ktime_us_delta(now, h->last);
+	h->last = now;
+
+	if (!test_and_set_bit(irq, wake_tracked) || delta > USEC_PER_SEC) {
+		h->interval = 0;
+		return;
+	}
+
+	if (!h->interval) {
+		h->interval = delta;
+		h->deviation = delta / 2;
+		return;
+	}
+
+	err = abs((int)delta - (int)h->interval);
+	h->interval = (h->interval * 7 + (unsigned int)delta) / 8;
+	h->deviation = (h->deviation * 3 + err) / 4;
+}
+
+/* us until the earliest regular interrupt is expected, or -1 */
+static s64 s5p_idle_predict_irq(ktime_t now)
+{
+	struct s5p_wake_hist *h;
+	s64 next, since, predicted = -1;
+	int irq;
+
+	for_each_set_bit(irq, wake_tracked, S5P_IDLE_NR_IRQS) {
+		h = &wake_hist[irq];
+
+		/* only lines that fire regularly predict anything */
+		if (!h->interval || h->deviation > h->interval / 2)
+			continue;
+
+		since = ktime_us_delta(now, h->last);
+		if (since > 2 * h->interval) {
+			/* overdue, the pattern has stopped */
+			clear_bit(irq, wake_tracked);
+			continue;
+		}
+
+		next = h->interval > since ? h->interval - since : 0;
+		if (predicted < 0 || next < predicted)
+			predicted = next;
+	}
+
+	return predicted;
+}
+
+/*
+ * Account an idle period.  A wakeup at the timer expiry measures the exit
+ * latency of the state, an earlier one is attributed to the interrupt
+ * pending in the VIC.
+ */
+static int s5p_idle_account(struct cpuidle_device *dev, int index,
+			    ktime_t before, ktime_t after)
+{
+	s64 late = ktime_us_delta(after, idle_timer_expiry);
+	int irq;
+
+	if (late >= -S5P_IDLE_TIMER_SLACK_US) {
+		if (late < 0)
+			late = 0;
+		if (late < S5P_IDLE_MAX_EXIT_US) {
+			idle_exit_us[index] = (idle_exit_us[index] * 3 +
+					       late) / 4;
+			dev->states[index].exit_latency =
+				max(idle_exit_us[index], 1U);
+		}
+	} else {
+		irq = s5p_idle_wake_irq();
+		if (irq >= 0)
+			s5p_idle_record_irq(irq, after);
+	}
+
+	return ktime_us_delta(after, before);
+}
+
 /* Actual code that puts the SoC in different idle states */
 static int s5p_enter_idle_state(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	struct timeval before, after;
+	ktime_t before, after;
 	int idle_time;
+
 	local_irq_disable();
-	do_gettimeofday(&before);
+	before = ktime_get();
 
 	s5p_enter_idle();
 
-	do_gettimeofday(&after);
+	after = ktime_get();
+	idle_time = s5p_idle_account(dev, 0, before, after);
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-			(after.tv_usec - before.tv_usec);
+
 	return idle_time;
 }
 
@@ -348,6 +457,7 @@ static void s5p_enter_didle(void)
 	 * we resume as it saves its own register state and restore it
 	 * during the resume.
 	 */
+	didle_entered = ktime_get();
 	s5pv210_didle_save(regs_save);
 
 	/* restore the cpu state using the kernel's cpu init code. */
@@ -388,7 +498,7 @@ static int s5p_idle_bm_check(void)
 		return 1;
 	}
 #ifdef CONFIG_S5P_INTERNAL_DMA
-	else if (check_idmapos()) {
+	else if (s5p_idma_didle_check()) {
 		return 1;
 	}
 #endif
@@ -400,29 +510,67 @@ static int s5p_idle_bm_check(void)
 static int s5p_enter_didle_state(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	struct timeval before, after;
+	ktime_t before, after;
 	int idle_time;
 
 	local_irq_disable();
-	do_gettimeofday(&before);
+	before = ktime_get();
+	didle_entered.tv64 = 0;
 
 	s5p_enter_didle();
-	do_gettimeofday(&after);
+
+	after = ktime_get();
+	if (didle_entered.tv64)
+		idle_entry_us[1] = (idle_entry_us[1] * 3 +
+			ktime_us_delta(didle_entered, before)) / 4;
+	idle_time = s5p_idle_account(dev, 1, before, after);
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-			(after.tv_usec - before.tv_usec);
+
 	return idle_time;
 }
 
+/*
+ * didle is only possible while no bus master is active and worth it only
+ * when the CPU is expected to stay idle long enough; otherwise fall back
+ * to WFI and account the time to that state instead.  ->prepare has
+ * already decided, this covers governors that ignore the flag.
+ */
 static int s5p_enter_idle_bm(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	if (s5p_idle_bm_check())
-		return s5p_enter_idle_state(dev, state);
-	else
+	if (state->flags & CPUIDLE_FLAG_IGNORE) {
+		dev->last_state = &dev->states[0];
+		return s5p_enter_idle_state(dev, &dev->states[0]);
+	} else
 		return s5p_enter_didle_state(dev, state);
 }
 
+static int s5p_idle_prepare(struct cpuidle_device *dev)
+{
+	struct cpuidle_state *didle = &dev->states[1];
+	ktime_t now = ktime_get();
+	ktime_t sleep = tick_nohz_get_sleep_length();
+	s64 predicted, irq_predicted;
+	unsigned int break_even;
+
+	idle_timer_expiry = ktime_add(now, sleep);
+	predicted = ktime_to_us(sleep);
+
+	irq_predicted = s5p_idle_predict_irq(now);
+	if (irq_predicted >= 0 && irq_predicted < predicted)
+		predicted = irq_predicted;
+
+	break_even = max(didle->target_residency,
+			 idle_entry_us[1] + idle_exit_us[1]);
+
+	if (predicted < break_even || s5p_idle_bm_check())
+		didle->flags |= CPUIDLE_FLAG_IGNORE;
+	else
+		didle->flags &= ~CPUIDLE_FLAG_IGNORE;
+
+	return 0;
+}
+
 static DEFINE_PER_CPU(struct cpuidle_device, s5p_cpuidle_device);
 
 static struct cpuidle_driver s5p_idle_driver = {
@@ -446,16 +594,25 @@ static int s5p_init_cpuidle(void)
 	}
 
 	device = &per_cpu(s5p_cpuidle_device, smp_processor_id());
-	device->state_count = 1;
+	device->state_count = 2;
+	device->prepare = s5p_idle_prepare;
 
 	/* Wait for interrupt state */
-	device->states[0].enter = s5p_enter_idle_bm;
+	device->states[0].enter = s5p_enter_idle_state;
 	device->states[0].exit_latency = 1;	/* uS */
-	device->states[0].target_residency = 10000;
+	device->states[0].target_residency = 1;
 	device->states[0].flags = CPUIDLE_FLAG_TIME_VALID;
 	strcpy(device->states[0].name, "IDLE");
 	strcpy(device->states[0].desc, "ARM clock gating - WFI");
 
+	/* Deep idle, TOP block retained, left on I2S or RTC tick */
+	device->states[1].enter = s5p_enter_idle_bm;
+	device->states[1].exit_latency = 300;	/* uS */
+	device->states[1].target_residency = 10000;
+	device->states[1].flags = CPUIDLE_FLAG_TIME_VALID;
+	strcpy(device->states[1].name, "DIDLE");
+	strcpy(device->states[1].desc, "ARM power gating - didle");
+
 	ret = cpuidle_register_device(device);
 	if (ret) {
 		printk(KERN_ERR "%s: Failed registering device\n", __func__);
@@ -19,6 +19,8 @@
 
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
+#include <linux/amba/bus.h>
+#include <linux/amba/pl330.h>
 
 #include <plat/devs.h>
 #include <plat/irqs.h>
@@ -30,10 +32,48 @@
 
 static u64 dma_dmamask = DMA_BIT_MASK(32);
 
+#ifdef CONFIG_SAMSUNG_DMADEV
+/*
+ * The memory to memory DMAC is handed to the dmaengine driver, where its
+ * channels serve async_tx memcpy and any dma_request_channel() client.
+ * The peripheral DMACs stay with the S3C DMA API used by their clients.
+ */
+static struct dma_pl330_peri s5pv210_mdma_peri[] = {
+	{ .peri_id = 0, .rqtype = MEMTOMEM, },
+	{ .peri_id = 1, .rqtype = MEMTOMEM, },
+	{ .peri_id = 2, .rqtype = MEMTOMEM, },
+	{ .peri_id = 3, .rqtype = MEMTOMEM, },
+	{ .peri_id = 4, .rqtype = MEMTOMEM, },
+	{ .peri_id = 5, .rqtype = MEMTOMEM, },
+	{ .peri_id = 6, .rqtype = MEMTOMEM, },
+	{ .peri_id = 7, .rqtype = MEMTOMEM, },
+};
+
+static struct dma_pl330_platdata s5pv210_mdma_pdata = {
+	.nr_valid_peri	= ARRAY_SIZE(s5pv210_mdma_peri),
+	.peri		= s5pv210_mdma_peri,
+};
+
+struct amba_device s5pv210_device_mdma = {
+	.dev		= {
+		.init_name = "dma-pl330.0",
+		.dma_mask = &dma_dmamask,
+		.coherent_dma_mask = DMA_BIT_MASK(32),
+		.platform_data = &s5pv210_mdma_pdata,
+	},
+	.res		= {
+		.start	= S5PV210_PA_MDMA,
+		.end	= S5PV210_PA_MDMA + SZ_4K - 1,
+		.flags	= IORESOURCE_MEM,
+	},
+	.irq		= { IRQ_MDMA, NO_IRQ },
+	.periphid	= 0x00041330,
+};
+#else
 static struct resource s5pv210_mdma_resource[] = {
 	[0] = {
 		.start  = S5PV210_PA_MDMA,
-		.end    = S5PV210_PA_MDMA + SZ_4K,
+		.end    = S5PV210_PA_MDMA + SZ_4K - 1,
 		.flags	= IORESOURCE_MEM,
 	},
 	[1] = {
@@ -94,6 +134,7 @@ struct platform_device s5pv210_device_mdma = {
 		.platform_data = &s5pv210_mdma_pdata,
 	},
 };
+#endif
 
 static struct resource s5pv210_pdma0_resource[] = {
 	[0] = {
@@ -220,7 +261,9 @@ struct platform_device s5pv210_device_pdma1 = {
 };
 
 static struct platform_device *s5pv210_dmacs[] __initdata = {
+#ifndef CONFIG_SAMSUNG_DMADEV
 	&s5pv210_device_mdma,
+#endif
 	&s5pv210_device_pdma0,
 	&s5pv210_device_pdma1,
 };
@@ -229,6 +272,10 @@ static int __init s5pv210_dma_init(void)
 {
 	platform_add_devices(s5pv210_dmacs, ARRAY_SIZE(s5pv210_dmacs));
 
+#ifdef CONFIG_SAMSUNG_DMADEV
+	amba_device_register(&s5pv210_device_mdma, &iomem_resource);
+#endif
+
 	return 0;
 }
 arch_initcall(s5pv210_dma_init);
@@ -15,7 +15,7 @@
 
 extern int  s5pv210_didle_save(unsigned long *saveblk);
 extern void s5pv210_didle_resume(void);
-extern void i2sdma_getpos(dma_addr_t *src);
+extern int  s5p_idma_didle_check(void);
 
 #ifdef CONFIG_S5P_HIGH_RES_TIMERS
 extern unsigned int get_rtc_cnt(void);
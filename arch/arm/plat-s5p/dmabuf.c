@@ -0,0 +1,358 @@
+/* linux/arch/arm/plat-s5p/dmabuf.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Shared buffer helpers for Samsung media devices
+ *
+ * The media devices (FIMC, MFC, JPEG, G2D and FIMD) work on physically
+ * contiguous regions carved out by s5p_reserve_bootmem(). This exports
+ * such a region as a dma-buf file descriptor so that it can be handed from
+ * one driver to another without copying, and imports it back again.
+ *
+ * The reserved regions are removed from the kernel linear mapping, so cache
+ * maintenance for cacheable user mappings is done on the whole cache and
+ * tracked per buffer: the CPU side is cleaned only when it may have been
+ * written and invalidated only when a device may have written to it.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/fcntl.h>
+#include <linux/spinlock.h>
+#include <linux/scatterlist.h>
+#include <linux/dma-buf.h>
+#include <asm/cacheflush.h>
+#include <asm/outercache.h>
+#include <plat/dmabuf.h>
+
+/*
+ * struct s5p_dmabuf
+ * @paddr:		physical start address
+ * @size:		length of the region
+ * @flags:		S5P_DMABUF_* flags given at export time
+ * @release:		tells the owner that the memory is no longer used
+ * @release_priv:	argument of @release
+ * @lock:		protects the coherency state below
+ * @cpu_mappings:	number of live cacheable user mappings
+ * @cpu_dirty:		CPU caches may hold data not yet seen by devices
+ * @dev_dirty:		a device may have written data stale in CPU caches
+*/
+struct s5p_dmabuf {
+	dma_addr_t	paddr;
+	size_t		size;
+	unsigned int	flags;
+	s5p_dmabuf_release_t release;
+	void		*release_priv;
+	spinlock_t	lock;
+	int		cpu_mappings;
+	int		cpu_dirty;
+	int		dev_dirty;
+};
+
+static void s5p_dmabuf_sync_for_device(struct s5p_dmabuf *buf,
+				       enum dma_data_direction dir)
+{
+	unsigned long flags;
+	int clean;
+
+	if (!(buf->flags & S5P_DMABUF_CACHED))
+		return;
+
+	spin_lock_irqsave(&buf->lock, flags);
+	clean = buf->cpu_dirty || buf->cpu_mappings;
+	buf->cpu_dirty = 0;
+	if (dir != DMA_TO_DEVICE)
+		buf->dev_dirty = 1;
+	spin_unlock_irqrestore(&buf->lock, flags);
+
+	if (clean) {
+		flush_cache_all();
+		outer_flush_range(buf->paddr, buf->paddr + buf->size);
+	}
+}
+
+static void s5p_dmabuf_sync_for_cpu(struct s5p_dmabuf *buf,
+				    size_t start, size_t len)
+{
+	unsigned long flags;
+	int inval;
+
+	if (!(buf->flags & S5P_DMABUF_CACHED))
+		return;
+
+	spin_lock_irqsave(&buf->lock, flags);
+	inval = buf->dev_dirty;
+	buf->dev_dirty = 0;
+	spin_unlock_irqrestore(&buf->lock, flags);
+
+	if (inval) {
+		outer_inv_range(buf->paddr + start, buf->paddr + start + len);
+		flush_cache_all();
+	}
+}
+
+static struct sg_table *s5p_dmabuf_map(struct dma_buf_attachment *attach,
+				       enum dma_data_direction dir)
+{
+	struct s5p_dmabuf *buf = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	int ret;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	ret = sg_alloc_table(sgt, 1, GFP_KERNEL);
+	if (ret) {
+		kfree(sgt);
+		return ERR_PTR(ret);
+	}
+
+	/*
+	 * The region has no struct page behind it, so importers must only
+	 * use the dma address and length of the single entry.
+	 */
+	sg_dma_address(sgt->sgl) = buf->paddr;
+	sg_dma_len(sgt->sgl) = buf->size;
+
+	s5p_dmabuf_sync_for_device(buf, dir);
+
+	return sgt;
+}
+
+static void s5p_dmabuf_unmap(struct dma_buf_attachment *attach,
+			     struct sg_table *sgt,
+			     enum dma_data_direction dir)
+{
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void s5p_dmabuf_free(struct dma_buf *dmabuf)
+{
+	struct s5p_dmabuf *buf = dmabuf->priv;
+
+	if (buf->release)
+		buf->release(buf->release_priv);
+	kfree(buf);
+}
+
+static int s5p_dmabuf_begin_cpu_access(struct dma_buf *dmabuf, size_t start,
+				       size_t len, enum dma_data_direction dir)
+{
+	struct s5p_dmabuf *buf = dmabuf->priv;
+
+	if (start + len > buf->size)
+		return -EINVAL;
+
+	s5p_dmabuf_sync_for_cpu(buf, start, len);
+
+	return 0;
+}
+
+static void s5p_dmabuf_end_cpu_access(struct dma_buf *dmabuf, size_t start,
+				      size_t len, enum dma_data_direction dir)
+{
+	struct s5p_dmabuf *buf = dmabuf->priv;
+	unsigned long flags;
+
+	if (dir == DMA_FROM_DEVICE)
+		return;
+
+	spin_lock_irqsave(&buf->lock, flags);
+	buf->cpu_dirty = 1;
+	spin_unlock_irqrestore(&buf->lock, flags);
+}
+
+static void s5p_dmabuf_vm_open(struct vm_area_struct *vma)
+{
+	struct s5p_dmabuf *buf = vma->vm_private_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->lock, flags);
+	buf->cpu_mappings++;
+	spin_unlock_irqrestore(&buf->lock, flags);
+}
+
+static void s5p_dmabuf_vm_close(struct vm_area_struct *vma)
+{
+	struct s5p_dmabuf *buf = vma->vm_private_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&buf->lock, flags);
+	buf->cpu_mappings--;
+	buf->cpu_dirty = 1;
+	spin_unlock_irqrestore(&buf->lock, flags);
+}
+
+static const struct vm_operations_struct s5p_dmabuf_vm_ops = {
+	.open	= s5p_dmabuf_vm_open,
+	.close	= s5p_dmabuf_vm_close,
+};
+
+static int s5p_dmabuf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct s5p_dmabuf *buf = dmabuf->priv;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long pfn;
+
+	if ((vma->vm_pgoff << PAGE_SHIFT) + size > PAGE_ALIGN(buf->size))
+		return -EINVAL;
+
+	vma->vm_flags |= VM_RESERVED | VM_IO;
+	if (!(buf->flags & S5P_DMABUF_CACHED))
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	pfn = __phys_to_pfn(buf->paddr) + vma->vm_pgoff;
+	if (remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot))
+		return -EAGAIN;
+
+	if (buf->flags & S5P_DMABUF_CACHED) {
+		vma->vm_ops = &s5p_dmabuf_vm_ops;
+		vma->vm_private_data = buf;
+		s5p_dmabuf_vm_open(vma);
+	}
+
+	return 0;
+}
+
+static const struct dma_buf_ops s5p_dmabuf_ops = {
+	.map_dma_buf		= s5p_dmabuf_map,
+	.unmap_dma_buf		= s5p_dmabuf_unmap,
+	.release		= s5p_dmabuf_free,
+	.begin_cpu_access	= s5p_dmabuf_begin_cpu_access,
+	.end_cpu_access		= s5p_dmabuf_end_cpu_access,
+	.mmap			= s5p_dmabuf_mmap,
+};
+
+/*
+ * The memory must stay allocated until @release is called, which is also
+ * done when the export fails.  Owners that never free the region pass NULL.
+ */
+struct dma_buf *s5p_dmabuf_export(dma_addr_t paddr, size_t size,
+				  unsigned int flags,
+				  s5p_dmabuf_release_t release, void *priv)
+{
+	struct s5p_dmabuf *buf;
+	struct dma_buf *dmabuf;
+
+	if (!paddr || !size) {
+		dmabuf = ERR_PTR(-EINVAL);
+		goto err;
+	}
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf) {
+		dmabuf = ERR_PTR(-ENOMEM);
+		goto err;
+	}
+
+	buf->paddr = paddr;
+	buf->size = size;
+	buf->flags = flags;
+	buf->release = release;
+	buf->release_priv = priv;
+	spin_lock_init(&buf->lock);
+
+	dmabuf = dma_buf_export(buf, &s5p_dmabuf_ops, size, O_RDWR);
+	if (IS_ERR(dmabuf)) {
+		kfree(buf);
+		goto err;
+	}
+
+	return dmabuf;
+
+err:
+	if (release)
+		release(priv);
+	return dmabuf;
+}
+EXPORT_SYMBOL(s5p_dmabuf_export);
+
+int s5p_dmabuf_export_fd(dma_addr_t paddr, size_t size, unsigned int flags,
+			 s5p_dmabuf_release_t release, void *priv)
+{
+	struct dma_buf *dmabuf;
+	int fd;
+
+	dmabuf = s5p_dmabuf_export(paddr, size, flags, release, priv);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	fd = dma_buf_fd(dmabuf, O_CLOEXEC);
+	if (fd < 0)
+		dma_buf_put(dmabuf);
+
+	return fd;
+}
+EXPORT_SYMBOL(s5p_dmabuf_export_fd);
+
+int s5p_dmabuf_import(int fd, struct device *dev, enum dma_data_direction dir,
+		      struct s5p_dmabuf_import *imp)
+{
+	struct scatterlist *sg;
+	int ret;
+
+	memset(imp, 0, sizeof(*imp));
+
+	imp->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(imp->dmabuf)) {
+		ret = PTR_ERR(imp->dmabuf);
+		goto err_get;
+	}
+
+	imp->attach = dma_buf_attach(imp->dmabuf, dev);
+	if (IS_ERR(imp->attach)) {
+		ret = PTR_ERR(imp->attach);
+		goto err_attach;
+	}
+
+	imp->sgt = dma_buf_map_attachment(imp->attach, dir);
+	if (IS_ERR(imp->sgt)) {
+		ret = PTR_ERR(imp->sgt);
+		goto err_map;
+	}
+
+	/* the media devices have no IOMMU, only contiguous buffers are usable */
+	if (imp->sgt->nents != 1) {
+		ret = -EINVAL;
+		goto err_contig;
+	}
+
+	sg = imp->sgt->sgl;
+	imp->paddr = sg_dma_address(sg);
+	imp->size = sg_dma_len(sg);
+	imp->dir = dir;
+
+	return 0;
+
+err_contig:
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, dir);
+err_map:
+	dma_buf_detach(imp->dmabuf, imp->attach);
+err_attach:
+	dma_buf_put(imp->dmabuf);
+err_get:
+	memset(imp, 0, sizeof(*imp));
+	return ret;
+}
+EXPORT_SYMBOL(s5p_dmabuf_import);
+
+void s5p_dmabuf_release(struct s5p_dmabuf_import *imp)
+{
+	if (!imp->dmabuf)
+		return;
+
+	dma_buf_unmap_attachment(imp->attach, imp->sgt, imp->dir);
+	dma_buf_detach(imp->dmabuf, imp->attach);
+	dma_buf_put(imp->dmabuf);
+	memset(imp, 0, sizeof(*imp));
+}
+EXPORT_SYMBOL(s5p_dmabuf_release);
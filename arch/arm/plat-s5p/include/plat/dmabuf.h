@@ -0,0 +1,92 @@
+/* linux/arch/arm/plat-s5p/include/plat/dmabuf.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Shared buffer helpers for Samsung media devices
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef _S5P_DMABUF_H
+#define _S5P_DMABUF_H
+
+#include <linux/types.h>
+#include <linux/err.h>
+#include <linux/dma-buf.h>
+
+/* s5p_dmabuf_export() flags */
+#define S5P_DMABUF_CACHED	(1 << 0)	/* mmap with cacheable attribute */
+
+/*
+ * struct s5p_dmabuf_import
+ * @dmabuf:		buffer taken from the file descriptor
+ * @attach:		attachment of the importing device
+ * @sgt:		scatter table mapped for the importing device
+ * @dir:		direction the buffer was mapped with
+ * @paddr:		physical start address of the buffer
+ * @size:		length of the buffer
+*/
+struct s5p_dmabuf_import {
+	struct dma_buf			*dmabuf;
+	struct dma_buf_attachment	*attach;
+	struct sg_table			*sgt;
+	enum dma_data_direction		dir;
+	dma_addr_t			paddr;
+	size_t				size;
+};
+
+/*
+ * Called once the last reference to an exported buffer is gone, or when
+ * the export fails, so that the owner can free or reuse the memory.
+ */
+typedef void (*s5p_dmabuf_release_t)(void *priv);
+
+#ifdef CONFIG_S5P_DMABUF
+extern struct dma_buf *s5p_dmabuf_export(dma_addr_t paddr, size_t size,
+					 unsigned int flags,
+					 s5p_dmabuf_release_t release,
+					 void *priv);
+extern int s5p_dmabuf_export_fd(dma_addr_t paddr, size_t size,
+				unsigned int flags,
+				s5p_dmabuf_release_t release, void *priv);
+extern int s5p_dmabuf_import(int fd, struct device *dev,
+			     enum dma_data_direction dir,
+			     struct s5p_dmabuf_import *imp);
+extern void s5p_dmabuf_release(struct s5p_dmabuf_import *imp);
+#else
+static inline struct dma_buf *s5p_dmabuf_export(dma_addr_t paddr, size_t size,
+						unsigned int flags,
+						s5p_dmabuf_release_t release,
+						void *priv)
+{
+	if (release)
+		release(priv);
+	return ERR_PTR(-ENODEV);
+}
+
+static inline int s5p_dmabuf_export_fd(dma_addr_t paddr, size_t size,
+				       unsigned int flags,
+				       s5p_dmabuf_release_t release,
+				       void *priv)
+{
+	if (release)
+		release(priv);
+	return -ENODEV;
+}
+
+static inline int s5p_dmabuf_import(int fd, struct device *dev,
+				    enum dma_data_direction dir,
+				    struct s5p_dmabuf_import *imp)
+{
+	return -ENODEV;
+}
+
+static inline void s5p_dmabuf_release(struct s5p_dmabuf_import *imp)
+{
+}
+#endif
+
+#endif /* _S5P_DMABUF_H */
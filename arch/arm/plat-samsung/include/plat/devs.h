@@ -155,7 +155,11 @@ extern struct platform_device exynos4_device_sysmmu;
 
 extern struct platform_device s5pv210_device_pdma0;
 extern struct platform_device s5pv210_device_pdma1;
+#ifdef CONFIG_SAMSUNG_DMADEV
+extern struct amba_device s5pv210_device_mdma;
+#else
 extern struct platform_device s5pv210_device_mdma;
+#endif
 extern struct platform_device s3c_device_fimc0;
 extern struct platform_device s3c_device_fimc1;
 extern struct platform_device s3c_device_fimc2;
@@ -252,6 +252,8 @@
 /* DEPTSIZ common bit */
 #define DEPTSIZ_PKT_CNT_BIT		(19)
 #define DEPTSIZ_XFER_SIZE_BIT		(0)
+#define DEPTSIZ_PKT_CNT_MAX		(0x3ff)
+#define DEPTSIZ_XFER_SIZE_MAX		(0x7ffff)
 
 #define	DEPTSIZ_SETUP_PKCNT_1		(1<<29)
 #define	DEPTSIZ_SETUP_PKCNT_2		(2<<29)
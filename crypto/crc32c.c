@@ -129,12 +129,50 @@ static const u32 crc32c_table[256] = {
 };
 
 /*
- * Steps through buffer one byte at at time, calculates reflected
- * crc using table.
+ * Tables for processing eight bytes at a time ("slicing-by-8"):
+ * crc32c_table8[n][i] is the crc of byte i followed by n + 1 zero bytes,
+ * generated from crc32c_table at init time.
+ */
+static u32 crc32c_table8[7][256] __read_mostly;
+
+static void __init crc32c_init_tables(void)
+{
+	const u32 *prev = crc32c_table;
+	int n, i;
+
+	for (n = 0; n < 7; n++) {
+		for (i = 0; i < 256; i++)
+			crc32c_table8[n][i] = (prev[i] >> 8) ^
+					      crc32c_table[prev[i] & 0xff];
+		prev = crc32c_table8[n];
+	}
+}
+
+/*
+ * Steps through the aligned middle of the buffer eight bytes at a time
+ * and the unaligned head and tail one byte at a time, calculates
+ * reflected crc using the tables.
  */
 
 static u32 crc32c(u32 crc, const u8 *data, unsigned int length)
 {
+	const u32 (*t)[256] = crc32c_table8;
+	u32 lo, hi;
+
+	while (length && ((unsigned long)data & 3)) {
+		crc = crc32c_table[(crc ^ *data++) & 0xFFL] ^ (crc >> 8);
+		length--;
+	}
+
+	for (; length >= 8; length -= 8, data += 8) {
+		lo = crc ^ le32_to_cpup((const __le32 *)data);
+		hi = le32_to_cpup((const __le32 *)(data + 4));
+		crc = t[6][lo & 0xff] ^ t[5][(lo >> 8) & 0xff] ^
+		      t[4][(lo >> 16) & 0xff] ^ t[3][lo >> 24] ^
+		      t[2][hi & 0xff] ^ t[1][(hi >> 8) & 0xff] ^
+		      t[0][(hi >> 16) & 0xff] ^ crc32c_table[hi >> 24];
+	}
+
 	while (length--)
 		crc = crc32c_table[(crc ^ *data++) & 0xFFL] ^ (crc >> 8);
 
@@ -244,6 +282,8 @@ static struct shash_alg alg = {
 
 static int __init crc32c_mod_init(void)
 {
+	crc32c_init_tables();
+
 	return crypto_register_shash(&alg);
 }
 
@@ -27,11 +27,16 @@
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/mutex.h>
+#include <linux/input.h>
+#include <linux/slab.h>
 
 #include <asm/cputime.h>
 
 static atomic_t active_count = ATOMIC_INIT(0);
 
+/* Most recent short-term load samples kept per CPU */
+#define LOAD_HIST_MAX 8
+
 struct cpufreq_interactive_cpuinfo {
 	struct timer_list cpu_timer;
 	int timer_idlecancel;
@@ -45,6 +50,13 @@ struct cpufreq_interactive_cpuinfo {
 	struct cpufreq_frequency_table *freq_table;
 	unsigned int target_freq;
 	int governor_enabled;
+	unsigned int load_hist[LOAD_HIST_MAX];
+	unsigned int hist_idx;
+	unsigned int hist_cnt;
+	u64 hist_time;
+	u64 nr_samples;
+	u64 nr_saturated;
+	u64 busy_cycles;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
@@ -78,6 +90,39 @@ static unsigned long min_sample_time;
 #define DEFAULT_TIMER_RATE 20 * USEC_PER_MSEC
 static unsigned long timer_rate;
 
+/*
+ * Number of load samples averaged when deciding to ramp down.  A ramp up
+ * follows the latest sample, a ramp down follows the average so that a
+ * single quiet sample in the middle of a burst does not drop the speed.
+ */
+#define DEFAULT_LOAD_HISTORY 4
+static unsigned long load_history;
+
+/*
+ * Target load per frequency: the governor picks the lowest speed at which
+ * the projected load stays at or under the target for that speed.  The
+ * table is "load [freq:load ...]", each load applying from freq upwards.
+ */
+#define DEFAULT_TARGET_LOAD 90
+static unsigned int default_target_loads[] = {DEFAULT_TARGET_LOAD};
+static DEFINE_SPINLOCK(target_loads_lock);
+static unsigned int *target_loads = default_target_loads;
+static int ntarget_loads = ARRAY_SIZE(default_target_loads);
+
+/*
+ * Keep a speed for at least this many times the transition latency before
+ * ramping down, so that switching overhead stays at about 1% of the time.
+ */
+#define TRANSITION_COST_RATIO 100
+
+/*
+ * Hold hispeed_freq this long after an input event (0 disables).
+ */
+#define DEFAULT_INPUT_BOOST_DURATION (80 * USEC_PER_MSEC)
+static unsigned long input_boost_duration;
+static unsigned long boost_until;
+static atomic_t nr_boosts = ATOMIC_INIT(0);
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -91,12 +136,126 @@ struct cpufreq_governor cpufreq_gov_interactive = {
 	.owner = THIS_MODULE,
 };
 
+static unsigned int freq_to_targetload(unsigned int freq)
+{
+	int i;
+	unsigned int ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+
+	for (i = 0; i < ntarget_loads - 1 && freq >= target_loads[i+1]; i += 2)
+		;
+
+	ret = target_loads[i];
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return ret;
+}
+
+/*
+ * Lowest table frequency at which loadadjfreq (load percentage times the
+ * speed it was measured at) stays within the target load of that
+ * frequency.  Target loads differ per speed, so iterate until the choice
+ * is stable, narrowing [freqmin, freqmax] so that it cannot oscillate.
+ */
+static unsigned int cpufreq_interactive_choose_freq(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int loadadjfreq)
+{
+	unsigned int freq = pcpu->policy->cur;
+	unsigned int prevfreq, freqmin = 0, freqmax = UINT_MAX;
+	unsigned int index;
+
+	do {
+		prevfreq = freq;
+
+		if (cpufreq_frequency_table_target(pcpu->policy,
+				pcpu->freq_table,
+				loadadjfreq / freq_to_targetload(freq),
+				CPUFREQ_RELATION_L, &index))
+			break;
+		freq = pcpu->freq_table[index].frequency;
+
+		if (freq > prevfreq) {
+			/* prevfreq is too slow */
+			freqmin = prevfreq;
+			if (freq < freqmax)
+				continue;
+
+			if (cpufreq_frequency_table_target(pcpu->policy,
+					pcpu->freq_table, freqmax - 1,
+					CPUFREQ_RELATION_H, &index))
+				break;
+			freq = pcpu->freq_table[index].frequency;
+
+			/* nothing between a speed too slow and one fast enough */
+			if (freq == freqmin) {
+				freq = freqmax;
+				break;
+			}
+		} else if (freq < prevfreq) {
+			/* prevfreq is fast enough */
+			freqmax = prevfreq;
+			if (freq > freqmin)
+				continue;
+
+			if (cpufreq_frequency_table_target(pcpu->policy,
+					pcpu->freq_table, freqmin + 1,
+					CPUFREQ_RELATION_L, &index))
+				break;
+			freq = pcpu->freq_table[index].frequency;
+
+			if (freq == freqmax)
+				break;
+		}
+	} while (freq != prevfreq);
+
+	return freq;
+}
+
+/*
+ * Record a short-term load sample and return the average over the last
+ * load_history samples.  History older than two timer periods is stale,
+ * the CPU was idle in between.
+ */
+static unsigned int cpufreq_interactive_hist_load(
+	struct cpufreq_interactive_cpuinfo *pcpu, unsigned int load)
+{
+	unsigned int i, n, sum = 0;
+
+	if (cputime64_sub(pcpu->timer_run_time, pcpu->hist_time) >
+	    2 * timer_rate)
+		pcpu->hist_cnt = 0;
+	pcpu->hist_time = pcpu->timer_run_time;
+
+	pcpu->load_hist[pcpu->hist_idx] = load;
+	pcpu->hist_idx = (pcpu->hist_idx + 1) % LOAD_HIST_MAX;
+	if (pcpu->hist_cnt < LOAD_HIST_MAX)
+		pcpu->hist_cnt++;
+
+	n = min_t(unsigned int, pcpu->hist_cnt, load_history);
+	for (i = 1; i <= n; i++)
+		sum += pcpu->load_hist[(pcpu->hist_idx + LOAD_HIST_MAX - i) %
+				       LOAD_HIST_MAX];
+
+	return sum / n;
+}
+
+static unsigned long cpufreq_interactive_down_hold(
+	struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	unsigned long cost = pcpu->policy->cpuinfo.transition_latency /
+		NSEC_PER_USEC * TRANSITION_COST_RATIO;
+
+	return max(min_sample_time, cost);
+}
+
 static void cpufreq_interactive_timer(unsigned long data)
 {
 	unsigned int delta_idle;
 	unsigned int delta_time;
 	int cpu_load;
 	int load_since_change;
+	int hist_load;
 	u64 time_in_idle;
 	u64 idle_exit_time;
 	struct cpufreq_interactive_cpuinfo *pcpu =
@@ -144,6 +303,14 @@ static void cpufreq_interactive_timer(unsigned long data)
 	else
 		cpu_load = 100 * (delta_time - delta_idle) / delta_time;
 
+	pcpu->nr_samples++;
+	if (cpu_load >= 100 && pcpu->policy->cur < pcpu->policy->max)
+		pcpu->nr_saturated++;
+	if (cpu_load)
+		pcpu->busy_cycles += (u64)pcpu->policy->cur *
+			(delta_time - delta_idle) / 1000;
+	hist_load = cpufreq_interactive_hist_load(pcpu, cpu_load);
+
 	delta_idle = (unsigned int) cputime64_sub(now_idle,
 						pcpu->freq_change_time_in_idle);
 	delta_time = (unsigned int) cputime64_sub(pcpu->timer_run_time,
@@ -162,14 +329,16 @@ static void cpufreq_interactive_timer(unsigned long data)
 	 */
 	if (load_since_change > cpu_load)
 		cpu_load = load_since_change;
+	if (hist_load > cpu_load)
+		cpu_load = hist_load;
 
-	if (cpu_load >= go_hispeed_load) {
-		if (pcpu->policy->cur == pcpu->policy->min)
+	new_freq = cpufreq_interactive_choose_freq(pcpu,
+					pcpu->policy->cur * cpu_load);
+
+	if (cpu_load >= go_hispeed_load ||
+	    time_before(jiffies, boost_until)) {
+		if (new_freq < hispeed_freq)
 			new_freq = hispeed_freq;
-		else
-			new_freq = pcpu->policy->max * cpu_load / 100;
-	} else {
-		new_freq = pcpu->policy->cur * cpu_load / 100;
 	}
 
 	if (cpufreq_frequency_table_target(pcpu->policy, pcpu->freq_table,
@@ -187,11 +356,11 @@ static void cpufreq_interactive_timer(unsigned long data)
 
 	/*
 	 * Do not scale down unless we have been at this frequency for the
-	 * minimum sample time.
+	 * minimum sample time, or long enough to pay for the transition.
 	 */
 	if (new_freq < pcpu->target_freq) {
 		if (cputime64_sub(pcpu->timer_run_time, pcpu->freq_change_time)
-		    < min_sample_time)
+		    < cpufreq_interactive_down_hold(pcpu))
 			goto rearm;
 	}
 
@@ -431,6 +600,123 @@ static void cpufreq_interactive_freq_down(struct work_struct *work)
 	}
 }
 
+/*
+ * Raise every CPU to hispeed_freq right away and keep it there for
+ * input_boost_duration, rather than waiting a timer period to find out
+ * that the user is interacting.
+ */
+static void cpufreq_interactive_boost(void)
+{
+	int i;
+	int anyboost = 0;
+	unsigned long flags;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	boost_until = jiffies + usecs_to_jiffies(input_boost_duration);
+
+	spin_lock_irqsave(&up_cpumask_lock, flags);
+
+	for_each_online_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+
+		if (!pcpu->governor_enabled)
+			continue;
+
+		if (pcpu->target_freq < hispeed_freq) {
+			pcpu->target_freq = hispeed_freq;
+			cpumask_set_cpu(i, &up_cpumask);
+			anyboost = 1;
+		}
+	}
+
+	spin_unlock_irqrestore(&up_cpumask_lock, flags);
+
+	if (anyboost) {
+		atomic_inc(&nr_boosts);
+		wake_up_process(up_task);
+	}
+}
+
+static void cpufreq_interactive_input_event(struct input_handle *handle,
+					    unsigned int type,
+					    unsigned int code, int value)
+{
+	if (type == EV_SYN || !input_boost_duration ||
+	    !atomic_read(&active_count))
+		return;
+
+	cpufreq_interactive_boost();
+}
+
+static int cpufreq_interactive_input_connect(struct input_handler *handler,
+					     struct input_dev *dev,
+					     const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void cpufreq_interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+/* touchscreens and keys, not sensors reporting on their own */
+static const struct input_device_id cpufreq_interactive_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler cpufreq_interactive_input_handler = {
+	.event		= cpufreq_interactive_input_event,
+	.connect	= cpufreq_interactive_input_connect,
+	.disconnect	= cpufreq_interactive_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= cpufreq_interactive_ids,
+};
+
 static ssize_t show_hispeed_freq(struct kobject *kobj,
 				 struct attribute *attr, char *buf)
 {
@@ -521,11 +807,183 @@ static ssize_t store_timer_rate(struct kobject *kobj,
 static struct global_attr timer_rate_attr = __ATTR(timer_rate, 0644,
 		show_timer_rate, store_timer_rate);
 
+static ssize_t show_load_history(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", load_history);
+}
+
+static ssize_t store_load_history(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (val < 1 || val > LOAD_HIST_MAX)
+		return -EINVAL;
+	load_history = val;
+	return count;
+}
+
+static struct global_attr load_history_attr = __ATTR(load_history, 0644,
+		show_load_history, store_load_history);
+
+static ssize_t show_target_loads(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	int i;
+	ssize_t ret = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+
+	for (i = 0; i < ntarget_loads; i++)
+		ret += sprintf(buf + ret, "%u%s", target_loads[i],
+			       i & 0x1 ? ":" : " ");
+
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	buf[ret - 1] = '\n';
+	return ret;
+}
+
+static ssize_t store_target_loads(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	const char *cp;
+	unsigned int *new_target_loads;
+	int ntokens = 1;
+	int i;
+	unsigned long flags;
+
+	for (cp = buf; *cp; cp++)
+		if (*cp == ' ' || *cp == ':')
+			ntokens++;
+
+	/* a load, then freq:load pairs */
+	if (!(ntokens & 0x1))
+		return -EINVAL;
+
+	new_target_loads = kmalloc(ntokens * sizeof(unsigned int), GFP_KERNEL);
+	if (!new_target_loads)
+		return -ENOMEM;
+
+	cp = buf;
+	for (i = 0; i < ntokens; i++) {
+		if (sscanf(cp, "%u", &new_target_loads[i]) != 1)
+			goto err_inval;
+
+		/* loads must be 1..100, freqs ascending */
+		if (!(i & 0x1) && (new_target_loads[i] < 1 ||
+				   new_target_loads[i] > 100))
+			goto err_inval;
+		if ((i & 0x1) && i > 1 &&
+		    new_target_loads[i] <= new_target_loads[i - 2])
+			goto err_inval;
+
+		cp = strpbrk(cp, " :");
+		if (!cp)
+			break;
+		cp++;
+	}
+
+	if (i != ntokens - 1)
+		goto err_inval;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+	if (target_loads != default_target_loads)
+		kfree(target_loads);
+	target_loads = new_target_loads;
+	ntarget_loads = ntokens;
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return count;
+
+err_inval:
+	kfree(new_target_loads);
+	return -EINVAL;
+}
+
+static struct global_attr target_loads_attr = __ATTR(target_loads, 0644,
+		show_target_loads, store_target_loads);
+
+static ssize_t show_input_boost_duration(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", input_boost_duration);
+}
+
+static ssize_t store_input_boost_duration(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	input_boost_duration = val;
+	return count;
+}
+
+static struct global_attr input_boost_duration_attr =
+	__ATTR(input_boost_duration, 0644,
+	       show_input_boost_duration, store_input_boost_duration);
+
+/*
+ * Counters for comparing tunings on a replayed workload: busy cycles are
+ * an energy proxy, saturated samples (fully busy below the top speed) a
+ * proxy for missed deadlines.
+ */
+static ssize_t show_stats(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	unsigned int i;
+	u64 samples = 0, saturated = 0, cycles = 0;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		samples += pcpu->nr_samples;
+		saturated += pcpu->nr_saturated;
+		cycles += pcpu->busy_cycles;
+	}
+
+	return sprintf(buf, "samples %llu\nsaturated %llu\n"
+		       "busy_cycles %llu\nboosts %d\n",
+		       samples, saturated, cycles, atomic_read(&nr_boosts));
+}
+
+static ssize_t store_stats(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	unsigned int i;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	/* any write clears the counters */
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		pcpu->nr_samples = 0;
+		pcpu->nr_saturated = 0;
+		pcpu->busy_cycles = 0;
+	}
+	atomic_set(&nr_boosts, 0);
+	return count;
+}
+
+static struct global_attr stats_attr = __ATTR(stats, 0644,
+		show_stats, store_stats);
+
 static struct attribute *interactive_attributes[] = {
 	&hispeed_freq_attr.attr,
 	&go_hispeed_load_attr.attr,
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
+	&load_history_attr.attr,
+	&target_loads_attr.attr,
+	&input_boost_duration_attr.attr,
+	&stats_attr.attr,
 	NULL,
 };
 
@@ -639,12 +1097,16 @@ static struct notifier_block cpufreq_interactive_idle_nb = {
 static int __init cpufreq_interactive_init(void)
 {
 	unsigned int i;
+	int rc;
 	struct cpufreq_interactive_cpuinfo *pcpu;
 	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
 
 	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
 	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
 	timer_rate = DEFAULT_TIMER_RATE;
+	load_history = DEFAULT_LOAD_HISTORY;
+	input_boost_duration = DEFAULT_INPUT_BOOST_DURATION;
+	boost_until = jiffies;
 
 	/* Initalize per-cpu timers */
 	for_each_possible_cpu(i) {
@@ -676,11 +1138,22 @@ static int __init cpufreq_interactive_init(void)
 	spin_lock_init(&down_cpumask_lock);
 	mutex_init(&set_speed_lock);
 
+	rc = input_register_handler(&cpufreq_interactive_input_handler);
+	if (rc)
+		goto err_destroywq;
+
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
 
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
+err_destroywq:
+	destroy_workqueue(down_wq);
+	kthread_stop(up_task);
+	put_task_struct(up_task);
+	return rc;
+
 err_freeuptask:
+	kthread_stop(up_task);
 	put_task_struct(up_task);
 	return -ENOMEM;
 }
@@ -694,6 +1167,7 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	input_unregister_handler(&cpufreq_interactive_input_handler);
 	kthread_stop(up_task);
 	put_task_struct(up_task);
 	destroy_workqueue(down_wq);
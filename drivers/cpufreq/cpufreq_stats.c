@@ -20,6 +20,7 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/hrtimer.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -38,6 +39,10 @@ struct cpufreq_stats {
 	unsigned int state_num;
 	unsigned int last_index;
 	cputime64_t *time_in_state;
+	u64 *lat_total;
+	unsigned int *lat_count;
+	unsigned int *lat_max;
+	ktime_t trans_start;
 	unsigned int *freq_table;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
@@ -93,6 +98,31 @@ static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 	return len;
 }
 
+/*
+ * Time from PRECHANGE to POSTCHANGE of transitions into each frequency, in
+ * us: "freq average max".  This includes whatever the driver does between
+ * the two notifications, so voltage changes only if it scales inside.
+ */
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	u64 avg;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	for (i = 0; i < stat->state_num; i++) {
+		avg = stat->lat_total[i];
+		if (stat->lat_count[i])
+			do_div(avg, stat->lat_count[i]);
+		len += sprintf(buf + len, "%u %llu %u\n", stat->freq_table[i],
+			       (unsigned long long)avg, stat->lat_max[i]);
+	}
+	spin_unlock(&cpufreq_stats_lock);
+	return len;
+}
+
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 {
@@ -142,10 +172,12 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
 	&_attr_time_in_state.attr,
+	&_attr_trans_latency.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&_attr_trans_table.attr,
 #endif
@@ -225,6 +257,7 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	}
 
 	alloc_size = count * sizeof(int) + count * sizeof(cputime64_t);
+	alloc_size += count * (sizeof(u64) + 2 * sizeof(int));
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
@@ -235,10 +268,13 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 		ret = -ENOMEM;
 		goto error_out;
 	}
-	stat->freq_table = (unsigned int *)(stat->time_in_state + count);
+	stat->lat_total = (u64 *)(stat->time_in_state + count);
+	stat->freq_table = (unsigned int *)(stat->lat_total + count);
+	stat->lat_count = stat->freq_table + count;
+	stat->lat_max = stat->lat_count + count;
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table = stat->freq_table + count;
+	stat->trans_table = stat->lat_max + count;
 #endif
 	j = 0;
 	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -287,14 +323,26 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	unsigned int latency;
+	bool timed;
 
-	if (val != CPUFREQ_POSTCHANGE)
+	if (val != CPUFREQ_PRECHANGE && val != CPUFREQ_POSTCHANGE)
 		return 0;
 
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = ktime_get();
+		return 0;
+	}
+
+	/* a POSTCHANGE without a PRECHANGE has no latency to account */
+	timed = stat->trans_start.tv64 != 0;
+	latency = ktime_to_us(ktime_sub(ktime_get(), stat->trans_start));
+	stat->trans_start.tv64 = 0;
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
@@ -309,6 +357,12 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 
 	spin_lock(&cpufreq_stats_lock);
 	stat->last_index = new_index;
+	if (timed) {
+		stat->lat_total[new_index] += latency;
+		stat->lat_count[new_index]++;
+		if (latency > stat->lat_max[new_index])
+			stat->lat_max[new_index] = latency;
+	}
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
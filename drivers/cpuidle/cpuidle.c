@@ -52,6 +52,7 @@ static void cpuidle_idle_call(void)
 	struct cpuidle_device *dev = __this_cpu_read(cpuidle_devices);
 	struct cpuidle_state *target_state;
 	int next_state;
+	int i;
 
 	/* check if the device is ready */
 	if (!dev || !dev->enabled) {
@@ -111,6 +112,28 @@ static void cpuidle_idle_call(void)
 	target_state->time += (unsigned long long)dev->last_residency;
 	target_state->usage++;
 
+	/*
+	 * Count mispredictions: the CPU woke before the state paid off, or
+	 * stayed long enough for a deeper state that was allowed.
+	 */
+	if (target_state->flags & CPUIDLE_FLAG_TIME_VALID) {
+		if (dev->last_residency < target_state->target_residency) {
+			target_state->above++;
+		} else {
+			for (i = target_state - dev->states + 1;
+			     i < dev->state_count; i++) {
+				struct cpuidle_state *s = &dev->states[i];
+
+				if (s->flags & CPUIDLE_FLAG_IGNORE)
+					continue;
+				if (s->target_residency <= dev->last_residency) {
+					target_state->below++;
+					break;
+				}
+			}
+		}
+	}
+
 	/* give the governor an opportunity to reflect on the outcome */
 	if (cpuidle_curr_governor->reflect)
 		cpuidle_curr_governor->reflect(dev);
@@ -236,6 +259,8 @@ int cpuidle_enable_device(struct cpuidle_device *dev)
 	for (i = 0; i < dev->state_count; i++) {
 		dev->states[i].usage = 0;
 		dev->states[i].time = 0;
+		dev->states[i].above = 0;
+		dev->states[i].below = 0;
 	}
 	dev->last_residency = 0;
 	dev->last_state = NULL;
@@ -247,6 +247,9 @@ define_show_state_function(exit_latency)
 define_show_state_function(power_usage)
 define_show_state_ull_function(usage)
 define_show_state_ull_function(time)
+define_show_state_function(target_residency)
+define_show_state_ull_function(above)
+define_show_state_ull_function(below)
 define_show_state_str_function(name)
 define_show_state_str_function(desc)
 
@@ -256,6 +259,9 @@ define_one_state_ro(latency, show_state_exit_latency);
 define_one_state_ro(power, show_state_power_usage);
 define_one_state_ro(usage, show_state_usage);
 define_one_state_ro(time, show_state_time);
+define_one_state_ro(residency, show_state_target_residency);
+define_one_state_ro(above, show_state_above);
+define_one_state_ro(below, show_state_below);
 
 static struct attribute *cpuidle_state_default_attrs[] = {
 	&attr_name.attr,
@@ -264,6 +270,9 @@ static struct attribute *cpuidle_state_default_attrs[] = {
 	&attr_power.attr,
 	&attr_usage.attr,
 	&attr_time.attr,
+	&attr_residency.attr,
+	&attr_above.attr,
+	&attr_below.attr,
 	NULL
 };
 
@@ -28,6 +28,7 @@
 #include <crypto/algapi.h>
 #include <crypto/aes.h>
 #include <crypto/ctr.h>
+#include <crypto/scatterwalk.h>
 
 #include <plat/cpu.h>
 #include <plat/dma.h>
@@ -143,10 +144,12 @@
 #define FLAGS_AES_CTR                   _SBF(1, 0x02)
 
 #define AES_KEY_LEN         16
-#define CRYPTO_QUEUE_LEN    1
+#define CRYPTO_QUEUE_LEN    32
 
 struct s5p_aes_reqctx {
 	unsigned long mode;
+	int           err;
+	uint8_t       iv[AES_BLOCK_SIZE];
 };
 
 struct s5p_aes_ctx {
@@ -166,9 +169,23 @@ struct s5p_aes_dev {
 
 	struct ablkcipher_request  *req;
 	struct s5p_aes_ctx         *ctx;
+	struct scatterlist         *src;
+	struct scatterlist         *dst;
+	int                         src_nents;
+	int                         dst_nents;
 	struct scatterlist         *sg_src;
 	struct scatterlist         *sg_dst;
+	unsigned int                src_left;
+	unsigned int                dst_left;
+	unsigned int                src_len;
+	unsigned int                dst_len;
 
+	/* linear copy of requests the engine can't take as they are */
+	void                       *bounce;
+	unsigned int                bounce_len;
+	struct scatterlist          bounce_sg;
+
+	struct list_head            done;
 	struct tasklet_struct       tasklet;
 	struct crypto_queue         queue;
 	bool                        busy;
@@ -179,150 +196,190 @@ static struct s5p_aes_dev *s5p_dev;
 
 static void s5p_set_dma_indata(struct s5p_aes_dev *dev, struct scatterlist *sg)
 {
+	dev->src_len = min(sg_dma_len(sg), dev->src_left);
+
 	SSS_WRITE(dev, FCBRDMAS, sg_dma_address(sg));
-	SSS_WRITE(dev, FCBRDMAL, sg_dma_len(sg));
+	SSS_WRITE(dev, FCBRDMAL, dev->src_len);
 }
 
 static void s5p_set_dma_outdata(struct s5p_aes_dev *dev, struct scatterlist *sg)
 {
-	SSS_WRITE(dev, FCBTDMAS, sg_dma_address(sg));
-	SSS_WRITE(dev, FCBTDMAL, sg_dma_len(sg));
-}
-
-static void s5p_aes_complete(struct s5p_aes_dev *dev, int err)
-{
-	/* holding a lock outside */
-	dev->req->base.complete(&dev->req->base, err);
-	dev->busy = false;
-}
-
-static void s5p_unset_outdata(struct s5p_aes_dev *dev)
-{
-	dma_unmap_sg(dev->dev, dev->sg_dst, 1, DMA_FROM_DEVICE);
-}
+	dev->dst_len = min(sg_dma_len(sg), dev->dst_left);
 
-static void s5p_unset_indata(struct s5p_aes_dev *dev)
-{
-	dma_unmap_sg(dev->dev, dev->sg_src, 1, DMA_TO_DEVICE);
+	SSS_WRITE(dev, FCBTDMAS, sg_dma_address(sg));
+	SSS_WRITE(dev, FCBTDMAL, dev->dst_len);
 }
 
-static int s5p_set_outdata(struct s5p_aes_dev *dev, struct scatterlist *sg)
+/*
+ * Counts the entries covering @nbytes of @sg. Returns 0 if one of them
+ * would end the DMA in the middle of an AES block, 1 if all can be fed to
+ * the engine as they are.
+ */
+static int s5p_aes_sg_check(struct scatterlist *sg, unsigned int nbytes,
+			    int *nents)
 {
-	int err;
+	int usable = IS_ALIGNED(nbytes, AES_BLOCK_SIZE);
 
-	if (!IS_ALIGNED(sg_dma_len(sg), AES_BLOCK_SIZE)) {
-		err = -EINVAL;
-		goto exit;
-	}
-	if (!sg_dma_len(sg)) {
-		err = -EINVAL;
-		goto exit;
-	}
+	for (*nents = 0; sg && nbytes; sg = sg_next(sg)) {
+		if (!sg->length || (sg->length < nbytes &&
+				    !IS_ALIGNED(sg->length, AES_BLOCK_SIZE)))
+			usable = 0;
 
-	err = dma_map_sg(dev->dev, sg, 1, DMA_FROM_DEVICE);
-	if (!err) {
-		err = -ENOMEM;
-		goto exit;
+		nbytes -= min(sg->length, nbytes);
+		(*nents)++;
 	}
 
-	dev->sg_dst = sg;
-	err = 0;
+	if (nbytes)
+		return -EINVAL;
 
- exit:
-	return err;
+	return usable;
 }
 
-static int s5p_set_indata(struct s5p_aes_dev *dev, struct scatterlist *sg)
+/* called with dev->lock held */
+static int s5p_aes_map(struct s5p_aes_dev *dev, struct ablkcipher_request *req)
 {
-	int err;
-
-	if (!IS_ALIGNED(sg_dma_len(sg), AES_BLOCK_SIZE)) {
-		err = -EINVAL;
-		goto exit;
+	int usable, err;
+
+	usable = s5p_aes_sg_check(req->src, req->nbytes, &dev->src_nents);
+	if (usable < 0)
+		return usable;
+
+	err = s5p_aes_sg_check(req->dst, req->nbytes, &dev->dst_nents);
+	if (err < 0)
+		return err;
+
+	usable = usable && err;
+	if (usable) {
+		dev->src = req->src;
+		dev->dst = req->dst;
+		dev->src_left = req->nbytes;
+	} else {
+		dev->bounce_len = ALIGN(req->nbytes, AES_BLOCK_SIZE);
+		dev->bounce = kzalloc(dev->bounce_len, GFP_ATOMIC);
+		if (!dev->bounce)
+			return -ENOMEM;
+
+		sg_copy_to_buffer(req->src, dev->src_nents, dev->bounce,
+				  req->nbytes);
+		sg_init_one(&dev->bounce_sg, dev->bounce, dev->bounce_len);
+
+		dev->src = &dev->bounce_sg;
+		dev->dst = &dev->bounce_sg;
+		dev->src_left = dev->bounce_len;
 	}
-	if (!sg_dma_len(sg)) {
-		err = -EINVAL;
-		goto exit;
+	dev->dst_left = dev->src_left;
+
+	if (dev->src == dev->dst) {
+		err = dma_map_sg(dev->dev, dev->src, usable ? dev->src_nents : 1,
+				 DMA_BIDIRECTIONAL);
+		if (!err)
+			goto err_map_src;
+	} else {
+		err = dma_map_sg(dev->dev, dev->src, dev->src_nents,
+				 DMA_TO_DEVICE);
+		if (!err)
+			goto err_map_src;
+
+		err = dma_map_sg(dev->dev, dev->dst, dev->dst_nents,
+				 DMA_FROM_DEVICE);
+		if (!err)
+			goto err_map_dst;
 	}
 
-	err = dma_map_sg(dev->dev, sg, 1, DMA_TO_DEVICE);
-	if (!err) {
-		err = -ENOMEM;
-		goto exit;
-	}
-
-	dev->sg_src = sg;
-	err = 0;
-
- exit:
-	return err;
-}
+	dev->sg_src = dev->src;
+	dev->sg_dst = dev->dst;
 
-static void s5p_aes_tx(struct s5p_aes_dev *dev)
-{
-	int err = 0;
+	return 0;
 
-	s5p_unset_outdata(dev);
+ err_map_dst:
+	dma_unmap_sg(dev->dev, dev->src, dev->src_nents, DMA_TO_DEVICE);
 
-	if (!sg_is_last(dev->sg_dst)) {
-		err = s5p_set_outdata(dev, sg_next(dev->sg_dst));
-		if (err) {
-			s5p_aes_complete(dev, err);
-			return;
-		}
+ err_map_src:
+	kfree(dev->bounce);
+	dev->bounce = NULL;
 
-		s5p_set_dma_outdata(dev, dev->sg_dst);
-	} else
-		s5p_aes_complete(dev, err);
+	return -ENOMEM;
 }
 
-static void s5p_aes_rx(struct s5p_aes_dev *dev)
+/* called with dev->lock held */
+static void s5p_aes_unmap(struct s5p_aes_dev *dev)
 {
-	int err;
-
-	s5p_unset_indata(dev);
-
-	if (!sg_is_last(dev->sg_src)) {
-		err = s5p_set_indata(dev, sg_next(dev->sg_src));
-		if (err) {
-			s5p_aes_complete(dev, err);
-			return;
-		}
-
-		s5p_set_dma_indata(dev, dev->sg_src);
+	struct ablkcipher_request *req = dev->req;
+
+	if (dev->bounce) {
+		dma_unmap_sg(dev->dev, &dev->bounce_sg, 1, DMA_BIDIRECTIONAL);
+
+		sg_copy_from_buffer(req->dst, dev->dst_nents, dev->bounce,
+				    req->nbytes);
+
+		kfree(dev->bounce);
+		dev->bounce = NULL;
+	} else if (dev->src == dev->dst) {
+		dma_unmap_sg(dev->dev, dev->src, dev->src_nents,
+			     DMA_BIDIRECTIONAL);
+	} else {
+		dma_unmap_sg(dev->dev, dev->src, dev->src_nents,
+			     DMA_TO_DEVICE);
+		dma_unmap_sg(dev->dev, dev->dst, dev->dst_nents,
+			     DMA_FROM_DEVICE);
 	}
 }
 
-static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
+/* leaves the IV for a following request in req->info, as other drivers do */
+static void s5p_aes_update_iv(struct s5p_aes_dev *dev)
 {
-	struct platform_device *pdev = dev_id;
-	struct s5p_aes_dev     *dev  = platform_get_drvdata(pdev);
-	uint32_t                status;
-	unsigned long           flags;
+	struct ablkcipher_request  *req    = dev->req;
+	struct s5p_aes_reqctx      *reqctx = ablkcipher_request_ctx(req);
+	unsigned int                blocks;
+
+	switch (reqctx->mode) {
+	case FLAGS_AES_CBC:
+		scatterwalk_map_and_copy(req->info, req->dst,
+					 req->nbytes - AES_BLOCK_SIZE,
+					 AES_BLOCK_SIZE, 0);
+		break;
+
+	case FLAGS_AES_CBC | FLAGS_AES_DECRYPT:
+		memcpy(req->info, reqctx->iv, AES_BLOCK_SIZE);
+		break;
+
+	case FLAGS_AES_CTR:
+		for (blocks = DIV_ROUND_UP(req->nbytes, AES_BLOCK_SIZE);
+		     blocks; blocks--)
+			crypto_inc(req->info, AES_BLOCK_SIZE);
+		break;
+	}
+}
 
-	spin_lock_irqsave(&dev->lock, flags);
+/*
+ * Hands the request over to the tasklet for completion, so that callbacks
+ * never run from the interrupt or with the lock held.
+ * Called with dev->lock held.
+ */
+static void s5p_aes_complete(struct s5p_aes_dev *dev,
+			     struct ablkcipher_request *req, int err)
+{
+	struct s5p_aes_reqctx *reqctx = ablkcipher_request_ctx(req);
 
-	if (irq == dev->irq_fc) {
-		status = SSS_READ(dev, FCINTSTAT);
-		if (status & SSS_FCINTSTAT_BRDMAINT)
-			s5p_aes_rx(dev);
-		if (status & SSS_FCINTSTAT_BTDMAINT)
-			s5p_aes_tx(dev);
+	reqctx->err = err;
+	list_add_tail(&req->base.list, &dev->done);
 
-		SSS_WRITE(dev, FCINTPEND, status);
-	}
-
-	spin_unlock_irqrestore(&dev->lock, flags);
+	if (dev->req == req)
+		dev->req = NULL;
 
-	return IRQ_HANDLED;
+	tasklet_schedule(&dev->tasklet);
 }
 
-static void s5p_set_aes(struct s5p_aes_dev *dev,
-			uint8_t *key, uint8_t *iv, unsigned int keylen)
+static void s5p_set_aes(struct s5p_aes_dev *dev, uint8_t *key,
+			uint8_t *iv, uint8_t *ctr, unsigned int keylen)
 {
 	void __iomem *keystart;
 
-	memcpy(dev->ioaddr + SSS_REG_AES_IV_DATA(0), iv, 0x10);
+	if (iv)
+		memcpy(dev->ioaddr + SSS_REG_AES_IV_DATA(0), iv, 0x10);
+
+	if (ctr)
+		memcpy(dev->ioaddr + SSS_REG_AES_CNT_DATA(0), ctr, 0x10);
 
 	if (keylen == AES_KEYSIZE_256)
 		keystart = dev->ioaddr + SSS_REG_AES_KEY_DATA(0);
@@ -334,26 +391,37 @@ static void s5p_set_aes(struct s5p_aes_dev *dev,
 	memcpy(keystart, key, keylen);
 }
 
-static void s5p_aes_crypt_start(struct s5p_aes_dev *dev, unsigned long mode)
+/* called with dev->lock held */
+static int s5p_aes_crypt_start(struct s5p_aes_dev *dev,
+			       struct ablkcipher_request *req)
 {
-	struct ablkcipher_request  *req = dev->req;
-
+	struct s5p_aes_reqctx      *reqctx = ablkcipher_request_ctx(req);
+	struct s5p_aes_ctx         *ctx    = crypto_tfm_ctx(req->base.tfm);
+	unsigned long               mode   = reqctx->mode;
 	uint32_t                    aes_control;
+	uint8_t                    *iv, *ctr;
 	int                         err;
-	unsigned long               flags;
 
 	aes_control = SSS_AES_KEY_CHANGE_MODE;
 	if (mode & FLAGS_AES_DECRYPT)
 		aes_control |= SSS_AES_MODE_DECRYPT;
 
-	if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CBC)
+	if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CBC) {
 		aes_control |= SSS_AES_CHAIN_MODE_CBC;
-	else if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CTR)
+		iv = req->info;
+		ctr = NULL;
+	} else if ((mode & FLAGS_AES_MODE_MASK) == FLAGS_AES_CTR) {
 		aes_control |= SSS_AES_CHAIN_MODE_CTR;
+		iv = NULL;
+		ctr = req->info;
+	} else {
+		iv = NULL;
+		ctr = NULL;
+	}
 
-	if (dev->ctx->keylen == AES_KEYSIZE_192)
+	if (ctx->keylen == AES_KEYSIZE_192)
 		aes_control |= SSS_AES_KEY_SIZE_192;
-	else if (dev->ctx->keylen == AES_KEYSIZE_256)
+	else if (ctx->keylen == AES_KEYSIZE_256)
 		aes_control |= SSS_AES_KEY_SIZE_256;
 
 	aes_control |= SSS_AES_FIFO_MODE;
@@ -365,86 +433,176 @@ static void s5p_aes_crypt_start(struct s5p_aes_dev *dev, unsigned long mode)
 		    |  SSS_AES_BYTESWAP_KEY
 		    |  SSS_AES_BYTESWAP_CNT;
 
-	spin_lock_irqsave(&dev->lock, flags);
+	/* the last cipher text block is the next IV, save it before in-place */
+	if (mode == (FLAGS_AES_CBC | FLAGS_AES_DECRYPT))
+		scatterwalk_map_and_copy(reqctx->iv, req->src,
+					 req->nbytes - AES_BLOCK_SIZE,
+					 AES_BLOCK_SIZE, 0);
+
+	dev->req = req;
+	dev->ctx = ctx;
+
+	err = s5p_aes_map(dev, req);
+	if (err) {
+		dev->req = NULL;
+		return err;
+	}
 
 	SSS_WRITE(dev, FCINTENCLR,
 		  SSS_FCINTENCLR_BTDMAINTENCLR | SSS_FCINTENCLR_BRDMAINTENCLR);
 	SSS_WRITE(dev, FCFIFOCTRL, 0x00);
 
-	err = s5p_set_indata(dev, req->src);
-	if (err)
-		goto indata_error;
-
-	err = s5p_set_outdata(dev, req->dst);
-	if (err)
-		goto outdata_error;
-
 	SSS_WRITE(dev, AES_CONTROL, aes_control);
-	s5p_set_aes(dev, dev->ctx->aes_key, req->info, dev->ctx->keylen);
+	s5p_set_aes(dev, ctx->aes_key, iv, ctr, ctx->keylen);
 
-	s5p_set_dma_indata(dev,  req->src);
-	s5p_set_dma_outdata(dev, req->dst);
+	s5p_set_dma_indata(dev,  dev->sg_src);
+	s5p_set_dma_outdata(dev, dev->sg_dst);
 
 	SSS_WRITE(dev, FCINTENSET,
 		  SSS_FCINTENSET_BTDMAINTENSET | SSS_FCINTENSET_BRDMAINTENSET);
 
-	spin_unlock_irqrestore(&dev->lock, flags);
+	return 0;
+}
 
-	return;
+/*
+ * Starts the next queued request, if any. Returns the request which has
+ * just left the backlog, to be told so once the lock is dropped.
+ * Called with dev->lock held.
+ */
+static struct crypto_async_request *s5p_aes_next(struct s5p_aes_dev *dev)
+{
+	struct crypto_async_request *async_req, *backlog;
+	struct ablkcipher_request *req;
+	int err;
 
- outdata_error:
-	s5p_unset_indata(dev);
+	backlog   = crypto_get_backlog(&dev->queue);
+	async_req = crypto_dequeue_request(&dev->queue);
+	if (!async_req) {
+		dev->busy = false;
+		return NULL;
+	}
+
+	req = ablkcipher_request_cast(async_req);
+
+	err = s5p_aes_crypt_start(dev, req);
+	if (err)
+		s5p_aes_complete(dev, req, err);
+
+	return backlog;
+}
+
+static void s5p_aes_tx(struct s5p_aes_dev *dev,
+		       struct crypto_async_request **backlog)
+{
+	dev->dst_left -= dev->dst_len;
+
+	if (dev->dst_left) {
+		dev->sg_dst = sg_next(dev->sg_dst);
+		s5p_set_dma_outdata(dev, dev->sg_dst);
+		return;
+	}
+
+	s5p_aes_unmap(dev);
+	s5p_aes_update_iv(dev);
+	s5p_aes_complete(dev, dev->req, 0);
+
+	/* keep the engine busy, chaining the next request right away */
+	*backlog = s5p_aes_next(dev);
+}
+
+static void s5p_aes_rx(struct s5p_aes_dev *dev)
+{
+	dev->src_left -= dev->src_len;
+
+	if (dev->src_left) {
+		dev->sg_src = sg_next(dev->sg_src);
+		s5p_set_dma_indata(dev, dev->sg_src);
+	}
+}
+
+static irqreturn_t s5p_aes_interrupt(int irq, void *dev_id)
+{
+	struct platform_device      *pdev    = dev_id;
+	struct s5p_aes_dev          *dev     = platform_get_drvdata(pdev);
+	struct crypto_async_request *backlog = NULL;
+	uint32_t                     status;
+	unsigned long                flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+
+	if (irq == dev->irq_fc) {
+		status = SSS_READ(dev, FCINTSTAT);
+
+		/* acked first, the next request may be started from here */
+		SSS_WRITE(dev, FCINTPEND, status);
+
+		if (dev->req) {
+			if (status & SSS_FCINTSTAT_BRDMAINT)
+				s5p_aes_rx(dev);
+			if (status & SSS_FCINTSTAT_BTDMAINT)
+				s5p_aes_tx(dev, &backlog);
+		}
+	}
 
- indata_error:
-	s5p_aes_complete(dev, err);
 	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (backlog)
+		backlog->complete(backlog, -EINPROGRESS);
+
+	return IRQ_HANDLED;
 }
 
 static void s5p_tasklet_cb(unsigned long data)
 {
 	struct s5p_aes_dev *dev = (struct s5p_aes_dev *)data;
-	struct crypto_async_request *async_req, *backlog;
+	struct crypto_async_request *async_req, *tmp, *backlog = NULL;
+	struct ablkcipher_request *req;
 	struct s5p_aes_reqctx *reqctx;
 	unsigned long flags;
+	LIST_HEAD(done);
 
 	spin_lock_irqsave(&dev->lock, flags);
-	backlog   = crypto_get_backlog(&dev->queue);
-	async_req = crypto_dequeue_request(&dev->queue);
-	spin_unlock_irqrestore(&dev->lock, flags);
 
-	if (!async_req)
-		return;
+	list_splice_init(&dev->done, &done);
+
+	/* the previous start failed, nothing will chain from the interrupt */
+	if (dev->busy && !dev->req)
+		backlog = s5p_aes_next(dev);
+
+	spin_unlock_irqrestore(&dev->lock, flags);
 
 	if (backlog)
 		backlog->complete(backlog, -EINPROGRESS);
 
-	dev->req = ablkcipher_request_cast(async_req);
-	dev->ctx = crypto_tfm_ctx(dev->req->base.tfm);
-	reqctx   = ablkcipher_request_ctx(dev->req);
+	list_for_each_entry_safe(async_req, tmp, &done, list) {
+		list_del(&async_req->list);
 
-	s5p_aes_crypt_start(dev, reqctx->mode);
+		req = ablkcipher_request_cast(async_req);
+		reqctx = ablkcipher_request_ctx(req);
+		async_req->complete(async_req, reqctx->err);
+	}
 }
 
 static int s5p_aes_handle_req(struct s5p_aes_dev *dev,
 			      struct ablkcipher_request *req)
 {
+	struct crypto_async_request *backlog = NULL;
 	unsigned long flags;
 	int err;
 
 	spin_lock_irqsave(&dev->lock, flags);
-	if (dev->busy) {
-		err = -EAGAIN;
-		spin_unlock_irqrestore(&dev->lock, flags);
-		goto exit;
-	}
-	dev->busy = true;
 
 	err = ablkcipher_enqueue_request(&dev->queue, req);
+	if (!dev->busy) {
+		dev->busy = true;
+		backlog = s5p_aes_next(dev);
+	}
+
 	spin_unlock_irqrestore(&dev->lock, flags);
 
-	tasklet_schedule(&dev->tasklet);
+	if (backlog)
+		backlog->complete(backlog, -EINPROGRESS);
 
- exit:
 	return err;
 }
 
@@ -455,7 +613,12 @@ static int s5p_aes_crypt(struct ablkcipher_request *req, unsigned long mode)
 	struct s5p_aes_reqctx      *reqctx = ablkcipher_request_ctx(req);
 	struct s5p_aes_dev         *dev    = ctx->dev;
 
-	if (!IS_ALIGNED(req->nbytes, AES_BLOCK_SIZE)) {
+	if (!req->nbytes)
+		return 0;
+
+	/* counter mode is a stream cipher, the tail is padded internally */
+	if ((mode & FLAGS_AES_MODE_MASK) != FLAGS_AES_CTR &&
+	    !IS_ALIGNED(req->nbytes, AES_BLOCK_SIZE)) {
 		pr_err("request size is not exact amount of AES blocks\n");
 		return -EINVAL;
 	}
@@ -502,6 +665,12 @@ static int s5p_aes_cbc_decrypt(struct ablkcipher_request *req)
 	return s5p_aes_crypt(req, FLAGS_AES_DECRYPT | FLAGS_AES_CBC);
 }
 
+/* the key stream is always generated with the forward cipher */
+static int s5p_aes_ctr_crypt(struct ablkcipher_request *req)
+{
+	return s5p_aes_crypt(req, FLAGS_AES_CTR);
+}
+
 static int s5p_aes_cra_init(struct crypto_tfm *tfm)
 {
 	struct s5p_aes_ctx  *ctx = crypto_tfm_ctx(tfm);
@@ -516,7 +685,7 @@ static struct crypto_alg algs[] = {
 	{
 		.cra_name		= "ecb(aes)",
 		.cra_driver_name	= "ecb-aes-s5p",
-		.cra_priority		= 100,
+		.cra_priority		= 300,
 		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
 					  CRYPTO_ALG_ASYNC,
 		.cra_blocksize		= AES_BLOCK_SIZE,
@@ -536,7 +705,7 @@ static struct crypto_alg algs[] = {
 	{
 		.cra_name		= "cbc(aes)",
 		.cra_driver_name	= "cbc-aes-s5p",
-		.cra_priority		= 100,
+		.cra_priority		= 300,
 		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
 					  CRYPTO_ALG_ASYNC,
 		.cra_blocksize		= AES_BLOCK_SIZE,
@@ -554,6 +723,27 @@ static struct crypto_alg algs[] = {
 			.decrypt	= s5p_aes_cbc_decrypt,
 		}
 	},
+	{
+		.cra_name		= "ctr(aes)",
+		.cra_driver_name	= "ctr-aes-s5p",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
+					  CRYPTO_ALG_ASYNC,
+		.cra_blocksize		= 1,
+		.cra_ctxsize		= sizeof(struct s5p_aes_ctx),
+		.cra_alignmask		= 0x0f,
+		.cra_type		= &crypto_ablkcipher_type,
+		.cra_module		= THIS_MODULE,
+		.cra_init		= s5p_aes_cra_init,
+		.cra_u.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= s5p_aes_setkey,
+			.encrypt	= s5p_aes_ctr_crypt,
+			.decrypt	= s5p_aes_ctr_crypt,
+		}
+	},
 };
 
 static int s5p_aes_probe(struct platform_device *pdev)
@@ -620,6 +810,7 @@ static int s5p_aes_probe(struct platform_device *pdev)
 	platform_set_drvdata(pdev, pdata);
 	s5p_dev = pdata;
 
+	INIT_LIST_HEAD(&pdata->done);
 	tasklet_init(&pdata->tasklet, s5p_tasklet_cb, (unsigned long)pdata);
 	crypto_init_queue(&pdata->queue, CRYPTO_QUEUE_LEN);
 
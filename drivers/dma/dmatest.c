@@ -15,6 +15,8 @@
 #include <linux/moduleparam.h>
 #include <linux/random.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/wait.h>
 
 static unsigned int test_buf_size = 16384;
@@ -59,6 +61,11 @@ module_param(timeout, uint, S_IRUGO);
 MODULE_PARM_DESC(timeout, "Transfer Timeout in msec (default: 3000), "
 		 "Pass -1 for infinite timeout");
 
+static bool noverify;
+module_param(noverify, bool, S_IRUGO);
+MODULE_PARM_DESC(noverify, "Disable buffer fill and verify, "
+		 "for throughput measurements (default: verify)");
+
 /*
  * Initialization patterns. All bytes in the source buffer has bit 7
  * set, all bytes in the destination buffer has bit 7 cleared.
@@ -240,6 +247,11 @@ static int dmatest_func(void *data)
 	unsigned int		error_count;
 	unsigned int		failed_tests = 0;
 	unsigned int		total_tests = 0;
+	unsigned long long	total_len = 0;
+	ktime_t			ktime, start;
+	s64			filltime = 0;
+	s64			comparetime = 0;
+	s64			runtime;
 	dma_cookie_t		cookie;
 	enum dma_status		status;
 	enum dma_ctrl_flags 	flags;
@@ -297,6 +309,7 @@ static int dmatest_func(void *data)
 	flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT
 	      | DMA_COMPL_SKIP_DEST_UNMAP | DMA_COMPL_SRC_UNMAP_SINGLE;
 
+	ktime = start = ktime_get();
 	while (!kthread_should_stop()
 	       && !(iterations && total_tests >= iterations)) {
 		struct dma_device *dev = chan->device;
@@ -333,8 +346,12 @@ static int dmatest_func(void *data)
 		src_off = (src_off >> align) << align;
 		dst_off = (dst_off >> align) << align;
 
-		dmatest_init_srcs(thread->srcs, src_off, len);
-		dmatest_init_dsts(thread->dsts, dst_off, len);
+		if (!noverify) {
+			ktime = ktime_get();
+			dmatest_init_srcs(thread->srcs, src_off, len);
+			dmatest_init_dsts(thread->dsts, dst_off, len);
+			filltime += ktime_us_delta(ktime_get(), ktime);
+		}
 
 		for (i = 0; i < src_cnt; i++) {
 			u8 *buf = thread->srcs[i] + src_off;
@@ -425,6 +442,12 @@ static int dmatest_func(void *data)
 			dma_unmap_single(dev->dev, dma_dsts[i], test_buf_size,
 					 DMA_BIDIRECTIONAL);
 
+		total_len += len;
+
+		if (noverify)
+			continue;
+
+		ktime = ktime_get();
 		error_count = 0;
 
 		pr_debug("%s: verifying source buffer...\n", thread_name);
@@ -448,6 +471,8 @@ static int dmatest_func(void *data)
 				test_buf_size, dst_off + len,
 				PATTERN_DST, false);
 
+		comparetime += ktime_us_delta(ktime_get(), ktime);
+
 		if (error_count) {
 			pr_warning("%s: #%u: %u errors with "
 				"src_off=0x%x dst_off=0x%x len=0x%x\n",
@@ -462,6 +487,15 @@ static int dmatest_func(void *data)
 		}
 	}
 
+	/* Only the time spent moving data counts towards the throughput */
+	runtime = ktime_us_delta(ktime_get(), start) - filltime - comparetime;
+	if (runtime <= 0)
+		runtime = 1;
+	pr_info("%s: summary %u tests, %u failures %llu iops %llu KB/s\n",
+			thread_name, total_tests, failed_tests,
+			div64_u64((u64)total_tests * USEC_PER_SEC, runtime),
+			div64_u64(total_len * USEC_PER_SEC, runtime * 1024));
+
 	ret = 0;
 	for (i = 0; thread->dsts[i]; i++)
 		kfree(thread->dsts[i]);
@@ -68,6 +68,14 @@ struct dma_pl330_chan {
 	 * NULL if the channel is available to be acquired.
 	 */
 	void *pl330_chid;
+
+	/* For D-to-M and M-to-D channels, set from DMA_SLAVE_CONFIG */
+	dma_addr_t fifo_addr;
+	int burst_sz; /* in power of 2 */
+	int burst_len;
+
+	/* Descriptors are put back on the work_list once done */
+	bool cyclic;
 };
 
 struct dma_pl330_dmac {
@@ -159,15 +167,19 @@ static inline void fill_queue(struct dma_pl330_chan *pch)
 
 	list_for_each_entry(desc, &pch->work_list, node) {
 
-		/* If already submitted */
-		if (desc->status == BUSY)
-			break;
+		/* If already submitted or waiting to be reaped */
+		if (desc->status == BUSY || desc->status == DONE)
+			continue;
 
+		/*
+		 * Keep feeding the PL330 core until its request queue
+		 * is full, so the next xfer is already loaded when the
+		 * current one finishes.
+		 */
 		ret = pl330_submit_req(pch->pl330_chid,
 						&desc->req);
 		if (!ret) {
 			desc->status = BUSY;
-			break;
 		} else if (ret == -EAGAIN) {
 			/* QFull or DMAC Dying */
 			break;
@@ -185,7 +197,10 @@ static void pl330_tasklet(unsigned long data)
 {
 	struct dma_pl330_chan *pch = (struct dma_pl330_chan *)data;
 	struct dma_pl330_desc *desc, *_dt;
+	dma_async_tx_callback callback = NULL;
+	void *param = NULL;
 	unsigned long flags;
+	int periods = 0;
 	LIST_HEAD(list);
 
 	spin_lock_irqsave(&pch->lock, flags);
@@ -193,10 +208,27 @@ static void pl330_tasklet(unsigned long data)
 	/* Pick up ripe tomatoes */
 	list_for_each_entry_safe(desc, _dt, &pch->work_list, node)
 		if (desc->status == DONE) {
-			pch->completed = desc->txd.cookie;
+			if (!pch->cyclic)
+				pch->completed = desc->txd.cookie;
 			list_move_tail(&desc->node, &list);
 		}
 
+	/*
+	 * A cyclic transfer recycles its periods: they go back to the
+	 * end of the ring before refilling so that the hardware never
+	 * runs dry, and the client is told once per elapsed period.
+	 */
+	if (pch->cyclic && !list_empty(&list)) {
+		list_for_each_entry(desc, &list, node) {
+			desc->status = PREP;
+			periods++;
+		}
+		desc = list_first_entry(&list, struct dma_pl330_desc, node);
+		callback = desc->txd.callback;
+		param = desc->txd.callback_param;
+		list_splice_tail_init(&list, &pch->work_list);
+	}
+
 	/* Try to submit a req imm. next to the last completed cookie */
 	fill_queue(pch);
 
@@ -205,6 +237,10 @@ static void pl330_tasklet(unsigned long data)
 
 	spin_unlock_irqrestore(&pch->lock, flags);
 
+	if (callback)
+		while (periods--)
+			callback(param);
+
 	free_desc_list(&list);
 }
 
@@ -231,11 +267,16 @@ static int pl330_alloc_chan_resources(struct dma_chan *chan)
 {
 	struct dma_pl330_chan *pch = to_pchan(chan);
 	struct dma_pl330_dmac *pdmac = pch->dmac;
+	struct dma_pl330_peri *peri = chan->private;
 	unsigned long flags;
 
 	spin_lock_irqsave(&pch->lock, flags);
 
 	pch->completed = chan->cookie = 1;
+	pch->cyclic = false;
+	pch->fifo_addr = peri->fifo_addr;
+	pch->burst_sz = peri->burst_sz;
+	pch->burst_len = 1;
 
 	pch->pl330_chid = pl330_request_channel(&pdmac->pif);
 	if (!pch->pl330_chid) {
@@ -250,13 +291,48 @@ static int pl330_alloc_chan_resources(struct dma_chan *chan)
 	return 1;
 }
 
+static int pl330_slave_config(struct dma_pl330_chan *pch,
+			      struct dma_slave_config *cfg)
+{
+	enum dma_slave_buswidth width;
+	dma_addr_t addr;
+	u32 maxburst;
+
+	if (cfg->direction == DMA_TO_DEVICE) {
+		addr = cfg->dst_addr;
+		width = cfg->dst_addr_width;
+		maxburst = cfg->dst_maxburst;
+	} else if (cfg->direction == DMA_FROM_DEVICE) {
+		addr = cfg->src_addr;
+		width = cfg->src_addr_width;
+		maxburst = cfg->src_maxburst;
+	} else {
+		return -EINVAL;
+	}
+
+	/* A burst can't be more than 16 beats */
+	if (maxburst > 16)
+		return -EINVAL;
+
+	if (addr)
+		pch->fifo_addr = addr;
+	if (width)
+		pch->burst_sz = __ffs(width);
+	if (maxburst)
+		pch->burst_len = maxburst;
+
+	return 0;
+}
+
 static int pl330_control(struct dma_chan *chan, enum dma_ctrl_cmd cmd, unsigned long arg)
 {
 	struct dma_pl330_chan *pch = to_pchan(chan);
 	struct dma_pl330_desc *desc;
 	unsigned long flags;
 
-	/* Only supports DMA_TERMINATE_ALL */
+	if (cmd == DMA_SLAVE_CONFIG)
+		return pl330_slave_config(pch, (struct dma_slave_config *)arg);
+
 	if (cmd != DMA_TERMINATE_ALL)
 		return -ENXIO;
 
@@ -265,9 +341,16 @@ static int pl330_control(struct dma_chan *chan, enum dma_ctrl_cmd cmd, unsigned
 	/* FLUSH the PL330 Channel thread */
 	pl330_chan_ctrl(pch->pl330_chid, PL330_OP_FLUSH);
 
-	/* Mark all desc done */
-	list_for_each_entry(desc, &pch->work_list, node)
+	/*
+	 * Mark all desc done. Periods of a cyclic transfer are
+	 * returned to the pool without reporting them as elapsed.
+	 */
+	list_for_each_entry(desc, &pch->work_list, node) {
 		desc->status = DONE;
+		if (pch->cyclic)
+			desc->txd.callback = NULL;
+	}
+	pch->cyclic = false;
 
 	spin_unlock_irqrestore(&pch->lock, flags);
 
@@ -287,6 +370,7 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 
 	pl330_release_channel(pch->pl330_chid);
 	pch->pl330_chid = NULL;
+	pch->cyclic = false;
 
 	spin_unlock_irqrestore(&pch->lock, flags);
 }
@@ -302,7 +386,11 @@ pl330_tx_status(struct dma_chan *chan, dma_cookie_t cookie,
 	last_done = pch->completed;
 	last_used = chan->cookie;
 
-	ret = dma_async_is_complete(cookie, last_done, last_used);
+	/* A cyclic transfer never completes */
+	if (pch->cyclic)
+		ret = DMA_IN_PROGRESS;
+	else
+		ret = dma_async_is_complete(cookie, last_done, last_used);
 
 	dma_set_tx_state(txstate, last_done, last_used, 0);
 
@@ -338,6 +426,12 @@ static dma_cookie_t pl330_tx_submit(struct dma_async_tx_descriptor *tx)
 			cookie = 1;
 		desc->txd.cookie = cookie;
 
+		/* Every period of a cyclic transfer reports to the client */
+		if (pch->cyclic) {
+			desc->txd.callback = last->txd.callback;
+			desc->txd.callback_param = last->txd.callback_param;
+		}
+
 		list_move_tail(&desc->node, &pch->work_list);
 	}
 
@@ -564,6 +658,66 @@ pl330_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dst,
 	return &desc->txd;
 }
 
+/* Give back a chain of descriptors that was never submitted */
+static void pl330_put_chain(struct dma_pl330_chan *pch,
+		struct dma_pl330_desc *first)
+{
+	struct dma_pl330_dmac *pdmac = pch->dmac;
+	struct dma_pl330_desc *desc;
+	unsigned long flags;
+
+	if (!first)
+		return;
+
+	spin_lock_irqsave(&pdmac->pool_lock, flags);
+
+	while (!list_empty(&first->node)) {
+		desc = list_entry(first->node.next,
+				struct dma_pl330_desc, node);
+		list_move_tail(&desc->node, &pdmac->desc_pool);
+	}
+
+	list_move_tail(&first->node, &pdmac->desc_pool);
+
+	spin_unlock_irqrestore(&pdmac->pool_lock, flags);
+}
+
+static inline bool pl330_valid_dir(struct dma_pl330_chan *pch,
+		enum dma_data_direction direction)
+{
+	struct dma_pl330_peri *peri = pch->chan.private;
+
+	/* Make sure the direction is consistent */
+	if ((direction == DMA_TO_DEVICE &&
+				peri->rqtype == MEMTODEV) ||
+			(direction == DMA_FROM_DEVICE &&
+				peri->rqtype == DEVTOMEM))
+		return true;
+
+	dev_err(pch->dmac->pif.dev, "%s:%d Invalid Direction\n",
+			__func__, __LINE__);
+	return false;
+}
+
+/* Program one peripheral xfer of the chain between memory and the FIFO */
+static inline void fill_slave_desc(struct dma_pl330_chan *pch,
+		struct dma_pl330_desc *desc, enum dma_data_direction direction,
+		dma_addr_t buf, size_t len)
+{
+	if (direction == DMA_TO_DEVICE) {
+		desc->rqcfg.src_inc = 1;
+		desc->rqcfg.dst_inc = 0;
+		fill_px(&desc->px, pch->fifo_addr, buf, len);
+	} else {
+		desc->rqcfg.src_inc = 0;
+		desc->rqcfg.dst_inc = 1;
+		fill_px(&desc->px, buf, pch->fifo_addr, len);
+	}
+
+	desc->rqcfg.brst_size = pch->burst_sz;
+	desc->rqcfg.brst_len = pch->burst_len;
+}
+
 static struct dma_async_tx_descriptor *
 pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 		unsigned int sg_len, enum dma_data_direction direction,
@@ -571,27 +725,14 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 {
 	struct dma_pl330_desc *first, *desc = NULL;
 	struct dma_pl330_chan *pch = to_pchan(chan);
-	struct dma_pl330_peri *peri = chan->private;
 	struct scatterlist *sg;
-	unsigned long flags;
-	int i, burst_size;
-	dma_addr_t addr;
+	int i;
 
 	if (unlikely(!pch || !sgl || !sg_len))
 		return NULL;
 
-	/* Make sure the direction is consistent */
-	if ((direction == DMA_TO_DEVICE &&
-				peri->rqtype != MEMTODEV) ||
-			(direction == DMA_FROM_DEVICE &&
-				peri->rqtype != DEVTOMEM)) {
-		dev_err(pch->dmac->pif.dev, "%s:%d Invalid Direction\n",
-				__func__, __LINE__);
+	if (!pl330_valid_dir(pch, direction))
 		return NULL;
-	}
-
-	addr = peri->fifo_addr;
-	burst_size = peri->burst_sz;
 
 	first = NULL;
 
@@ -599,26 +740,62 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 
 		desc = pl330_get_desc(pch);
 		if (!desc) {
-			struct dma_pl330_dmac *pdmac = pch->dmac;
-
 			dev_err(pch->dmac->pif.dev,
 				"%s:%d Unable to fetch desc\n",
 				__func__, __LINE__);
-			if (!first)
-				return NULL;
+			pl330_put_chain(pch, first);
+			return NULL;
+		}
+
+		if (!first)
+			first = desc;
+		else
+			list_add_tail(&desc->node, &first->node);
 
-			spin_lock_irqsave(&pdmac->pool_lock, flags);
+		fill_slave_desc(pch, desc, direction,
+				sg_dma_address(sg), sg_dma_len(sg));
+	}
 
-			while (!list_empty(&first->node)) {
-				desc = list_entry(first->node.next,
-						struct dma_pl330_desc, node);
-				list_move_tail(&desc->node, &pdmac->desc_pool);
-			}
+	/* Return the last desc in the chain */
+	desc->txd.flags = flg;
+	return &desc->txd;
+}
 
-			list_move_tail(&first->node, &pdmac->desc_pool);
+/*
+ * The buffer is split into one descriptor per period, all of them are
+ * handed to the PL330 core back to back and each one is put back on the
+ * channel's work_list as soon as it is done, so the ring keeps running
+ * without any intervention from the client.
+ */
+static struct dma_async_tx_descriptor *
+pl330_prep_dma_cyclic(struct dma_chan *chan, dma_addr_t buf_addr,
+		size_t buf_len, size_t period_len,
+		enum dma_data_direction direction)
+{
+	struct dma_pl330_desc *first = NULL, *desc = NULL;
+	struct dma_pl330_chan *pch = to_pchan(chan);
+	size_t off;
 
-			spin_unlock_irqrestore(&pdmac->pool_lock, flags);
+	if (unlikely(!pch || !period_len || buf_len < period_len))
+		return NULL;
 
+	if (buf_len % period_len) {
+		dev_err(pch->dmac->pif.dev,
+			"%s:%d Buffer not a multiple of the period\n",
+			__func__, __LINE__);
+		return NULL;
+	}
+
+	if (!pl330_valid_dir(pch, direction))
+		return NULL;
+
+	for (off = 0; off < buf_len; off += period_len) {
+		desc = pl330_get_desc(pch);
+		if (!desc) {
+			dev_err(pch->dmac->pif.dev,
+				"%s:%d Unable to fetch desc\n",
+				__func__, __LINE__);
+			pl330_put_chain(pch, first);
 			return NULL;
 		}
 
@@ -627,24 +804,13 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 		else
 			list_add_tail(&desc->node, &first->node);
 
-		if (direction == DMA_TO_DEVICE) {
-			desc->rqcfg.src_inc = 1;
-			desc->rqcfg.dst_inc = 0;
-			fill_px(&desc->px,
-				addr, sg_dma_address(sg), sg_dma_len(sg));
-		} else {
-			desc->rqcfg.src_inc = 0;
-			desc->rqcfg.dst_inc = 1;
-			fill_px(&desc->px,
-				sg_dma_address(sg), addr, sg_dma_len(sg));
-		}
-
-		desc->rqcfg.brst_size = burst_size;
-		desc->rqcfg.brst_len = 1;
+		fill_slave_desc(pch, desc, direction,
+				buf_addr + off, period_len);
 	}
 
+	pch->cyclic = true;
+
 	/* Return the last desc in the chain */
-	desc->txd.flags = flg;
 	return &desc->txd;
 }
 
@@ -728,6 +894,7 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		case MEMTODEV:
 		case DEVTOMEM:
 			dma_cap_set(DMA_SLAVE, pd->cap_mask);
+			dma_cap_set(DMA_CYCLIC, pd->cap_mask);
 			break;
 		default:
 			dev_err(&adev->dev, "DEVTODEV Not Supported\n");
@@ -754,6 +921,7 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 	pd->device_prep_dma_memcpy = pl330_prep_dma_memcpy;
 	pd->device_tx_status = pl330_tx_status;
 	pd->device_prep_slave_sg = pl330_prep_slave_sg;
+	pd->device_prep_dma_cyclic = pl330_prep_dma_cyclic;
 	pd->device_control = pl330_control;
 	pd->device_issue_pending = pl330_issue_pending;
 
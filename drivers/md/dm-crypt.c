@@ -17,6 +17,8 @@
 #include <linux/slab.h>
 #include <linux/crypto.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/rbtree.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
 #include <asm/atomic.h>
@@ -61,6 +63,12 @@ struct dm_crypt_io {
 	int error;
 	sector_t sector;
 	struct dm_crypt_io *base_io;
+
+	/* CPU the bio was submitted on, reads are decrypted there */
+	int cpu;
+
+	/* in the write tree until dmcrypt_write submits the clone */
+	struct rb_node rb_node;
 };
 
 struct dm_crypt_request {
@@ -135,6 +143,14 @@ struct crypt_config {
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
+	/*
+	 * Encrypted writes, sorted by sector, waiting for the write
+	 * thread.  The tree is protected by write_thread_wait.lock.
+	 */
+	struct task_struct *write_thread;
+	wait_queue_head_t write_thread_wait;
+	struct rb_root write_tree;
+
 	char *cipher;
 	char *cipher_string;
 
@@ -147,6 +163,13 @@ struct crypt_config {
 	sector_t iv_offset;
 	unsigned int iv_size;
 
+	/*
+	 * Set when there is neither an IV nor a per sector key (ecb with
+	 * one key): then a crypto request may span a whole bio_vec
+	 * instead of a single sector.
+	 */
+	unsigned int batch;
+
 	/*
 	 * Duplicated per cpu state. Access through
 	 * per_cpu_ptr() only.
@@ -689,9 +712,27 @@ static u8 *iv_of_dmreq(struct crypt_config *cc,
 		crypto_ablkcipher_alignmask(any_tfm(cc)) + 1);
 }
 
+/*
+ * Bytes to process with the next request: one sector, or with batching
+ * everything up to the end of the current input or output bio_vec.
+ */
+static unsigned int crypt_convert_len(struct crypt_config *cc,
+				      struct convert_context *ctx)
+{
+	struct bio_vec *bv_in = bio_iovec_idx(ctx->bio_in, ctx->idx_in);
+	struct bio_vec *bv_out = bio_iovec_idx(ctx->bio_out, ctx->idx_out);
+
+	if (!cc->batch)
+		return 1 << SECTOR_SHIFT;
+
+	return min(bv_in->bv_len - ctx->offset_in,
+		   bv_out->bv_len - ctx->offset_out);
+}
+
 static int crypt_convert_block(struct crypt_config *cc,
 			       struct convert_context *ctx,
-			       struct ablkcipher_request *req)
+			       struct ablkcipher_request *req,
+			       unsigned int len)
 {
 	struct bio_vec *bv_in = bio_iovec_idx(ctx->bio_in, ctx->idx_in);
 	struct bio_vec *bv_out = bio_iovec_idx(ctx->bio_out, ctx->idx_out);
@@ -705,20 +746,20 @@ static int crypt_convert_block(struct crypt_config *cc,
 	dmreq->iv_sector = ctx->sector;
 	dmreq->ctx = ctx;
 	sg_init_table(&dmreq->sg_in, 1);
-	sg_set_page(&dmreq->sg_in, bv_in->bv_page, 1 << SECTOR_SHIFT,
+	sg_set_page(&dmreq->sg_in, bv_in->bv_page, len,
 		    bv_in->bv_offset + ctx->offset_in);
 
 	sg_init_table(&dmreq->sg_out, 1);
-	sg_set_page(&dmreq->sg_out, bv_out->bv_page, 1 << SECTOR_SHIFT,
+	sg_set_page(&dmreq->sg_out, bv_out->bv_page, len,
 		    bv_out->bv_offset + ctx->offset_out);
 
-	ctx->offset_in += 1 << SECTOR_SHIFT;
+	ctx->offset_in += len;
 	if (ctx->offset_in >= bv_in->bv_len) {
 		ctx->offset_in = 0;
 		ctx->idx_in++;
 	}
 
-	ctx->offset_out += 1 << SECTOR_SHIFT;
+	ctx->offset_out += len;
 	if (ctx->offset_out >= bv_out->bv_len) {
 		ctx->offset_out = 0;
 		ctx->idx_out++;
@@ -731,7 +772,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 	}
 
 	ablkcipher_request_set_crypt(req, &dmreq->sg_in, &dmreq->sg_out,
-				     1 << SECTOR_SHIFT, iv);
+				     len, iv);
 
 	if (bio_data_dir(ctx->bio_in) == WRITE)
 		r = crypto_ablkcipher_encrypt(req);
@@ -769,6 +810,7 @@ static int crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx)
 {
 	struct crypt_cpu *this_cc = this_crypt_config(cc);
+	unsigned int len;
 	int r;
 
 	atomic_set(&ctx->pending, 1);
@@ -780,7 +822,8 @@ static int crypt_convert(struct crypt_config *cc,
 
 		atomic_inc(&ctx->pending);
 
-		r = crypt_convert_block(cc, ctx, this_cc->req);
+		len = crypt_convert_len(cc, ctx);
+		r = crypt_convert_block(cc, ctx, this_cc->req, len);
 
 		switch (r) {
 		/* async */
@@ -790,13 +833,13 @@ static int crypt_convert(struct crypt_config *cc,
 			/* fall through*/
 		case -EINPROGRESS:
 			this_cc->req = NULL;
-			ctx->sector++;
+			ctx->sector += len >> SECTOR_SHIFT;
 			continue;
 
 		/* sync */
 		case 0:
 			atomic_dec(&ctx->pending);
-			ctx->sector++;
+			ctx->sector += len >> SECTOR_SHIFT;
 			cond_resched();
 			continue;
 
@@ -899,6 +942,7 @@ static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 	io->sector = sector;
 	io->error = 0;
 	io->base_io = NULL;
+	io->cpu = raw_smp_processor_id();
 	atomic_set(&io->pending, 0);
 
 	return io;
@@ -943,14 +987,15 @@ static void crypt_dec_pending(struct dm_crypt_io *io)
  *
  * kcryptd performs the actual encryption or decryption.
  *
- * kcryptd_io performs the IO submission.
+ * kcryptd_io submits reads that could not be allocated in crypt_map,
+ * dmcrypt_write submits the encrypted writes in sector order.
  *
  * They must be separated as otherwise the final stages could be
  * starved by new requests which can block in the first stages due
  * to memory allocation.
  *
- * The work is done per CPU global for all dm-crypt instances.
- * They should not depend on each other and do not block.
+ * The crypt work runs on the CPU that submitted the bio, one item at a
+ * time per CPU.  They should not depend on each other and do not block.
  */
 static void crypt_endio(struct bio *clone, int error)
 {
@@ -1026,17 +1071,73 @@ static void kcryptd_io_write(struct dm_crypt_io *io)
 	generic_make_request(clone);
 }
 
+static int dmcrypt_write(void *data)
+{
+	struct crypt_config *cc = data;
+	struct dm_crypt_io *io;
+
+	while (1) {
+		struct rb_root write_tree;
+		struct blk_plug plug;
+
+		DECLARE_WAITQUEUE(wait, current);
+
+		spin_lock_irq(&cc->write_thread_wait.lock);
+continue_locked:
+
+		if (!RB_EMPTY_ROOT(&cc->write_tree))
+			goto pop_from_list;
+
+		__set_current_state(TASK_INTERRUPTIBLE);
+		__add_wait_queue(&cc->write_thread_wait, &wait);
+
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		if (unlikely(kthread_should_stop())) {
+			set_task_state(current, TASK_RUNNING);
+			remove_wait_queue(&cc->write_thread_wait, &wait);
+			break;
+		}
+
+		schedule();
+
+		set_task_state(current, TASK_RUNNING);
+		spin_lock_irq(&cc->write_thread_wait.lock);
+		__remove_wait_queue(&cc->write_thread_wait, &wait);
+		goto continue_locked;
+
+pop_from_list:
+		write_tree = cc->write_tree;
+		cc->write_tree = RB_ROOT;
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		BUG_ON(rb_parent(write_tree.rb_node));
+
+		/*
+		 * Note: we cannot walk the tree here with rb_next because
+		 * the structures may be freed when kcryptd_io_write is called.
+		 */
+		blk_start_plug(&plug);
+		do {
+			io = rb_entry(rb_first(&write_tree),
+				      struct dm_crypt_io, rb_node);
+			rb_erase(&io->rb_node, &write_tree);
+			kcryptd_io_write(io);
+		} while (!RB_EMPTY_ROOT(&write_tree));
+		blk_finish_plug(&plug);
+	}
+
+	return 0;
+}
+
 static void kcryptd_io(struct work_struct *work)
 {
 	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
 
-	if (bio_data_dir(io->base_bio) == READ) {
-		crypt_inc_pending(io);
-		if (kcryptd_io_read(io, GFP_NOIO))
-			io->error = -ENOMEM;
-		crypt_dec_pending(io);
-	} else
-		kcryptd_io_write(io);
+	crypt_inc_pending(io);
+	if (kcryptd_io_read(io, GFP_NOIO))
+		io->error = -ENOMEM;
+	crypt_dec_pending(io);
 }
 
 static void kcryptd_queue_io(struct dm_crypt_io *io)
@@ -1047,11 +1148,12 @@ static void kcryptd_queue_io(struct dm_crypt_io *io)
 	queue_work(cc->io_queue, &io->work);
 }
 
-static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io,
-					  int error, int async)
+static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int error)
 {
 	struct bio *clone = io->ctx.bio_out;
 	struct crypt_config *cc = io->target->private;
+	struct rb_node **rbp, *parent;
+	unsigned long flags;
 
 	if (unlikely(error < 0)) {
 		crypt_free_buffer_pages(cc, clone);
@@ -1066,10 +1168,27 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io,
 
 	clone->bi_sector = cc->start + io->sector;
 
-	if (async)
-		kcryptd_queue_io(io);
-	else
-		generic_make_request(clone);
+	/*
+	 * Encryption finishes out of order, on several CPUs or in the
+	 * crypto driver, so hand the clone to the write thread, which
+	 * submits whatever has accumulated in sector order.
+	 */
+	spin_lock_irqsave(&cc->write_thread_wait.lock, flags);
+	rbp = &cc->write_tree.rb_node;
+	parent = NULL;
+	while (*rbp) {
+		parent = *rbp;
+		if (io->sector < rb_entry(parent, struct dm_crypt_io,
+					  rb_node)->sector)
+			rbp = &(*rbp)->rb_left;
+		else
+			rbp = &(*rbp)->rb_right;
+	}
+	rb_link_node(&io->rb_node, parent, rbp);
+	rb_insert_color(&io->rb_node, &cc->write_tree);
+
+	wake_up_locked(&cc->write_thread_wait);
+	spin_unlock_irqrestore(&cc->write_thread_wait.lock, flags);
 }
 
 static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
@@ -1112,7 +1231,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 
 		/* Encryption was already finished, submit io now */
 		if (crypt_finished) {
-			kcryptd_crypt_write_io_submit(io, r, 0);
+			kcryptd_crypt_write_io_submit(io, r);
 
 			/*
 			 * If there was an error, do not try next fragments.
@@ -1120,8 +1239,6 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			 */
 			if (unlikely(r < 0))
 				break;
-
-			io->sector = sector;
 		}
 
 		/*
@@ -1132,10 +1249,11 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			congestion_wait(BLK_RW_ASYNC, HZ/100);
 
 		/*
-		 * With async crypto it is unsafe to share the crypto context
-		 * between fragments, so switch to a new dm_crypt_io structure.
+		 * Once submitted to the write thread, or still in flight
+		 * with async crypto, the io can't be reused for the next
+		 * fragment, so switch to a new dm_crypt_io structure.
 		 */
-		if (unlikely(!crypt_finished && remaining)) {
+		if (unlikely(remaining)) {
 			new_io = crypt_io_alloc(io->target, io->base_bio,
 						sector);
 			crypt_inc_pending(new_io);
@@ -1213,7 +1331,7 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 	if (bio_data_dir(io->base_bio) == READ)
 		kcryptd_crypt_read_done(io, error);
 	else
-		kcryptd_crypt_write_io_submit(io, error, 1);
+		kcryptd_crypt_write_io_submit(io, error);
 }
 
 static void kcryptd_crypt(struct work_struct *work)
@@ -1231,7 +1349,17 @@ static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 	struct crypt_config *cc = io->target->private;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
-	queue_work(cc->crypt_queue, &io->work);
+
+	/*
+	 * Reads complete on whichever CPU takes the disk interrupt: send
+	 * the decryption back to the CPU that submitted the bio, so that
+	 * the work is spread as the submitters are and the data ends up
+	 * in the cache of the CPU that wants it.
+	 */
+	if (likely(cpu_online(io->cpu)))
+		queue_work_on(io->cpu, cc->crypt_queue, &io->work);
+	else
+		queue_work(cc->crypt_queue, &io->work);
 }
 
 /*
@@ -1368,6 +1496,9 @@ static void crypt_dtr(struct dm_target *ti)
 	if (!cc)
 		return;
 
+	if (cc->write_thread)
+		kthread_stop(cc->write_thread);
+
 	if (cc->io_queue)
 		destroy_workqueue(cc->io_queue);
 	if (cc->crypt_queue)
@@ -1513,6 +1644,8 @@ static int crypt_ctr_cipher(struct dm_target *ti,
 		ivmode = NULL;
 	}
 
+	cc->batch = !cc->iv_size && cc->tfms_count == 1;
+
 	/* Choose ivmode, see comments at iv code. */
 	if (ivmode == NULL)
 		cc->iv_gen_ops = NULL;
@@ -1658,6 +1791,10 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	/*
+	 * Bound, one active item per CPU: crypt_convert uses the per CPU
+	 * request in crypt_cpu, so each CPU may only run one at a time.
+	 */
 	cc->crypt_queue = alloc_workqueue("kcryptd",
 					  WQ_NON_REENTRANT|
 					  WQ_CPU_INTENSIVE|
@@ -1668,6 +1805,18 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	init_waitqueue_head(&cc->write_thread_wait);
+	cc->write_tree = RB_ROOT;
+
+	cc->write_thread = kthread_create(dmcrypt_write, cc, "dmcrypt_write");
+	if (IS_ERR(cc->write_thread)) {
+		ret = PTR_ERR(cc->write_thread);
+		cc->write_thread = NULL;
+		ti->error = "Couldn't spawn write thread";
+		goto bad;
+	}
+	wake_up_process(cc->write_thread);
+
 	ti->num_flush_requests = 1;
 	return 0;
 
@@ -1823,7 +1972,7 @@ static int crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 10, 0},
+	.version = {1, 10, 1},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
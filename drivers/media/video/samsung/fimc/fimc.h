@@ -17,6 +17,8 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/i2c.h>
 #include <linux/fb.h>
 #include <linux/videodev2.h>
@@ -27,6 +29,7 @@
 #include <media/videobuf-core.h>
 #include <plat/media.h>
 #include <plat/fimc.h>
+#include <plat/dmabuf.h>
 #endif
 
 #define FIMC_NAME		"s3c-fimc"
@@ -176,6 +179,7 @@ struct fimc_buf_set {
 	u32			flags;
 	atomic_t		mapped_cnt;
 	struct list_head	list;
+	struct s5p_dmabuf_import dmabuf;	/* V4L2_MEMORY_DMABUF source */
 };
 
 /* for capture device */
@@ -364,6 +368,30 @@ struct fimc_effect {
 	int pat_cr;
 };
 
+/*
+ * output (mem-to-mem) statistics, reported through debugfs
+ * @lock:	protects the fields below against the interrupt handler
+ * @frames:	frames completed since the last reset
+ * @staged:	frames started from addresses staged before completion
+ * @busy_ns:	time the scaler spent processing frames
+ * @irq_ns:	CPU time spent in the completion interrupt
+ * @max_gap_ns:	longest gap between a completion and the next start
+ * @reset:	time of the last reset
+ * @started:	start of the frame in flight
+ * @done:	completion of the last frame
+*/
+struct fimc_out_stats {
+	spinlock_t	lock;
+	u64		frames;
+	u64		staged;
+	u64		busy_ns;
+	u64		irq_ns;
+	u64		max_gap_ns;
+	ktime_t		reset;
+	ktime_t		started;
+	ktime_t		done;
+};
+
 /* fimc controller abstration */
 struct fimc_control {
 	int				id;		/* controller id */
@@ -373,6 +401,7 @@ struct fimc_control {
 	struct clk			*clk;		/* interface clock */
 	struct regulator	*regulator;		/* pd regulator */
 	struct fimc_meminfo		mem;		/* for reserved mem */
+	atomic_t			cap_exports;	/* live dma-bufs in mem */
 
 	/* kernel helpers */
 	struct mutex			lock;		/* controller lock */
@@ -399,6 +428,9 @@ struct fimc_control {
 	enum fimc_log			log;
 
 	u32				ctx_busy[FIMC_MAX_CTXS];
+
+	struct fimc_out_stats		out_stats;
+	struct dentry			*debugfs;
 };
 
 /* global */
@@ -504,6 +536,7 @@ extern int fimc_try_fmt_vid_capture(struct file *file, void *fh,
 					struct v4l2_format *f);
 extern int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b);
 extern int fimc_querybuf_capture(void *fh, struct v4l2_buffer *b);
+extern int fimc_expbuf_capture(void *fh, struct v4l2_exportbuffer *e);
 extern int fimc_g_ctrl_capture(void *fh, struct v4l2_control *c);
 extern int fimc_s_ctrl_capture(void *fh, struct v4l2_control *c);
 extern int fimc_s_ext_ctrls_capture(void *fh, struct v4l2_ext_controls *c);
@@ -543,6 +576,9 @@ extern int fimc_outdev_stop_streaming(struct fimc_control *ctrl,
 extern int fimc_outdev_resume_dma(struct fimc_control *ctrl,
 					struct fimc_ctx *ctx);
 extern int fimc_outdev_start_camif(void *param);
+extern int fimc_outdev_stage_next(struct fimc_control *ctrl);
+extern struct fimc_ctx *fimc_outdev_start_next(struct fimc_control *ctrl);
+extern void fimc_outdev_reset_stats(struct fimc_control *ctrl);
 extern int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b);
 extern int fimc_querybuf_output(void *fh, struct v4l2_buffer *b);
 extern int fimc_g_ctrl_output(void *fh, struct v4l2_control *c);
@@ -573,6 +609,7 @@ extern int fimc_pop_outq(struct fimc_control *ctrl,
 					struct fimc_ctx *ctx, int *idx);
 extern int fimc_init_out_queue(struct fimc_control *ctrl, struct fimc_ctx *ctx);
 extern void fimc_outdev_init_idxs(struct fimc_control *ctrl);
+extern void fimc_outdev_release_dmabufs(struct fimc_ctx *ctx);
 
 extern void fimc_dump_context(struct fimc_control *ctrl, struct fimc_ctx *ctx);
 extern void fimc_print_signal(struct fimc_control *ctrl);
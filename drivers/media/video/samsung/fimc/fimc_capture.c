@@ -992,6 +992,12 @@ int fimc_reqbufs_capture(void *fh, struct v4l2_requestbuffers *b)
 
 	mutex_lock(&ctrl->v4l2_lock);
 
+	/* exported buffers are still in use by their importers */
+	if (atomic_read(&ctrl->cap_exports)) {
+		mutex_unlock(&ctrl->v4l2_lock);
+		return -EBUSY;
+	}
+
 	if (b->count < 1 || b->count > FIMC_CAPBUFS)
 		return -EINVAL;
 
@@ -1121,6 +1127,62 @@ int fimc_querybuf_capture(void *fh, struct v4l2_buffer *b)
 	return 0;
 }
 
+static void fimc_expbuf_release(void *priv)
+{
+	struct fimc_control *ctrl = priv;
+
+	atomic_dec(&ctrl->cap_exports);
+}
+
+int fimc_expbuf_capture(void *fh, struct v4l2_exportbuffer *e)
+{
+	struct fimc_control *ctrl = ((struct fimc_prv_data *)fh)->ctrl;
+	struct fimc_buf_set *buf;
+	dma_addr_t end = 0;
+	int plane, ret;
+
+	if (!ctrl->cap) {
+		fimc_err("%s: no capture device info\n", __func__);
+		return -ENODEV;
+	}
+
+	if (e->index >= ctrl->cap->nr_bufs) {
+		fimc_err("%s: invalid buffer index(%d)\n", __func__, e->index);
+		return -EINVAL;
+	}
+
+	mutex_lock(&ctrl->v4l2_lock);
+
+	/* planes are carved out of the reserved area back to back */
+	buf = &ctrl->cap->bufs[e->index];
+	for (plane = 0; plane < 4; plane++) {
+		if (buf->length[plane])
+			end = max_t(dma_addr_t, end,
+				    buf->base[plane] + buf->length[plane]);
+	}
+
+	if (!buf->base[FIMC_ADDR_Y]) {
+		ret = -EINVAL;
+	} else {
+		/* the reserved area is not handed out again until released */
+		atomic_inc(&ctrl->cap_exports);
+		ret = s5p_dmabuf_export_fd(buf->base[FIMC_ADDR_Y],
+				PAGE_ALIGN(end - buf->base[FIMC_ADDR_Y]), 0,
+				fimc_expbuf_release, ctrl);
+	}
+
+	mutex_unlock(&ctrl->v4l2_lock);
+
+	if (ret < 0) {
+		fimc_err("%s: export fail(%d)\n", __func__, ret);
+		return ret;
+	}
+
+	e->fd = ret;
+
+	return 0;
+}
+
 int fimc_g_ctrl_capture(void *fh, struct v4l2_control *c)
 {
 	struct fimc_control *ctrl = ((struct fimc_prv_data *)fh)->ctrl;
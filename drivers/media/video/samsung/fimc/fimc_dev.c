@@ -28,6 +28,9 @@
 #include <linux/ctype.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <plat/clock.h>
 #include <plat/media.h>
 #include <mach/media.h>
@@ -197,7 +200,8 @@ static inline u32 fimc_irq_out_single_buf(struct fimc_control *ctrl,
 static inline u32 fimc_irq_out_multi_buf(struct fimc_control *ctrl,
 					 struct fimc_ctx *ctx)
 {
-	int ret = -1, ctx_num, next;
+	struct fimc_ctx *next_ctx;
+	int ret = -1, idx = ctrl->out->idxs.active.idx;
 	u32 wakeup = 1;
 
 	if (ctx->status == FIMC_READY_OFF) {
@@ -211,32 +215,20 @@ static inline u32 fimc_irq_out_multi_buf(struct fimc_control *ctrl,
 		return wakeup;
 	}
 
+	/* Restart the scaler before handling the done buffer. */
+	next_ctx = fimc_outdev_start_next(ctrl);
+
 	/* Attach done buffer to outgoing queue. */
-	ret = fimc_push_outq(ctrl, ctx, ctrl->out->idxs.active.idx);
+	ret = fimc_push_outq(ctrl, ctx, idx);
 	if (ret < 0)
 		fimc_err("Failed: fimc_push_outq\n");
 
-	/* Detach buffer from incomming queue. */
-	ret = fimc_pop_inq(ctrl, &ctx_num, &next);
-	if (ret == 0) {		/* There is a buffer in incomming queue. */
-		if (ctx_num != ctrl->out->last_ctx) {
-			ctx = &ctrl->out->ctx[ctx_num];
-			ctrl->out->last_ctx = ctx->ctx_num;
-			fimc_outdev_set_ctx_param(ctrl, ctx);
-		}
-
-		fimc_outdev_set_src_addr(ctrl, ctx->src[next].base);
-
-		fimc_output_set_dst_addr(ctrl, ctx, next);
-
-		ret = fimc_outdev_start_camif(ctrl);
-		if (ret < 0)
-			fimc_err("Fail: fimc_start_camif\n");
-
-		ctrl->out->idxs.active.ctx = ctx_num;
-		ctrl->out->idxs.active.idx = next;
-		ctx->status = FIMC_STREAMON;
+	if (next_ctx) {		/* There was a buffer in incomming queue. */
+		next_ctx->status = FIMC_STREAMON;
 		ctrl->status = FIMC_STREAMON;
+
+		/* Program the following buffer while this one is processed. */
+		fimc_outdev_stage_next(ctrl);
 	} else {	/* There is no buffer in incomming queue. */
 		ctrl->out->idxs.active.ctx = -1;
 		ctrl->out->idxs.active.idx = -1;
@@ -250,9 +242,9 @@ static inline u32 fimc_irq_out_multi_buf(struct fimc_control *ctrl,
 static inline u32 fimc_irq_out_dma(struct fimc_control *ctrl,
 				   struct fimc_ctx *ctx)
 {
-	struct fimc_buf_set buf_set;
+	struct fimc_ctx *next_ctx;
 	int idx = ctrl->out->idxs.active.idx;
-	int ret = -1, i, ctx_num, next;
+	int ret = -1;
 	u32 wakeup = 1;
 
 	if (ctx->status == FIMC_READY_OFF) {
@@ -263,11 +255,25 @@ static inline u32 fimc_irq_out_dma(struct fimc_control *ctrl,
 		return wakeup;
 	}
 
+	/* Restart the scaler before handling the done buffer. */
+	next_ctx = fimc_outdev_start_next(ctrl);
+
 	/* Attach done buffer to outgoing queue. */
 	ret = fimc_push_outq(ctrl, ctx, idx);
 	if (ret < 0)
 		fimc_err("Failed: fimc_push_outq\n");
 
+	if (next_ctx) {		/* There was a buffer in incomming queue. */
+		next_ctx->status = FIMC_STREAMON;
+		ctrl->status = FIMC_STREAMON;
+	} else {		/* There is no buffer in incomming queue. */
+		ctrl->out->idxs.active.ctx = -1;
+		ctrl->out->idxs.active.idx = -1;
+
+		ctx->status = FIMC_STREAMON_IDLE;
+		ctrl->status = FIMC_STREAMON_IDLE;
+	}
+
 	if (ctx->overlay.mode == FIMC_OVLY_DMA_AUTO) {
 		struct s3cfb_window *win;
 		struct fb_info *fbinfo;
@@ -285,34 +291,9 @@ static inline u32 fimc_irq_out_dma(struct fimc_control *ctrl,
 		}
 	}
 
-	/* Detach buffer from incomming queue. */
-	ret = fimc_pop_inq(ctrl, &ctx_num, &next);
-	if (ret == 0) {		/* There is a buffer in incomming queue. */
-		ctx = &ctrl->out->ctx[ctx_num];
-		fimc_outdev_set_src_addr(ctrl, ctx->src[next].base);
-
-		memset(&buf_set, 0x00, sizeof(buf_set));
-		buf_set.base[FIMC_ADDR_Y] = ctx->dst[next].base[FIMC_ADDR_Y];
-
-		for (i = 0; i < FIMC_PHYBUFS; i++)
-			fimc_hwset_output_address(ctrl, &buf_set, i);
-
-		ret = fimc_outdev_start_camif(ctrl);
-		if (ret < 0)
-			fimc_err("Fail: fimc_start_camif\n");
-
-		ctrl->out->idxs.active.ctx = ctx_num;
-		ctrl->out->idxs.active.idx = next;
-
-		ctx->status = FIMC_STREAMON;
-		ctrl->status = FIMC_STREAMON;
-	} else {		/* There is no buffer in incomming queue. */
-		ctrl->out->idxs.active.ctx = -1;
-		ctrl->out->idxs.active.idx = -1;
-
-		ctx->status = FIMC_STREAMON_IDLE;
-		ctrl->status = FIMC_STREAMON_IDLE;
-	}
+	/* Program the following buffer while this one is processed. */
+	if (next_ctx)
+		fimc_outdev_stage_next(ctrl);
 
 	return wakeup;
 }
@@ -363,11 +344,39 @@ static inline u32 fimc_irq_out_fimd(struct fimc_control *ctrl,
 	return wakeup;
 }
 
+static inline void fimc_irq_out_stats(struct fimc_control *ctrl,
+				      ktime_t done, int staged)
+{
+	struct fimc_out_stats *st = &ctrl->out_stats;
+	s64 gap;
+
+	spin_lock(&st->lock);
+
+	st->frames++;
+	st->busy_ns += ktime_to_ns(ktime_sub(done, st->started));
+	st->done = done;
+
+	/* a new frame was started from this handler */
+	gap = ktime_to_ns(ktime_sub(st->started, done));
+	if (gap >= 0) {
+		if (gap > st->max_gap_ns)
+			st->max_gap_ns = gap;
+		if (staged)
+			st->staged++;
+	}
+
+	st->irq_ns += ktime_to_ns(ktime_sub(ktime_get(), done));
+
+	spin_unlock(&st->lock);
+}
+
 static inline void fimc_irq_out(struct fimc_control *ctrl)
 {
 	struct fimc_ctx *ctx;
+	ktime_t done = ktime_get();
 	u32 wakeup = 1;
 	int ctx_num = ctrl->out->idxs.active.ctx;
+	int staged;
 
 	/* Interrupt pendding clear */
 	fimc_hwset_clear_irq(ctrl);
@@ -380,6 +389,8 @@ static inline void fimc_irq_out(struct fimc_control *ctrl)
 	}
 
 	ctx = &ctrl->out->ctx[ctx_num];
+	staged = (ctrl->out->idxs.next.idx != -1 &&
+		  ctrl->out->idxs.next.ctx == ctrl->out->last_ctx);
 
 	switch (ctx->overlay.mode) {
 	case FIMC_OVLY_NONE_SINGLE_BUF:
@@ -398,6 +409,8 @@ static inline void fimc_irq_out(struct fimc_control *ctrl)
 		break;
 	}
 
+	fimc_irq_out_stats(ctrl, done, staged);
+
 	if (wakeup == 1)
 		wake_up(&ctrl->wq);
 }
@@ -493,6 +506,8 @@ struct fimc_control *fimc_register_controller(struct platform_device *pdev)
 	mutex_init(&ctrl->alloc_lock);
 	mutex_init(&ctrl->v4l2_lock);
 	init_waitqueue_head(&ctrl->wq);
+	spin_lock_init(&ctrl->out_stats.lock);
+	fimc_outdev_reset_stats(ctrl);
 
 	/* get resource for io memory */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -1076,6 +1091,8 @@ static int fimc_release(struct file *filp)
 			}
 		}
 
+		fimc_outdev_release_dmabufs(ctx);
+
 		ctrl->ctx_busy[ctx_id] = 0;
 		memset(ctx, 0x00, sizeof(struct fimc_ctx));
 
@@ -1316,6 +1333,95 @@ static DEVICE_ATTR(log_level, 0644, \
 			fimc_show_log_level,
 			fimc_store_log_level);
 
+#ifdef CONFIG_DEBUG_FS
+static int fimc_stats_show(struct seq_file *s, void *unused)
+{
+	struct fimc_control *ctrl = s->private;
+	struct fimc_out_stats *st = &ctrl->out_stats;
+	u64 frames, staged, busy_ns, irq_ns, max_gap_ns, elapsed;
+	unsigned long flags, fps, busy, cpu;
+
+	spin_lock_irqsave(&st->lock, flags);
+	frames = st->frames;
+	staged = st->staged;
+	busy_ns = st->busy_ns;
+	irq_ns = st->irq_ns;
+	max_gap_ns = st->max_gap_ns;
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), st->reset));
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	if (!elapsed)
+		elapsed = 1;
+
+	/* fps in 1/100 units, loads in 1/10 percent */
+	fps = div64_u64(frames * 100 * NSEC_PER_SEC, elapsed);
+	busy = div64_u64(busy_ns * 1000, elapsed);
+	cpu = div64_u64(irq_ns * 1000, elapsed);
+
+	seq_printf(s, "frames:      %llu\n", frames);
+	seq_printf(s, "staged:      %llu\n", staged);
+	seq_printf(s, "fps:         %lu.%02lu\n", fps / 100, fps % 100);
+	seq_printf(s, "busy:        %lu.%lu%%\n", busy / 10, busy % 10);
+	seq_printf(s, "cpu (irq):   %lu.%lu%%\n", cpu / 10, cpu % 10);
+	seq_printf(s, "max gap:     %llu us\n",
+			div64_u64(max_gap_ns, NSEC_PER_USEC));
+	seq_printf(s, "elapsed:     %llu ms\n",
+			div64_u64(elapsed, NSEC_PER_MSEC));
+
+	return 0;
+}
+
+static int fimc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fimc_stats_show, inode->i_private);
+}
+
+/* any write restarts the measurement */
+static ssize_t fimc_stats_write(struct file *file, const char __user *buf,
+				size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+
+	fimc_outdev_reset_stats(s->private);
+
+	return len;
+}
+
+static const struct file_operations fimc_stats_fops = {
+	.open		= fimc_stats_open,
+	.read		= seq_read,
+	.write		= fimc_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void fimc_debugfs_init(struct fimc_control *ctrl)
+{
+	ctrl->debugfs = debugfs_create_dir(ctrl->name, NULL);
+	if (IS_ERR_OR_NULL(ctrl->debugfs)) {
+		ctrl->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("output_stats", 0644, ctrl->debugfs, ctrl,
+			    &fimc_stats_fops);
+}
+
+static void fimc_debugfs_exit(struct fimc_control *ctrl)
+{
+	debugfs_remove_recursive(ctrl->debugfs);
+	ctrl->debugfs = NULL;
+}
+#else
+static inline void fimc_debugfs_init(struct fimc_control *ctrl)
+{
+}
+
+static inline void fimc_debugfs_exit(struct fimc_control *ctrl)
+{
+}
+#endif
+
 static int __devinit fimc_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fimc *pdata;
@@ -1402,6 +1508,9 @@ static int __devinit fimc_probe(struct platform_device *pdev)
 		fimc_err("failed to add sysfs entries\n");
 		goto err_global;
 	}
+
+	fimc_debugfs_init(ctrl);
+
 	printk(KERN_INFO "FIMC%d registered successfully\n", ctrl->id);
 
 	return 0;
@@ -1423,6 +1532,7 @@ err_alloc:
 
 static int fimc_remove(struct platform_device *pdev)
 {
+	fimc_debugfs_exit(get_fimc_ctrl(pdev->id));
 	fimc_unregister_controller(pdev);
 
 	device_remove_file(&(pdev->dev), &dev_attr_log_level);
@@ -64,6 +64,8 @@ int fimc_outdev_start_camif(void *param)
 {
 	struct fimc_control *ctrl = (struct fimc_control *)param;
 
+	ctrl->out_stats.started = ktime_get();
+
 	fimc_hwset_start_scaler(ctrl);
 	fimc_hwset_enable_capture(ctrl, 0);	/* bypass disable */
 	fimc_hwset_start_input_dma(ctrl);
@@ -194,6 +196,55 @@ static void fimc_init_out_buf(struct fimc_ctx *ctx)
 	}
 }
 
+static int fimc_outdev_get_src_size(struct fimc_control *ctrl,
+				    struct fimc_ctx *ctx, u32 *length)
+{
+	u32 width = ctx->pix.width;
+	u32 height = ctx->pix.height;
+	u32 y_size = width * height;
+	int nv12t_y, nv12t_cb;
+
+	length[FIMC_ADDR_Y] = y_size;
+	length[FIMC_ADDR_CB] = 0;
+	length[FIMC_ADDR_CR] = 0;
+
+	switch (ctx->pix.pixelformat) {
+	case V4L2_PIX_FMT_RGB32:
+		length[FIMC_ADDR_Y] = y_size << 2;
+		break;
+	case V4L2_PIX_FMT_RGB565:	/* fall through */
+	case V4L2_PIX_FMT_UYVY:		/* fall through */
+	case V4L2_PIX_FMT_YVYU:		/* fall through */
+	case V4L2_PIX_FMT_VYUY:		/* fall through */
+	case V4L2_PIX_FMT_YUYV:
+		length[FIMC_ADDR_Y] = y_size << 1;
+		break;
+	case V4L2_PIX_FMT_YUV420:
+		length[FIMC_ADDR_CB] = y_size >> 2;
+		length[FIMC_ADDR_CR] = y_size >> 2;
+		break;
+	case V4L2_PIX_FMT_NV12:		/* fall through */
+	case V4L2_PIX_FMT_NV21:
+		length[FIMC_ADDR_CB] = y_size >> 1;
+		break;
+	case V4L2_PIX_FMT_NV12T:
+		fimc_get_nv12t_size(width, height, &nv12t_y, &nv12t_cb);
+		length[FIMC_ADDR_Y] = nv12t_y;
+		length[FIMC_ADDR_CB] = nv12t_cb;
+		break;
+	case V4L2_PIX_FMT_NV16:		/* fall through */
+	case V4L2_PIX_FMT_NV61:
+		length[FIMC_ADDR_CB] = y_size;
+		break;
+	default:
+		fimc_err("%s: Invalid pixelformt : %d\n", __func__,
+				ctx->pix.pixelformat);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int fimc_outdev_set_src_buf(struct fimc_control *ctrl,
 				   struct fimc_ctx *ctx)
 {
@@ -205,6 +256,10 @@ static int fimc_outdev_set_src_buf(struct fimc_control *ctrl,
 	u32 i, size;
 	dma_addr_t *curr = &ctrl->mem.curr;
 
+	/* capture buffers exported from the reserved area are still in use */
+	if (atomic_read(&ctrl->cap_exports))
+		return -EBUSY;
+
 	switch (format) {
 	case V4L2_PIX_FMT_RGB32:
 		size = PAGE_ALIGN(y_size << 2);
@@ -308,6 +363,9 @@ static int fimc_outdev_set_dst_buf(struct fimc_control *ctrl,
 	u32 height = ctrl->fb.lcd_vres;
 	u32 i, size;
 
+	if (atomic_read(&ctrl->cap_exports))
+		return -EBUSY;
+
 	end = ctrl->mem.base + ctrl->mem.size;
 	size = PAGE_ALIGN(width * height * 4);
 
@@ -1218,6 +1276,7 @@ int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b)
 	}
 
 	fimc_init_out_buf(ctx);
+	fimc_outdev_release_dmabufs(ctx);
 	ctx->is_requested = 0;
 
 	if (b->count == 0) {
@@ -1248,7 +1307,8 @@ int fimc_reqbufs_output(void *fh, struct v4l2_requestbuffers *b)
 			ctx->overlay.req_idx = FIMC_MMAP_IDX;
 			if (ret)
 				return ret;
-		} else if (b->memory == V4L2_MEMORY_USERPTR) {
+		} else if (b->memory == V4L2_MEMORY_USERPTR ||
+			   b->memory == V4L2_MEMORY_DMABUF) {
 			if (mode == FIMC_OVLY_DMA_AUTO)
 				ctx->overlay.req_idx = FIMC_USERPTR_IDX;
 		}
@@ -1671,6 +1731,69 @@ void fimc_outdev_init_idxs(struct fimc_control *ctrl)
 	ctrl->out->idxs.next.idx = -1;
 }
 
+/*
+ * Forget the frames of a context being stopped that are staged or still
+ * owned by the hardware, its buffers are about to be reset. When the
+ * scaler is left idle with a frame of another context staged, that frame
+ * goes back to the incoming queue as its oldest entry, to be started by
+ * the next queued buffer.
+ */
+static void fimc_outdev_drop_idxs(struct fimc_control *ctrl,
+				  struct fimc_ctx *ctx)
+{
+	struct fimc_outinfo *out = ctrl->out;
+	struct fimc_ctx *next_ctx;
+	unsigned long spin_flags;
+	int i;
+
+	spin_lock_irqsave(&out->lock_in, spin_flags);
+
+	if (out->idxs.prev.ctx == ctx->ctx_num) {
+		out->idxs.prev.ctx = -1;
+		out->idxs.prev.idx = -1;
+	}
+
+	if (out->idxs.active.ctx == ctx->ctx_num) {
+		out->idxs.active.ctx = -1;
+		out->idxs.active.idx = -1;
+	}
+
+	if (out->idxs.next.ctx == ctx->ctx_num) {
+		out->idxs.next.ctx = -1;
+		out->idxs.next.idx = -1;
+	}
+
+	if (out->idxs.active.idx == -1 && out->idxs.next.idx != -1) {
+		next_ctx = &out->ctx[out->idxs.next.ctx];
+
+		for (i = 0; i < FIMC_INQUEUES; i++) {
+			if (out->inq[i].ctx == -1) {
+				out->inq[i] = out->idxs.next;
+				break;
+			}
+		}
+
+		for (i = 0; i < FIMC_OUTBUFS; i++) {
+			if (next_ctx->inq[i] == -1) {
+				next_ctx->inq[i] = out->idxs.next.idx;
+				break;
+			}
+		}
+
+		next_ctx->src[out->idxs.next.idx].state = VIDEOBUF_QUEUED;
+		next_ctx->src[out->idxs.next.idx].flags =
+			V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_QUEUED;
+
+		out->idxs.next.ctx = -1;
+		out->idxs.next.idx = -1;
+
+		if (ctrl->status == FIMC_STREAMON)
+			ctrl->status = FIMC_STREAMON_IDLE;
+	}
+
+	spin_unlock_irqrestore(&out->lock_in, spin_flags);
+}
+
 int fimc_streamoff_output(void *fh)
 {
 	struct fimc_ctx *ctx;
@@ -1687,6 +1810,9 @@ int fimc_streamoff_output(void *fh)
 		return -EINVAL;
 	}
 
+	/* other contexts keep streaming, the indexes are reset once all stop */
+	fimc_outdev_drop_idxs(ctrl, ctx);
+
 	ret = fimc_init_in_queue(ctrl, ctx);
 	if (ret < 0) {
 		fimc_err("Fail: fimc_init_in_queue\n");
@@ -1838,6 +1964,119 @@ int fimc_output_set_dst_addr(struct fimc_control *ctrl,
 }
 
 
+static void fimc_outdev_set_next_dst(struct fimc_control *ctrl,
+				     struct fimc_ctx *ctx, int idx)
+{
+	struct fimc_buf_set buf_set;
+	int i;
+
+	if (ctx->overlay.mode == FIMC_OVLY_NONE_MULTI_BUF) {
+		fimc_output_set_dst_addr(ctrl, ctx, idx);
+		return;
+	}
+
+	memset(&buf_set, 0x00, sizeof(buf_set));
+	buf_set.base[FIMC_ADDR_Y] = ctx->dst[idx].base[FIMC_ADDR_Y];
+
+	for (i = 0; i < FIMC_PHYBUFS; i++)
+		fimc_hwset_output_address(ctrl, &buf_set, i);
+}
+
+/*
+ * Take the next buffer from the incoming queue while the current frame is
+ * still being processed and program its addresses. The address registers
+ * are shadowed while address change is disabled, so the frame in flight is
+ * not affected and the completion interrupt only has to restart the input
+ * DMA. Single buffer mode always writes to the same destination and is not
+ * pipelined.
+ */
+int fimc_outdev_stage_next(struct fimc_control *ctrl)
+{
+	struct fimc_ctx *ctx;
+	int ret, ctx_num, idx;
+
+	if (ctrl->out->idxs.next.idx != -1)
+		return 0;
+
+	ret = fimc_pop_inq(ctrl, &ctx_num, &idx);
+	if (ret < 0)
+		return ret;
+
+	ctx = &ctrl->out->ctx[ctx_num];
+
+	/* parameters differ, addresses are set when the frame is started */
+	if (ctx_num == ctrl->out->last_ctx) {
+		fimc_hwset_addr_change_disable(ctrl);
+		fimc_hwset_input_address(ctrl, ctx->src[idx].base);
+		fimc_outdev_set_next_dst(ctrl, ctx, idx);
+		fimc_hwset_addr_change_enable(ctrl);
+	}
+
+	ctrl->out->idxs.next.ctx = ctx_num;
+	ctrl->out->idxs.next.idx = idx;
+
+	return 0;
+}
+
+/*
+ * Start the frame staged by fimc_outdev_stage_next(), or the oldest one in
+ * the incoming queue when nothing was staged. Called from the completion
+ * interrupt; returns the context of the started frame or NULL when idle.
+ */
+struct fimc_ctx *fimc_outdev_start_next(struct fimc_control *ctrl)
+{
+	struct fimc_ctx *ctx;
+	int ret, ctx_num, next, staged = 0;
+
+	if (ctrl->out->idxs.next.idx != -1) {
+		ctx_num = ctrl->out->idxs.next.ctx;
+		next = ctrl->out->idxs.next.idx;
+		ctrl->out->idxs.next.ctx = -1;
+		ctrl->out->idxs.next.idx = -1;
+		staged = (ctx_num == ctrl->out->last_ctx);
+	} else {
+		ret = fimc_pop_inq(ctrl, &ctx_num, &next);
+		if (ret < 0)
+			return NULL;
+	}
+
+	ctx = &ctrl->out->ctx[ctx_num];
+
+	if (!staged) {
+		if (ctx_num != ctrl->out->last_ctx) {
+			ctrl->out->last_ctx = ctx->ctx_num;
+			fimc_outdev_set_ctx_param(ctrl, ctx);
+		}
+
+		fimc_outdev_set_src_addr(ctrl, ctx->src[next].base);
+		fimc_outdev_set_next_dst(ctrl, ctx, next);
+	}
+
+	ret = fimc_outdev_start_camif(ctrl);
+	if (ret < 0)
+		fimc_err("Fail: fimc_start_camif\n");
+
+	ctrl->out->idxs.active.ctx = ctx_num;
+	ctrl->out->idxs.active.idx = next;
+
+	return ctx;
+}
+
+void fimc_outdev_reset_stats(struct fimc_control *ctrl)
+{
+	struct fimc_out_stats *st = &ctrl->out_stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->frames = 0;
+	st->staged = 0;
+	st->busy_ns = 0;
+	st->irq_ns = 0;
+	st->max_gap_ns = 0;
+	st->reset = ktime_get();
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
 static int fimc_qbuf_output_single_buf(struct fimc_control *ctrl,
 				       struct fimc_ctx *ctx,
 				       int idx)
@@ -2021,6 +2260,53 @@ static int fimc_update_in_queue_addr(struct fimc_control *ctrl,
 	return 0;
 }
 
+void fimc_outdev_release_dmabufs(struct fimc_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < FIMC_OUTBUFS; i++)
+		s5p_dmabuf_release(&ctx->src[i].dmabuf);
+}
+
+static int fimc_update_in_queue_dmabuf(struct fimc_control *ctrl,
+				       struct fimc_ctx *ctx,
+				       u32 idx, int fd)
+{
+	struct fimc_buf_set *src = &ctx->src[idx];
+	dma_addr_t base[3];
+	u32 length[3];
+	int ret;
+
+	ret = fimc_outdev_get_src_size(ctrl, ctx, length);
+	if (ret < 0)
+		return ret;
+
+	/* a buffer left over from a previous queueing is not in use anymore */
+	s5p_dmabuf_release(&src->dmabuf);
+
+	ret = s5p_dmabuf_import(fd, ctrl->dev, DMA_TO_DEVICE, &src->dmabuf);
+	if (ret < 0) {
+		fimc_err("%s: invalid dma-buf fd(%d)\n", __func__, fd);
+		return ret;
+	}
+
+	if (src->dmabuf.size < length[FIMC_ADDR_Y] + length[FIMC_ADDR_CB] +
+				length[FIMC_ADDR_CR]) {
+		fimc_err("%s: dma-buf is too small for the format\n",
+				__func__);
+		s5p_dmabuf_release(&src->dmabuf);
+		return -EINVAL;
+	}
+
+	base[FIMC_ADDR_Y] = src->dmabuf.paddr;
+	base[FIMC_ADDR_CB] = length[FIMC_ADDR_CB] ?
+			base[FIMC_ADDR_Y] + length[FIMC_ADDR_Y] : 0;
+	base[FIMC_ADDR_CR] = length[FIMC_ADDR_CR] ?
+			base[FIMC_ADDR_CB] + length[FIMC_ADDR_CB] : 0;
+
+	return fimc_update_in_queue_addr(ctrl, ctx, idx, base);
+}
+
 int fimc_qbuf_output(void *fh, struct v4l2_buffer *b)
 {
 	struct fimc_buf *buf = (struct fimc_buf *)b->m.userptr;
@@ -2052,6 +2338,10 @@ int fimc_qbuf_output(void *fh, struct v4l2_buffer *b)
 		ret = fimc_update_in_queue_addr(ctrl, ctx, b->index, buf->base);
 		if (ret < 0)
 			return ret;
+	} else if (b->memory == V4L2_MEMORY_DMABUF) {
+		ret = fimc_update_in_queue_dmabuf(ctrl, ctx, b->index, b->m.fd);
+		if (ret < 0)
+			return ret;
 	}
 
 	/* Attach the buffer to the incoming queue. */
@@ -2145,6 +2435,10 @@ int fimc_dqbuf_output(void *fh, struct v4l2_buffer *b)
 
 	b->index = idx;
 
+	/* the scaler is done with it, drop the reference taken at qbuf */
+	if (b->memory == V4L2_MEMORY_DMABUF)
+		s5p_dmabuf_release(&ctx->src[idx].dmabuf);
+
 	fimc_info2("ctx(%d) dqueued idx = %d\n", ctx->ctx_num, b->index);
 
 	return ret;
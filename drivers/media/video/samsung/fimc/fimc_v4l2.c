@@ -260,6 +260,29 @@ static int fimc_dqbuf(struct file *filp, void *fh, struct v4l2_buffer *b)
 	return ret;
 }
 
+static long fimc_default(struct file *filp, void *fh, bool valid_prio,
+			 int cmd, void *arg)
+{
+	struct v4l2_exportbuffer *e = arg;
+	int ret = -EINVAL;
+
+	switch (cmd) {
+	case VIDIOC_EXPBUF:
+		if (e->type == V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+			ret = fimc_expbuf_capture(fh, e);
+		} else {
+			fimc_err("V4L2_BUF_TYPE_VIDEO_CAPTURE is only "
+				"supported for VIDIOC_EXPBUF\n");
+		}
+		break;
+	default:
+		ret = -ENOTTY;
+		break;
+	}
+
+	return ret;
+}
+
 const struct v4l2_ioctl_ops fimc_v4l2_ops = {
 	.vidioc_querycap		= fimc_querycap,
 	.vidioc_reqbufs			= fimc_reqbufs,
@@ -293,4 +316,5 @@ const struct v4l2_ioctl_ops fimc_v4l2_ops = {
 	.vidioc_try_fmt_vid_overlay	= fimc_try_fmt_overlay,
 	.vidioc_g_fmt_vid_overlay	= fimc_g_fmt_vid_overlay,
 	.vidioc_s_fmt_vid_overlay	= fimc_s_fmt_vid_overlay,
+	.vidioc_default			= fimc_default,
 };
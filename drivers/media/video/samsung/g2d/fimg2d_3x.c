@@ -58,6 +58,7 @@
 #include <mach/media.h>
 #include <plat/media.h>
 #include <plat/cpu.h>
+#include <plat/dmabuf.h>
 #include "fimg2d_regs.h"
 #include "fimg2d_3x.h"
 
@@ -755,6 +756,17 @@ static long sec_g2d_ioctl(struct file *file,
 		ret = copy_to_user((unsigned int *)arg, &g_g2d_reserved_size,
 						sizeof(unsigned int));
 		break;
+	case G2D_EXPORT_MEMORY:
+		ret = s5p_dmabuf_export_fd(g_g2d_reserved_phys_addr,
+				g_g2d_reserved_size, S5P_DMABUF_CACHED,
+				NULL, NULL);
+		if (ret < 0)
+			return ret;
+
+		if (put_user(ret, (int __user *)arg))
+			return -EFAULT;
+
+		return 0;
 	case G2D_DMA_CACHE_INVAL:
 		ret = copy_from_user(&dma_info, (struct g2d_dma_info *)arg,
 						sizeof(dma_info));
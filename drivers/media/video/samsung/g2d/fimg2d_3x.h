@@ -22,6 +22,7 @@
 #define G2D_DMA_CACHE_CLEAN  _IOWR(G2D_IOCTL_MAGIC, 5, struct g2d_dma_info)
 #define G2D_DMA_CACHE_FLUSH  _IOWR(G2D_IOCTL_MAGIC, 6, struct g2d_dma_info)
 #define G2D_SET_MEMORY       _IOWR(G2D_IOCTL_MAGIC, 7, struct g2d_dma_info)
+#define G2D_EXPORT_MEMORY    _IOR(G2D_IOCTL_MAGIC, 8, int)
 
 #define G2D_SFR_SIZE        (0x1000)
 
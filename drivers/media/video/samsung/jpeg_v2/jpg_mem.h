@@ -16,6 +16,9 @@
 #include "jpg_misc.h"
 
 #include <linux/version.h>
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
 #include <plat/media.h>
 #include <mach/media.h>
 
@@ -102,6 +105,9 @@ struct s5pc110_jpg_ctx {
 	int			caller_process;
 	struct jpegv2_limits	*limits;
 	struct jpegv2_buf	*bufinfo;
+	struct list_head	done_list;	/* finished asynchronous jobs */
+	wait_queue_head_t	wait;
+	atomic_t		pending;	/* jobs not dequeued yet */
 };
 
 void *phy_to_vir_addr(unsigned int phy_addr, int mem_size);
@@ -27,30 +27,18 @@ enum {
 	PROGRESSIVE = 0xC2
 } jpg_sof_marker;
 
-enum jpg_return_status wait_for_interrupt(void)
+/*
+ * Program the engine for decoding the stream at jpg_addr into img_addr and
+ * start it. Completion is signalled by the interrupt, after which
+ * decode_jpg_result() reads back the image information.
+ */
+void decode_jpg_start(struct s5pc110_jpg_ctx *jpg_ctx,
+		      struct jpg_dec_proc_param *dec_param,
+		      unsigned int img_addr, unsigned int jpg_addr)
 {
-	if (interruptible_sleep_on_timeout(&wait_queue_jpeg,	\
-					 INT_TIMEOUT) == 0) {
-		jpg_err("waiting for interrupt is timeout\n");
-	}
-
-	return jpg_irq_reason;
-}
-
-enum jpg_return_status decode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
-				  struct jpg_dec_proc_param *dec_param)
-{
-	int		ret;
-	enum sample_mode sample_mode;
-	unsigned int	width, height;
-	jpg_dbg("enter decode_jpg function\n");
+	jpg_dbg("enter decode_jpg_start function\n");
 
-	if (jpg_ctx)
-		reset_jpg(jpg_ctx);
-	else {
-		jpg_err("jpg ctx is NULL\n");
-		return JPG_FAIL;
-	}
+	reset_jpg(jpg_ctx);
 
 /* set jpeg clock register : power on */
 	writel(readl(s3c_jpeg_base + S3C_JPEG_CLKCON_REG) |
@@ -74,23 +62,23 @@ enum jpg_return_status decode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 			(dec_param->out_format << 0),
 			s3c_jpeg_base + S3C_JPEG_OUTFORM_REG);
 
-	/* set the address of compressed input data */
-	writel(jpg_ctx->img_data_addr, s3c_jpeg_base + S3C_JPEG_IMGADR_REG);
-
 	/* set the address of decompressed image */
-	writel(jpg_ctx->jpg_data_addr, s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
+	writel(img_addr, s3c_jpeg_base + S3C_JPEG_IMGADR_REG);
+
+	/* set the address of compressed input data */
+	writel(jpg_addr, s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
 
 	/* start decoding */
 	writel(readl(s3c_jpeg_base + S3C_JPEG_JRSTART_REG) |
 			S3C_JPEG_JRSTART_REG_ENABLE,
 			s3c_jpeg_base + S3C_JPEG_JSTART_REG);
+}
 
-	ret = wait_for_interrupt();
-
-	if (ret != OK_ENC_OR_DEC) {
-		jpg_err("jpg decode error(%d)\n", ret);
-		return JPG_FAIL;
-	}
+enum jpg_return_status decode_jpg_result(struct s5pc110_jpg_ctx *jpg_ctx,
+					 struct jpg_dec_proc_param *dec_param)
+{
+	enum sample_mode sample_mode;
+	unsigned int	width, height;
 
 	sample_mode = get_sample_type(jpg_ctx);
 	jpg_dbg("sample_mode : %d\n", sample_mode);
@@ -193,13 +181,9 @@ unsigned int get_yuv_size(enum out_mode out_format,
 	}
 }
 
-enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
-				  struct jpg_enc_proc_param *enc_param)
+enum jpg_return_status check_enc_param(struct s5pc110_jpg_ctx *jpg_ctx,
+				       struct jpg_enc_proc_param *enc_param)
 {
-
-	unsigned int	i, ret;
-	unsigned int	cmd_val;
-
 	if (enc_param->width <= 0
 			|| enc_param->width > jpg_ctx->limits->max_main_width
 			|| enc_param->height <= 0
@@ -210,13 +194,28 @@ enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 		return JPG_FAIL;
 	}
 
-	/* SW reset */
-	if (jpg_ctx)
-		reset_jpg(jpg_ctx);
-	else {
-		jpg_err("::jpg ctx is NULL\n");
+	if (enc_param->quality > JPG_QUALITY_LEVEL_4) {
+		jpg_err("::encoder : invalid quality %d\n", enc_param->quality);
 		return JPG_FAIL;
 	}
+
+	return JPG_SUCCESS;
+}
+
+/*
+ * Program the engine for encoding the image at img_addr into jpg_addr and
+ * start it. The parameters must have been checked by check_enc_param().
+ */
+void encode_jpg_start(struct s5pc110_jpg_ctx *jpg_ctx,
+		      struct jpg_enc_proc_param *enc_param,
+		      unsigned int img_addr, unsigned int jpg_addr)
+{
+	unsigned int	i;
+	unsigned int	cmd_val;
+
+	/* SW reset */
+	reset_jpg(jpg_ctx);
+
 	/* set jpeg clock register : power on */
 	writel(readl(s3c_jpeg_base + S3C_JPEG_CLKCON_REG) |
 			(S3C_JPEG_CLKCON_REG_POWER_ON_ACTIVATE),
@@ -247,23 +246,10 @@ enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 	writel((enc_param->height>>8), s3c_jpeg_base + S3C_JPEG_Y_U_REG);
 	writel(enc_param->height, s3c_jpeg_base + S3C_JPEG_Y_L_REG);
 
-	jpg_dbg("enc_param->enc_type : %d\n", enc_param->enc_type);
-
-	if (enc_param->enc_type == JPG_MAIN) {
-		jpg_dbg("encode image size width: %d, height: %d\n",
-				enc_param->width, enc_param->height);
-		writel(jpg_ctx->img_data_addr,
-			s3c_jpeg_base + S3C_JPEG_IMGADR_REG);
-		writel(jpg_ctx->jpg_data_addr,
-			s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
-	} else { /* thumbnail encoding */
-		jpg_dbg("thumb image size width: %d, height: %d\n",
-				enc_param->width, enc_param->height);
-		writel(jpg_ctx->img_thumb_data_addr,
-			s3c_jpeg_base + S3C_JPEG_IMGADR_REG);
-		writel(jpg_ctx->jpg_thumb_data_addr,
-			s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
-	}
+	jpg_dbg("encode image size width: %d, height: %d\n",
+			enc_param->width, enc_param->height);
+	writel(img_addr, s3c_jpeg_base + S3C_JPEG_IMGADR_REG);
+	writel(jpg_addr, s3c_jpeg_base + S3C_JPEG_JPGADR_REG);
 
 	/*  Coefficient value 1~3 for RGB to YCbCr */
 	writel(COEF1_RGB_2_YUV, s3c_jpeg_base + S3C_JPEG_COEF1_REG);
@@ -304,17 +290,12 @@ enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx,
 	writel(readl(s3c_jpeg_base + S3C_JPEG_JSTART_REG) |
 			S3C_JPEG_JSTART_REG_ENABLE,
 			s3c_jpeg_base + S3C_JPEG_JSTART_REG);
-	ret = wait_for_interrupt();
-
-	if (ret != OK_ENC_OR_DEC) {
-		jpg_err("jpeg encoding error(%d)\n", ret);
-		return JPG_FAIL;
-	}
+}
 
+void encode_jpg_result(struct s5pc110_jpg_ctx *jpg_ctx,
+		       struct jpg_enc_proc_param *enc_param)
+{
 	enc_param->file_size = readl(s3c_jpeg_base + S3C_JPEG_CNT_U_REG) << 16;
 	enc_param->file_size |= readl(s3c_jpeg_base + S3C_JPEG_CNT_M_REG) << 8;
 	enc_param->file_size |= readl(s3c_jpeg_base + S3C_JPEG_CNT_L_REG);
-
-	return JPG_SUCCESS;
-
 }
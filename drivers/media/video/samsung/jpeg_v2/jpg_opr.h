@@ -16,7 +16,6 @@
 #include <linux/interrupt.h>
 
 extern void __iomem		*s3c_jpeg_base;
-extern int			jpg_irq_reason;
 
 /* debug macro */
 #define JPG_DEBUG(fmt, ...)					\
@@ -51,8 +50,6 @@ extern int			jpg_irq_reason;
 #define jpg_warn(fmt, ...)		JPG_WARN(fmt, ##__VA_ARGS__)
 #define jpg_err(fmt, ...)		JPG_ERROR(fmt, ##__VA_ARGS__)
 
-extern wait_queue_head_t wait_queue_jpeg;
-
 enum jpg_return_status {
 	JPG_FAIL,
 	JPG_SUCCESS,
@@ -144,12 +141,40 @@ struct jpg_args {
 	struct jpg_enc_proc_param	*thumb_enc_param;
 };
 
+enum jpg_job_type {
+	JPG_JOB_DECODE,
+	JPG_JOB_ENCODE
+};
+
+/*
+ * Asynchronous job, see IOCTL_JPG_QUEUE_JOB and IOCTL_JPG_DEQUEUE_JOB.
+ * The source and destination are dma-buf file descriptors: the image and
+ * the stream for encoding, the stream and the image for decoding. The
+ * result and the updated parameters are returned on dequeue, matched by id.
+ */
+struct jpg_job_args {
+	unsigned int			id;
+	enum jpg_job_type		type;
+	int				src_fd;
+	int				dst_fd;
+	struct jpg_enc_proc_param	enc_param;
+	struct jpg_dec_proc_param	dec_param;
+	enum jpg_return_status		result;
+};
+
 void reset_jpg(struct s5pc110_jpg_ctx *jpg_ctx);
-enum jpg_return_status decode_jpg(struct s5pc110_jpg_ctx *jpg_ctx, \
+void decode_jpg_start(struct s5pc110_jpg_ctx *jpg_ctx, \
+		struct jpg_dec_proc_param *dec_param, \
+		unsigned int img_addr, unsigned int jpg_addr);
+enum jpg_return_status decode_jpg_result(struct s5pc110_jpg_ctx *jpg_ctx, \
 		struct jpg_dec_proc_param *dec_param);
-enum jpg_return_status encode_jpg(struct s5pc110_jpg_ctx *jpg_ctx, \
+enum jpg_return_status check_enc_param(struct s5pc110_jpg_ctx *jpg_ctx, \
+		struct jpg_enc_proc_param *enc_param);
+void encode_jpg_start(struct s5pc110_jpg_ctx *jpg_ctx, \
+		struct jpg_enc_proc_param *enc_param, \
+		unsigned int img_addr, unsigned int jpg_addr);
+void encode_jpg_result(struct s5pc110_jpg_ctx *jpg_ctx, \
 		struct jpg_enc_proc_param *enc_param);
-enum jpg_return_status wait_for_interrupt(void);
 enum sample_mode get_sample_type(struct s5pc110_jpg_ctx *jpg_ctx);
 void get_xy(struct s5pc110_jpg_ctx *jpg_ctx, unsigned int *x, unsigned int *y);
 unsigned int get_yuv_size(enum out_mode out_format, \
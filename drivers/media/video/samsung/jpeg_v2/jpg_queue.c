@@ -0,0 +1,246 @@
+/* linux/drivers/media/video/samsung/jpeg_v2/jpg_queue.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ * http://www.samsung.com/
+ *
+ * Job queue for Jpeg encoder/docoder
+ *
+ * Jobs from all open contexts are run one after another in submission
+ * order. The next job is started from the completion interrupt, so the
+ * engine never waits for the submitting process to be scheduled. The
+ * clock is enabled from submission until the job is finished; the clock
+ * framework is not irq safe, so finished jobs drop it from a work item.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "s3c-jpeg.h"
+#include "jpg_mem.h"
+#include "jpg_opr.h"
+#include "jpg_queue.h"
+
+static LIST_HEAD(jpg_run_list);
+static DEFINE_SPINLOCK(jpg_queue_lock);
+static struct jpg_job *jpg_cur_job;
+static struct clk *jpg_clk;
+static atomic_t jpg_clk_puts;	/* finished jobs still holding the clock */
+
+static void jpg_clk_work_fn(struct work_struct *work)
+{
+	while (atomic_add_unless(&jpg_clk_puts, -1, 0))
+		clk_disable(jpg_clk);
+}
+
+static DECLARE_WORK(jpg_clk_work, jpg_clk_work_fn);
+static struct timer_list jpg_timer;
+static struct jpg_stats jpg_stats;
+
+/* called with jpg_queue_lock held */
+static void jpg_queue_run(void)
+{
+	struct jpg_job *job;
+
+	if (jpg_cur_job || list_empty(&jpg_run_list))
+		return;
+
+	job = list_first_entry(&jpg_run_list, struct jpg_job, list);
+	list_del(&job->list);
+	jpg_stats.queued--;
+
+	jpg_cur_job = job;
+	job->start = ktime_get();
+
+	if (job->args.type == JPG_JOB_ENCODE)
+		encode_jpg_start(job->ctx, &job->args.enc_param,
+				 job->img_addr, job->jpg_addr);
+	else
+		decode_jpg_start(job->ctx, &job->args.dec_param,
+				 job->img_addr, job->jpg_addr);
+
+	mod_timer(&jpg_timer,
+		  jiffies + msecs_to_jiffies(MAX_PROCESSING_THRESHOLD));
+}
+
+/* called with jpg_queue_lock held */
+static void jpg_queue_finish(enum jpg_return_status reason)
+{
+	struct jpg_job *job = jpg_cur_job;
+	struct s5pc110_jpg_ctx *ctx = job->ctx;
+
+	jpg_cur_job = NULL;
+	jpg_stats.busy_ns += ktime_to_ns(ktime_sub(ktime_get(), job->start));
+
+	if (reason != OK_ENC_OR_DEC) {
+		jpg_err("jpg %s error(%d)\n", job->args.type == JPG_JOB_ENCODE ?
+				"encode" : "decode", reason);
+		job->args.result = JPG_FAIL;
+	} else if (job->args.type == JPG_JOB_ENCODE) {
+		encode_jpg_result(ctx, &job->args.enc_param);
+		job->args.result = JPG_SUCCESS;
+		jpg_stats.enc_jobs++;
+		jpg_stats.enc_bytes += job->args.enc_param.file_size;
+	} else {
+		job->args.result = decode_jpg_result(ctx, &job->args.dec_param);
+		jpg_stats.dec_jobs++;
+		jpg_stats.dec_bytes += job->args.dec_param.data_size;
+	}
+
+	if (job->args.result != JPG_SUCCESS)
+		jpg_stats.errors++;
+
+	atomic_inc(&jpg_clk_puts);
+	schedule_work(&jpg_clk_work);
+
+	if (job->sync)
+		complete(&job->done);
+	else
+		list_add_tail(&job->list, &ctx->done_list);
+
+	wake_up(&ctx->wait);
+}
+
+void jpg_queue_irq(enum jpg_return_status reason)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+
+	if (jpg_cur_job) {
+		del_timer(&jpg_timer);
+		jpg_queue_finish(reason);
+		jpg_queue_run();
+	}
+
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+}
+
+static void jpg_queue_timeout(unsigned long data)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+
+	if (jpg_cur_job) {
+		jpg_err("waiting for interrupt is timeout\n");
+		jpg_stats.timeouts++;
+		reset_jpg(jpg_cur_job->ctx);
+		jpg_queue_finish(ERR_UNKNOWN);
+		jpg_queue_run();
+	}
+
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+}
+
+void jpg_queue_job(struct jpg_job *job)
+{
+	unsigned long flags;
+
+	clk_enable(jpg_clk);
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+
+	list_add_tail(&job->list, &jpg_run_list);
+	if (++jpg_stats.queued > jpg_stats.max_queued)
+		jpg_stats.max_queued = jpg_stats.queued;
+
+	jpg_queue_run();
+
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+}
+
+static int jpg_queue_running(struct s5pc110_jpg_ctx *jpg_ctx)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+	ret = jpg_cur_job && jpg_cur_job->ctx == jpg_ctx;
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+
+	return ret;
+}
+
+/*
+ * Take the jobs of a context off the run queue and wait for the one on the
+ * engine. Cancelled jobs end up in the done list like finished ones.
+ */
+void jpg_queue_cancel(struct s5pc110_jpg_ctx *jpg_ctx)
+{
+	struct jpg_job *job, *tmp;
+	unsigned long flags;
+	int cancelled = 0;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+
+	list_for_each_entry_safe(job, tmp, &jpg_run_list, list) {
+		if (job->ctx != jpg_ctx)
+			continue;
+
+		list_move_tail(&job->list, &jpg_ctx->done_list);
+		job->args.result = JPG_FAIL;
+		jpg_stats.queued--;
+		cancelled++;
+	}
+
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+
+	while (cancelled--)
+		clk_disable(jpg_clk);
+
+	wait_event(jpg_ctx->wait, !jpg_queue_running(jpg_ctx));
+}
+
+struct jpg_job *jpg_queue_get_done(struct s5pc110_jpg_ctx *jpg_ctx)
+{
+	struct jpg_job *job = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+
+	if (!list_empty(&jpg_ctx->done_list)) {
+		job = list_first_entry(&jpg_ctx->done_list,
+				       struct jpg_job, list);
+		list_del(&job->list);
+	}
+
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+
+	return job;
+}
+
+int jpg_queue_has_done(struct s5pc110_jpg_ctx *jpg_ctx)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+	ret = !list_empty(&jpg_ctx->done_list);
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+
+	return ret;
+}
+
+void jpg_queue_get_stats(struct jpg_stats *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_queue_lock, flags);
+	*stats = jpg_stats;
+	spin_unlock_irqrestore(&jpg_queue_lock, flags);
+}
+
+void jpg_queue_init(struct clk *clk)
+{
+	jpg_clk = clk;
+	setup_timer(&jpg_timer, jpg_queue_timeout, 0);
+}
@@ -0,0 +1,73 @@
+/* linux/drivers/media/video/samsung/jpeg_v2/jpg_queue.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ * http://www.samsung.com/
+ *
+ * Definition for the job queue of Jpeg encoder/docoder
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __JPG_QUEUE_H__
+#define __JPG_QUEUE_H__
+
+#include <linux/list.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/clk.h>
+#include <plat/dmabuf.h>
+
+#include "jpg_mem.h"
+#include "jpg_opr.h"
+
+#define JPG_MAX_JOBS		16	/* per context */
+
+/*
+ * struct jpg_job
+ * @list:	entry in the run queue or in the done list of the context
+ * @ctx:	context the job was submitted from
+ * @args:	parameters, updated with the result on completion
+ * @img_addr:	physical address of the raw image
+ * @jpg_addr:	physical address of the compressed stream
+ * @src:	imported source buffer of an asynchronous job
+ * @dst:	imported destination buffer of an asynchronous job
+ * @sync:	the submitter waits on @done instead of dequeueing the job
+ * @done:	completion of a synchronous job
+ * @start:	time the engine was started on the job
+*/
+struct jpg_job {
+	struct list_head		list;
+	struct s5pc110_jpg_ctx		*ctx;
+	struct jpg_job_args		args;
+	unsigned int			img_addr;
+	unsigned int			jpg_addr;
+	struct s5p_dmabuf_import	src;
+	struct s5p_dmabuf_import	dst;
+	int				sync;
+	struct completion		done;
+	ktime_t				start;
+};
+
+struct jpg_stats {
+	unsigned long long	enc_jobs;
+	unsigned long long	dec_jobs;
+	unsigned long long	errors;
+	unsigned long long	timeouts;
+	unsigned long long	enc_bytes;	/* compressed bytes produced */
+	unsigned long long	dec_bytes;	/* image bytes produced */
+	unsigned long long	busy_ns;	/* time the engine was running */
+	unsigned int		queued;		/* jobs waiting for the engine */
+	unsigned int		max_queued;
+};
+
+void jpg_queue_init(struct clk *clk);
+void jpg_queue_job(struct jpg_job *job);
+void jpg_queue_irq(enum jpg_return_status reason);
+void jpg_queue_cancel(struct s5pc110_jpg_ctx *jpg_ctx);
+struct jpg_job *jpg_queue_get_done(struct s5pc110_jpg_ctx *jpg_ctx);
+int jpg_queue_has_done(struct s5pc110_jpg_ctx *jpg_ctx);
+void jpg_queue_get_stats(struct jpg_stats *stats);
+
+#endif
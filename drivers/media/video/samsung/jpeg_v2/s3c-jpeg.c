@@ -38,10 +38,13 @@
 #include <linux/mm.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/uaccess.h>
+#include <linux/math64.h>
 
 #include <linux/version.h>
 #include <plat/media.h>
 #include <plat/jpeg.h>
+#include <plat/dmabuf.h>
 #include <mach/media.h>
 
 #include <linux/time.h>
@@ -53,6 +56,7 @@
 #include "jpg_mem.h"
 #include "jpg_misc.h"
 #include "jpg_opr.h"
+#include "jpg_queue.h"
 #include "regs-jpeg.h"
 
 static struct jpegv2_limits	s3c_jpeg_limits;
@@ -64,40 +68,32 @@ static struct regulator		*jpeg_pd_regulator;
 #endif //REGULATOR_JPEG
 static struct resource	*s3c_jpeg_mem;
 void __iomem		*s3c_jpeg_base;
+static struct device	*s3c_jpeg_dev;
 static int		irq_no;
 static int		instanceNo;;
-int			jpg_irq_reason;
-wait_queue_head_t	wait_queue_jpeg;
 
+/* the context using the reserved buffers through the legacy ioctls */
+static struct s5pc110_jpg_ctx	*jpg_legacy_ctx;
 
-DECLARE_WAIT_QUEUE_HEAD(WaitQueue_JPEG);
-
-static void jpeg_clock_enable(void)
-{
-#ifdef REGULATOR_JPEG
-	/* power domain enable */
-	regulator_enable(jpeg_pd_regulator);
-#endif //REGULATOR_JPEG
-
-	/* clock enable */
-	clk_enable(s3c_jpeg_clk);
-}
-
-static void jpeg_clock_disable(void)
+/*
+ * The reserved buffers are mapped by every process using the legacy
+ * ioctls, so only one context may use them at a time.
+ * Called with the jpg mutex held.
+ */
+static int s3c_jpeg_claim_legacy(struct s5pc110_jpg_ctx *jpg_ctx)
 {
-	/* clock disable */
-	clk_disable(s3c_jpeg_clk);
+	if (jpg_legacy_ctx && jpg_legacy_ctx != jpg_ctx)
+		return -EBUSY;
 
-#ifdef REGULATOR_JPEG
-	/* power domain disable */
-	regulator_disable(jpeg_pd_regulator);
-#endif //REGULATOR_JPEG
+	jpg_legacy_ctx = jpg_ctx;
+	return 0;
 }
 
 irqreturn_t s3c_jpeg_irq(int irq, void *dev_id, struct pt_regs *regs)
 {
 	unsigned int	int_status;
 	unsigned int	status;
+	enum jpg_return_status	reason;
 
 	jpg_dbg("=====enter s3c_jpeg_irq===== \r\n");
 
@@ -110,26 +106,141 @@ irqreturn_t s3c_jpeg_irq(int irq, void *dev_id, struct pt_regs *regs)
 	writel(S3C_JPEG_COM_INT_RELEASE, s3c_jpeg_base + S3C_JPEG_COM_REG);
 	jpg_dbg("int_status : 0x%08x status : 0x%08x\n", int_status, status);
 
-	if (int_status) {
-		switch (int_status) {
-		case 0x40:
-			jpg_irq_reason = OK_ENC_OR_DEC;
-			break;
-		case 0x20:
-			jpg_irq_reason = ERR_ENC_OR_DEC;
-			break;
-		default:
-			jpg_irq_reason = ERR_UNKNOWN;
-		}
+	switch (int_status) {
+	case 0x40:
+		reason = OK_ENC_OR_DEC;
+		break;
+	case 0x20:
+		reason = ERR_ENC_OR_DEC;
+		break;
+	default:
+		reason = ERR_UNKNOWN;
+	}
+
+	jpg_queue_irq(reason);
+
+	return IRQ_HANDLED;
+}
+
+/* run a job on the reserved buffers and wait for it, for the legacy ioctls */
+static enum jpg_return_status s3c_jpeg_run_job(struct s5pc110_jpg_ctx *jpg_ctx,
+					       struct jpg_job *job)
+{
+	job->ctx = jpg_ctx;
+	job->sync = 1;
+	init_completion(&job->done);
+
+	jpg_queue_job(job);
+	wait_for_completion(&job->done);
+
+	return job->args.result;
+}
+
+static void s3c_jpeg_free_job(struct jpg_job *job)
+{
+	s5p_dmabuf_release(&job->src);
+	s5p_dmabuf_release(&job->dst);
+	atomic_dec(&job->ctx->pending);
+	kfree(job);
+}
+
+static int s3c_jpeg_queue_job(struct s5pc110_jpg_ctx *jpg_ctx,
+			      struct jpg_job_args __user *uarg)
+{
+	struct jpg_job *job;
+	unsigned int pixels;
+	int ret;
+
+	if (atomic_inc_return(&jpg_ctx->pending) > JPG_MAX_JOBS) {
+		atomic_dec(&jpg_ctx->pending);
+		return -EBUSY;
+	}
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job) {
+		atomic_dec(&jpg_ctx->pending);
+		return -ENOMEM;
+	}
+
+	if (copy_from_user(&job->args, uarg, sizeof(job->args))) {
+		ret = -EFAULT;
+		goto err_args;
+	}
+
+	ret = s5p_dmabuf_import(job->args.src_fd, s3c_jpeg_dev,
+				DMA_TO_DEVICE, &job->src);
+	if (ret)
+		goto err_args;
+
+	ret = s5p_dmabuf_import(job->args.dst_fd, s3c_jpeg_dev,
+				DMA_FROM_DEVICE, &job->dst);
+	if (ret)
+		goto err_src;
+
+	/* the engine has no bound on its output, so size it for the worst */
+	ret = -EINVAL;
+	switch (job->args.type) {
+	case JPG_JOB_ENCODE:
+		if (check_enc_param(jpg_ctx, &job->args.enc_param) != JPG_SUCCESS)
+			goto err_dst;
+
+		pixels = job->args.enc_param.width *
+			 job->args.enc_param.height;
+		if (job->src.size < pixels * 2 || job->dst.size < pixels)
+			goto err_dst;
+
+		job->img_addr = job->src.paddr;
+		job->jpg_addr = job->dst.paddr;
+		break;
+	case JPG_JOB_DECODE:
+		if (job->dst.size < jpg_ctx->bufinfo->main_frame_size)
+			goto err_dst;
+
+		job->img_addr = job->dst.paddr;
+		job->jpg_addr = job->src.paddr;
+		break;
+	default:
+		goto err_dst;
+	}
+
+	job->ctx = jpg_ctx;
+	jpg_queue_job(job);
 
-		wake_up_interruptible(&wait_queue_jpeg);
+	return 0;
+
+err_dst:
+	s5p_dmabuf_release(&job->dst);
+err_src:
+	s5p_dmabuf_release(&job->src);
+err_args:
+	kfree(job);
+	atomic_dec(&jpg_ctx->pending);
+	return ret;
+}
+
+static int s3c_jpeg_dequeue_job(struct s5pc110_jpg_ctx *jpg_ctx,
+				struct jpg_job_args __user *uarg, int nonblock)
+{
+	struct jpg_job *job;
+	int ret;
+
+	if (nonblock) {
+		job = jpg_queue_get_done(jpg_ctx);
+		if (!job)
+			return -EAGAIN;
 	} else {
-		jpg_irq_reason = ERR_UNKNOWN;
-		wake_up_interruptible(&wait_queue_jpeg);
+		ret = wait_event_interruptible(jpg_ctx->wait,
+				(job = jpg_queue_get_done(jpg_ctx)) != NULL);
+		if (ret)
+			return ret;
 	}
 
-	return IRQ_HANDLED;
+	ret = copy_to_user(uarg, &job->args, sizeof(job->args)) ? -EFAULT : 0;
+	s3c_jpeg_free_job(job);
+
+	return ret;
 }
+
 static int s3c_jpeg_open(struct inode *inode, struct file *file)
 {
 	struct s5pc110_jpg_ctx *jpg_reg_ctx;
@@ -158,12 +269,22 @@ static int s3c_jpeg_open(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+#ifdef REGULATOR_JPEG
+	/* power domain enable */
+	if (instanceNo == 0)
+		regulator_enable(jpeg_pd_regulator);
+#endif //REGULATOR_JPEG
+
 	instanceNo++;
 
 	/* Initialize the limits of the driver */
 	jpg_reg_ctx->limits = &s3c_jpeg_limits;
 	jpg_reg_ctx->bufinfo = &s3c_jpeg_bufinfo;
 
+	INIT_LIST_HEAD(&jpg_reg_ctx->done_list);
+	init_waitqueue_head(&jpg_reg_ctx->wait);
+	atomic_set(&jpg_reg_ctx->pending, 0);
+
 	unlock_jpg_mutex();
 
 	file->private_data = (struct s5pc110_jpg_ctx *)jpg_reg_ctx;
@@ -176,6 +297,7 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 {
 	unsigned long			ret;
 	struct s5pc110_jpg_ctx		*jpg_reg_ctx;
+	struct jpg_job			*job;
 
 	jpg_dbg("JPG_Close\n");
 
@@ -186,6 +308,11 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	/* drop the asynchronous jobs nobody will dequeue */
+	jpg_queue_cancel(jpg_reg_ctx);
+	while ((job = jpg_queue_get_done(jpg_reg_ctx)) != NULL)
+		s3c_jpeg_free_job(job);
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
@@ -193,9 +320,18 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	if (jpg_legacy_ctx == jpg_reg_ctx)
+		jpg_legacy_ctx = NULL;
+
 	if ((--instanceNo) < 0)
 		instanceNo = 0;
 
+#ifdef REGULATOR_JPEG
+	/* power domain disable */
+	if (instanceNo == 0)
+		regulator_disable(jpeg_pd_regulator);
+#endif //REGULATOR_JPEG
+
 	unlock_jpg_mutex();
 	kfree(jpg_reg_ctx);
 
@@ -220,6 +356,8 @@ static long s3c_jpeg_ioctl(struct file *file,
 {
 	struct s5pc110_jpg_ctx		*jpg_reg_ctx;
 	struct jpg_args			param;
+	struct jpg_job			job;
+	enum encode_type		enc_type;
 	enum BOOL			result = TRUE;
 	unsigned long			ret;
 	int				out;
@@ -231,6 +369,20 @@ static long s3c_jpeg_ioctl(struct file *file,
 		return FALSE;
 	}
 
+	/* the job queue does not touch the shared buffers */
+	switch (cmd) {
+	case IOCTL_JPG_QUEUE_JOB:
+		jpg_dbg("IOCTL_JPG_QUEUE_JOB\n");
+		return s3c_jpeg_queue_job(jpg_reg_ctx,
+				(struct jpg_job_args __user *)arg);
+
+	case IOCTL_JPG_DEQUEUE_JOB:
+		jpg_dbg("IOCTL_JPG_DEQUEUE_JOB\n");
+		return s3c_jpeg_dequeue_job(jpg_reg_ctx,
+				(struct jpg_job_args __user *)arg,
+				file->f_flags & O_NONBLOCK);
+	}
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
@@ -238,6 +390,11 @@ static long s3c_jpeg_ioctl(struct file *file,
 		return FALSE;
 	}
 
+	if (s3c_jpeg_claim_legacy(jpg_reg_ctx)) {
+		unlock_jpg_mutex();
+		return -EBUSY;
+	}
+
 	switch (cmd) {
 	case IOCTL_JPG_DECODE:
 
@@ -251,10 +408,18 @@ static long s3c_jpeg_ioctl(struct file *file,
 			(unsigned int)jpg_data_base_addr
 			+ jpg_reg_ctx->bufinfo->main_frame_start;
 
-		jpeg_clock_enable();
-		result = decode_jpg(jpg_reg_ctx, param.dec_param);
-		jpeg_clock_disable();
+		memset(&job, 0, sizeof(job));
+		job.args.type = JPG_JOB_DECODE;
+		job.img_addr = jpg_reg_ctx->img_data_addr;
+		job.jpg_addr = jpg_reg_ctx->jpg_data_addr;
 
+		out = copy_from_user(&job.args.dec_param, param.dec_param,
+				     sizeof(struct jpg_dec_proc_param));
+
+		result = s3c_jpeg_run_job(jpg_reg_ctx, &job);
+
+		out = copy_to_user(param.dec_param, &job.args.dec_param,
+				   sizeof(struct jpg_dec_proc_param));
 		out = copy_to_user((void *)arg,
 				  (void *)&param, sizeof(struct jpg_args));
 		break;
@@ -266,11 +431,21 @@ static long s3c_jpeg_ioctl(struct file *file,
 		out = copy_from_user(&param, (struct jpg_args *)arg,
 				     sizeof(struct jpg_args));
 
+		memset(&job, 0, sizeof(job));
+		job.args.type = JPG_JOB_ENCODE;
+
+		out = copy_from_user(&job.args.enc_param, param.enc_param,
+				     sizeof(struct jpg_enc_proc_param));
+		enc_type = job.args.enc_param.enc_type;
+		if (enc_type != JPG_MAIN)
+			out = copy_from_user(&job.args.enc_param,
+					     param.thumb_enc_param,
+					     sizeof(struct jpg_enc_proc_param));
+
 		jpg_dbg("encode size :: width : %d hegiht : %d\n",
-			param.enc_param->width, param.enc_param->height);
+			job.args.enc_param.width, job.args.enc_param.height);
 
-		jpeg_clock_enable();
-		if (param.enc_param->enc_type == JPG_MAIN) {
+		if (enc_type == JPG_MAIN) {
 			jpg_reg_ctx->jpg_data_addr =
 					(unsigned int)jpg_data_base_addr;
 			jpg_reg_ctx->img_data_addr =
@@ -281,7 +456,8 @@ static long s3c_jpeg_ioctl(struct file *file,
 				jpg_reg_ctx->img_data_addr,
 				jpg_reg_ctx->jpg_data_addr);
 
-			result = encode_jpg(jpg_reg_ctx, param.enc_param);
+			job.img_addr = jpg_reg_ctx->img_data_addr;
+			job.jpg_addr = jpg_reg_ctx->jpg_data_addr;
 		} else {
 			jpg_reg_ctx->jpg_thumb_data_addr =
 				(unsigned int)jpg_data_base_addr
@@ -290,10 +466,22 @@ static long s3c_jpeg_ioctl(struct file *file,
 				(unsigned int)jpg_data_base_addr
 				+ jpg_reg_ctx->bufinfo->thumb_frame_start;
 
-			result = encode_jpg(jpg_reg_ctx, param.thumb_enc_param);
+			job.img_addr = jpg_reg_ctx->img_thumb_data_addr;
+			job.jpg_addr = jpg_reg_ctx->jpg_thumb_data_addr;
+		}
+
+		if (check_enc_param(jpg_reg_ctx, &job.args.enc_param)
+				!= JPG_SUCCESS) {
+			result = JPG_FAIL;
+			break;
 		}
-		jpeg_clock_disable();
 
+		result = s3c_jpeg_run_job(jpg_reg_ctx, &job);
+
+		out = copy_to_user(enc_type == JPG_MAIN ?
+				param.enc_param : param.thumb_enc_param,
+				&job.args.enc_param,
+				sizeof(struct jpg_enc_proc_param));
 		out = copy_to_user((void *)arg, (void *)&param,
 				   sizeof(struct jpg_args));
 		break;
@@ -328,6 +516,14 @@ static long s3c_jpeg_ioctl(struct file *file,
 		unlock_jpg_mutex();
 		return jpg_data_base_addr + jpg_reg_ctx->bufinfo->thumb_frame_start;
 
+	case IOCTL_JPG_EXPORT_FRMBUF:
+		jpg_dbg("IOCTL_JPG_EXPORT_FRMBUF\n");
+		unlock_jpg_mutex();
+		return s5p_dmabuf_export_fd(jpg_data_base_addr +
+				jpg_reg_ctx->bufinfo->main_frame_start,
+				jpg_reg_ctx->bufinfo->main_frame_size, 0,
+				NULL, NULL);
+
 	default:
 		jpg_dbg("JPG Invalid ioctl : 0x%X\n", cmd);
 	}
@@ -339,11 +535,17 @@ static long s3c_jpeg_ioctl(struct file *file,
 
 static unsigned int s3c_jpeg_poll(struct file *file, poll_table *wait)
 {
+	struct s5pc110_jpg_ctx *jpg_reg_ctx = file->private_data;
 	unsigned int mask = 0;
 
 	jpg_dbg("enter poll\n");
-	poll_wait(file, &wait_queue_jpeg, wait);
-	mask = POLLOUT | POLLWRNORM;
+	poll_wait(file, &jpg_reg_ctx->wait, wait);
+
+	if (jpg_queue_has_done(jpg_reg_ctx))
+		mask |= POLLIN | POLLRDNORM;
+	if (atomic_read(&jpg_reg_ctx->pending) < JPG_MAX_JOBS)
+		mask |= POLLOUT | POLLWRNORM;
+
 	return mask;
 }
 
@@ -352,6 +554,13 @@ int s3c_jpeg_mmap(struct file *filp, struct vm_area_struct *vma)
 	unsigned long size	= vma->vm_end - vma->vm_start;
 	unsigned long max_size;
 	unsigned long page_frame_no;
+	int ret;
+
+	lock_jpg_mutex();
+	ret = s3c_jpeg_claim_legacy(filp->private_data);
+	unlock_jpg_mutex();
+	if (ret)
+		return ret;
 
 	page_frame_no = __phys_to_pfn(jpg_data_base_addr);
 
@@ -452,6 +661,30 @@ void s3c_jpg_plat_init(struct s3c_platform_jpeg *pdata)
 
 }
 
+static ssize_t s3c_jpeg_show_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct jpg_stats stats;
+
+	jpg_queue_get_stats(&stats);
+
+	return sprintf(buf, "encoded jobs\t: %llu\n"
+			"decoded jobs\t: %llu\n"
+			"errors\t\t: %llu\n"
+			"timeouts\t: %llu\n"
+			"encoded bytes\t: %llu\n"
+			"decoded bytes\t: %llu\n"
+			"busy time\t: %llu us\n"
+			"queued\t\t: %u (max %u)\n",
+			stats.enc_jobs, stats.dec_jobs,
+			stats.errors, stats.timeouts,
+			stats.enc_bytes, stats.dec_bytes,
+			div_u64(stats.busy_ns, NSEC_PER_USEC),
+			stats.queued, stats.max_queued);
+}
+
+static DEVICE_ATTR(stats, 0444, s3c_jpeg_show_stats, NULL);
+
 static int s3c_jpeg_probe(struct platform_device *pdev)
 {
 	struct resource			*res;
@@ -532,7 +765,8 @@ static int s3c_jpeg_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
-	init_waitqueue_head(&wait_queue_jpeg);
+	s3c_jpeg_dev = &pdev->dev;
+	jpg_queue_init(s3c_jpeg_clk);
 
 	jpg_dbg("JPG_Init\n");
 
@@ -557,6 +791,10 @@ static int s3c_jpeg_probe(struct platform_device *pdev)
 
 	ret = misc_register(&s3c_jpeg_miscdev);
 
+	ret = device_create_file(&pdev->dev, &dev_attr_stats);
+	if (ret < 0)
+		jpg_err("failed to add sysfs entries\n");
+
 	return 0;
 }
 
@@ -568,6 +806,7 @@ static int s3c_jpeg_remove(struct platform_device *dev)
 		s3c_jpeg_mem = NULL;
 	}
 
+	device_remove_file(&dev->dev, &dev_attr_stats);
 	free_irq(irq_no, dev);
 	misc_deregister(&s3c_jpeg_miscdev);
 	return 0;
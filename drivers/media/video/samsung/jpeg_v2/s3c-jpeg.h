@@ -15,7 +15,7 @@
 #define __JPEG_DRIVER_H__
 
 
-#define MAX_INSTANCE_NUM	1
+#define MAX_INSTANCE_NUM	8	/* one of them may use the reserved buffers */
 #define MAX_PROCESSING_THRESHOLD 1000	/* 1Sec */
 
 #define JPEG_IOCTL_MAGIC 'J'
@@ -28,6 +28,11 @@
 #define IOCTL_JPG_GET_THUMB_FRMBUF		_IO(JPEG_IOCTL_MAGIC, 6)
 #define IOCTL_JPG_GET_PHY_FRMBUF		_IO(JPEG_IOCTL_MAGIC, 7)
 #define IOCTL_JPG_GET_PHY_THUMB_FRMBUF		_IO(JPEG_IOCTL_MAGIC, 8)
+#define IOCTL_JPG_EXPORT_FRMBUF			_IO(JPEG_IOCTL_MAGIC, 9)
+#define IOCTL_JPG_QUEUE_JOB			_IOW(JPEG_IOCTL_MAGIC, 10, \
+						struct jpg_job_args)
+#define IOCTL_JPG_DEQUEUE_JOB			_IOR(JPEG_IOCTL_MAGIC, 11, \
+						struct jpg_job_args)
 #define JPG_CLOCK_DIVIDER_RATIO_QUARTER	4
 
 /* Driver Helper function */
@@ -392,6 +392,23 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		mutex_unlock(&mfc_mutex);
 		break;
 
+	case IOCTL_MFC_EXPORT_BUF:
+		mutex_lock(&mfc_mutex);
+		mfc_debug("IOCTL_MFC_EXPORT_BUF\n");
+
+		if (mfc_ctx->MfcState < MFCINST_STATE_OPENED) {
+			mfc_err("MFCINST_ERR_STATE_INVALID\n");
+			in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+			ret = -EINVAL;
+			mutex_unlock(&mfc_mutex);
+			break;
+		}
+
+		in_param.ret_code = mfc_export_buffer(mfc_ctx, &(in_param.args));
+		ret = in_param.ret_code;
+		mutex_unlock(&mfc_mutex);
+		break;
+
 	case IOCTL_MFC_GET_MMAP_SIZE:
 
 		if (mfc_ctx->MfcState < MFCINST_STATE_OPENED) {
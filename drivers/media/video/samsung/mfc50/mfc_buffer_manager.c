@@ -34,6 +34,7 @@
 #include <linux/uaccess.h>
 
 #include <plat/media.h>
+#include <plat/dmabuf.h>
 #include <mach/media.h>
 
 #include "mfc_buffer_manager.h"
@@ -43,6 +44,8 @@
 
 static struct list_head mfc_alloc_mem_head[MFC_MAX_PORT_NUM];
 static struct list_head mfc_free_mem_head[MFC_MAX_PORT_NUM];
+/* freed by the user but still exported, see mfc_put_alloc_mem() */
+static struct list_head mfc_orphan_mem_head[MFC_MAX_PORT_NUM];
 
 void mfc_print_mem_list(void)
 {
@@ -154,6 +157,7 @@ int mfc_init_buffer(void)
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		INIT_LIST_HEAD(&mfc_alloc_mem_head[port_no]);
 		INIT_LIST_HEAD(&mfc_free_mem_head[port_no]);
+		INIT_LIST_HEAD(&mfc_orphan_mem_head[port_no]);
 		/* init free head node */
 		free_node =
 			(struct mfc_free_mem *)kmalloc(sizeof(struct mfc_free_mem), GFP_KERNEL);
@@ -177,6 +181,40 @@ int mfc_init_buffer(void)
 	return 0;
 }
 
+/*
+ * The memory of a buffer exported as a dma-buf is not handed out again
+ * before the importers are done with it: until then the node is parked
+ * on the orphan list.
+ */
+static void mfc_put_alloc_mem(struct mfc_alloc_mem *alloc_node, int port_no)
+{
+	if (atomic_read(&alloc_node->exports))
+		list_move(&alloc_node->list, &mfc_orphan_mem_head[port_no]);
+	else
+		mfc_free_alloc_mem(alloc_node, port_no);
+}
+
+/* return the memory of orphans whose dma-bufs are all released */
+static void mfc_reclaim_orphans(void)
+{
+	struct list_head *pos, *n;
+	struct mfc_alloc_mem *alloc_node;
+	int port_no, reclaimed = 0;
+
+	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
+		list_for_each_safe(pos, n, &mfc_orphan_mem_head[port_no]) {
+			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
+			if (!atomic_read(&alloc_node->exports)) {
+				mfc_free_alloc_mem(alloc_node, port_no);
+				reclaimed = 1;
+			}
+		}
+	}
+
+	if (reclaimed)
+		mfc_merge_fragment(0);
+}
+
 enum mfc_error_code mfc_release_buffer(unsigned char *u_addr)
 {
 	struct list_head *pos;
@@ -184,12 +222,14 @@ enum mfc_error_code mfc_release_buffer(unsigned char *u_addr)
 	struct mfc_alloc_mem *alloc_node;
 	bool found = false;
 
+	mfc_reclaim_orphans();
+
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		list_for_each(pos, &mfc_alloc_mem_head[port_no])
 		{
 			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
 			if (alloc_node->u_addr == u_addr) {
-				mfc_free_alloc_mem(alloc_node, port_no);
+				mfc_put_alloc_mem(alloc_node, port_no);
 				found = true;
 				break;
 			}
@@ -212,11 +252,13 @@ void mfc_release_all_buffer(int inst_no)
 	int port_no;
 	struct mfc_alloc_mem *alloc_node;
 
+	mfc_reclaim_orphans();
+
 	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
 		list_for_each_safe(pos, n, &mfc_alloc_mem_head[port_no]) {
 			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
 			if (alloc_node->inst_no == inst_no) {
-				mfc_free_alloc_mem(alloc_node, port_no);
+				mfc_put_alloc_mem(alloc_node, port_no);
 			}
 		}
 	}
@@ -284,6 +326,50 @@ out_getphysaddr:
 	return ret;
 }
 
+/* called from the dma-buf release, the node is freed under mfc_mutex later */
+static void mfc_export_release(void *priv)
+{
+	struct mfc_alloc_mem *alloc_node = priv;
+
+	atomic_dec(&alloc_node->exports);
+}
+
+enum mfc_error_code mfc_export_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args)
+{
+	int port_no, fd;
+	struct list_head *pos;
+	struct mfc_alloc_mem *alloc_node;
+	struct mfc_export_buf_arg *export_arg;
+
+	export_arg = (struct mfc_export_buf_arg *)args;
+	for (port_no = 0; port_no < MFC_MAX_PORT_NUM; port_no++) {
+		list_for_each(pos, &mfc_alloc_mem_head[port_no])
+		{
+			alloc_node = list_entry(pos, struct mfc_alloc_mem, list);
+			if (alloc_node->u_addr == (unsigned char *)export_arg->u_addr)
+				goto found;
+		}
+	}
+
+	mfc_err("invalid virtual address(0x%08x)\r\n", export_arg->u_addr);
+	return MFCINST_MEMORY_INVALID_ADDR;
+
+found:
+	atomic_inc(&alloc_node->exports);
+	fd = s5p_dmabuf_export_fd(alloc_node->p_addr, alloc_node->size,
+			(mfc_ctx->buf_type == MFC_BUFFER_CACHE) ?
+			S5P_DMABUF_CACHED : 0, mfc_export_release, alloc_node);
+	if (fd < 0) {
+		mfc_err("export of p_addr(0x%08x) failed(%d)\n",
+				alloc_node->p_addr, fd);
+		return MFCINST_ERR_INVALID_PARAM;
+	}
+
+	export_arg->out_fd = fd;
+
+	return MFCINST_RET_OK;
+}
+
 enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args, int port_no)
 {
 	int ret;
@@ -294,6 +380,8 @@ enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_
 
 	in_param = (struct mfc_mem_alloc_arg *)args;
 
+	mfc_reclaim_orphans();
+
 	alloc_node = (struct mfc_alloc_mem *)kmalloc(sizeof(struct mfc_alloc_mem), GFP_KERNEL);
 	if (!alloc_node) {
 		mfc_err("There is no more kernel memory");
@@ -20,6 +20,7 @@
 #define _MFC_BUFFER_MANAGER_H_
 
 #include <linux/list.h>
+#include <linux/atomic.h>
 #include "mfc_interface.h"
 #include "mfc_opr.h"
 
@@ -33,6 +34,7 @@ struct mfc_alloc_mem  {
 	unsigned char *u_addr;     /* virtual address for user mode process */
 	int size;                  /* memory size                           */
 	int inst_no;               /* instance no                           */
+	atomic_t exports;          /* dma-bufs still using the memory       */
 };
 
 
@@ -51,6 +53,7 @@ void mfc_release_all_buffer(int inst_no);
 void mfc_free_alloc_mem(struct mfc_alloc_mem *alloc_node, int port_no);
 enum mfc_error_code mfc_release_buffer(unsigned char *u_addr);
 enum mfc_error_code mfc_get_phys_addr(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args);
+enum mfc_error_code mfc_export_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args);
 enum mfc_error_code mfc_allocate_buffer(struct mfc_inst_ctx *mfc_ctx, union mfc_args *args, int port_no);
 
 #endif /* _MFC_BUFFER_MANAGER_H_ */
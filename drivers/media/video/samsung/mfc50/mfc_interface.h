@@ -30,6 +30,7 @@
 #define IOCTL_MFC_GET_IN_BUF			0x00800010
 #define IOCTL_MFC_FREE_BUF			0x00800011
 #define IOCTL_MFC_GET_PHYS_ADDR			0x00800012
+#define IOCTL_MFC_EXPORT_BUF			0x00800013
 #define IOCTL_MFC_GET_MMAP_SIZE			0x00800014
 
 #define IOCTL_MFC_SET_CONFIG			0x00800101
@@ -296,6 +297,11 @@ struct mfc_get_phys_addr_arg {
 	unsigned int p_addr;
 };
 
+struct mfc_export_buf_arg {
+	unsigned int u_addr;                 /* [IN]  buffer returned by IOCTL_MFC_GET_IN_BUF                */
+	int out_fd;                          /* [OUT] dma-buf file descriptor of the buffer                  */
+};
+
 struct mfc_mem_alloc_arg {
 	enum ssbsip_mfc_codec_type codec_type;
 	int buff_size;
@@ -328,6 +334,7 @@ union mfc_args {
 	struct mfc_mem_alloc_arg mem_alloc;
 	struct mfc_mem_free_arg mem_free;
 	struct mfc_get_phys_addr_arg get_phys_addr;
+	struct mfc_export_buf_arg export_buf;
 
 	enum mfc_buffer_type buf_type;
 };
@@ -23,6 +23,7 @@
 #include <linux/highmem.h>
 #include <linux/list.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
@@ -49,6 +50,17 @@
 	(__GFP_FS | __GFP_NORETRY | __GFP_NOWARN | __GFP_NOMEMALLOC)
 #endif
 
+/* same calling conventions, both return 0 on success */
+#ifdef CONFIG_ZCACHE_LZ4
+#define zcache_compress_page	lz4_compress
+#define zcache_decompress_page	lz4_decompress_unknownoutputsize
+#define ZCACHE_WORKMEM_BYTES	LZ4_MEM_COMPRESS
+#else
+#define zcache_compress_page	lzo1x_1_compress
+#define zcache_decompress_page	lzo1x_decompress_safe
+#define ZCACHE_WORKMEM_BYTES	LZO1X_1_MEM_COMPRESS
+#endif
+
 /**********
  * Compression buddies ("zbud") provides for packing two (or, possibly
  * in the future, more) compressed ephemeral pages into a single "raw"
@@ -389,8 +401,8 @@ static int zbud_decompress(struct page *page, struct zbud_hdr *zh)
 	to_va = kmap_atomic(page, KM_USER0);
 	size = zh->size;
 	from_va = zbud_data(zh, size);
-	ret = lzo1x_decompress_safe(from_va, size, to_va, &out_len);
-	BUG_ON(ret != LZO_E_OK);
+	ret = zcache_decompress_page(from_va, size, to_va, &out_len);
+	BUG_ON(ret != 0);
 	BUG_ON(out_len != PAGE_SIZE);
 	kunmap_atomic(to_va, KM_USER0);
 out:
@@ -658,10 +670,10 @@ static void zv_decompress(struct page *page, struct zv_hdr *zv)
 	size = xv_get_object_size(zv) - sizeof(*zv);
 	BUG_ON(size == 0 || size > zv_max_page_size);
 	to_va = kmap_atomic(page, KM_USER0);
-	ret = lzo1x_decompress_safe((char *)zv + sizeof(*zv),
+	ret = zcache_decompress_page((char *)zv + sizeof(*zv),
 					size, to_va, &clen);
 	kunmap_atomic(to_va, KM_USER0);
-	BUG_ON(ret != LZO_E_OK);
+	BUG_ON(ret != 0);
 	BUG_ON(clen != PAGE_SIZE);
 }
 
@@ -898,6 +910,17 @@ static unsigned long zcache_curr_eph_pampd_count_max;
 static atomic_t zcache_curr_pers_pampd_count = ATOMIC_INIT(0);
 static unsigned long zcache_curr_pers_pampd_count_max;
 
+/*
+ * FIXME: This is all the "policy" there is for now.
+ * 3/4 totpages should allow ~37% of RAM to be filled with
+ * compressed frontswap pages
+ */
+static inline bool zcache_pers_pool_full(void)
+{
+	return atomic_read(&zcache_curr_pers_pampd_count) >
+							3 * totalram_pages / 4;
+}
+
 /* forward reference */
 static int zcache_compress(struct page *from, void **out_va, size_t *out_len);
 
@@ -927,13 +950,7 @@ static void *zcache_pampd_create(struct tmem_pool *pool, struct tmem_oid *oid,
 				zcache_curr_eph_pampd_count_max = count;
 		}
 	} else {
-		/*
-		 * FIXME: This is all the "policy" there is for now.
-		 * 3/4 totpages should allow ~37% of RAM to be filled with
-		 * compressed frontswap pages
-		 */
-		if (atomic_read(&zcache_curr_pers_pampd_count) >
-							3 * totalram_pages / 4)
+		if (zcache_pers_pool_full())
 			goto out;
 		ret = zcache_compress(page, &cdata, &clen);
 		if (ret == 0)
@@ -997,7 +1014,6 @@ static struct tmem_pamops zcache_pamops = {
  * zcache compression/decompression and related per-cpu stuff
  */
 
-#define LZO_WORKMEM_BYTES LZO1X_1_MEM_COMPRESS
 #define LZO_DSTMEM_PAGE_ORDER 1
 static DEFINE_PER_CPU(unsigned char *, zcache_workmem);
 static DEFINE_PER_CPU(unsigned char *, zcache_dstmem);
@@ -1014,8 +1030,8 @@ static int zcache_compress(struct page *from, void **out_va, size_t *out_len)
 		goto out;  /* no buffer, so can't compress */
 	from_va = kmap_atomic(from, KM_USER0);
 	mb();
-	ret = lzo1x_1_compress(from_va, PAGE_SIZE, dmem, out_len, wmem);
-	BUG_ON(ret != LZO_E_OK);
+	ret = zcache_compress_page(from_va, PAGE_SIZE, dmem, out_len, wmem);
+	BUG_ON(ret != 0);
 	*out_va = dmem;
 	kunmap_atomic(from_va, KM_USER0);
 	ret = 1;
@@ -1036,7 +1052,7 @@ static int zcache_cpu_notifier(struct notifier_block *nb,
 			GFP_KERNEL | __GFP_REPEAT,
 			LZO_DSTMEM_PAGE_ORDER),
 		per_cpu(zcache_workmem, cpu) =
-			kzalloc(LZO1X_MEM_COMPRESS,
+			kzalloc(ZCACHE_WORKMEM_BYTES,
 				GFP_KERNEL | __GFP_REPEAT);
 		break;
 	case CPU_DEAD:
@@ -1487,6 +1503,9 @@ static int zcache_frontswap_put_page(unsigned type, pgoff_t offset,
 					iswiz(ind), page);
 		local_irq_restore(flags);
 	}
+	/* frontswap makes room by writing back its oldest pages */
+	if (ret < 0 && zcache_pers_pool_full())
+		ret = -ENOSPC;
 	return ret;
 }
 
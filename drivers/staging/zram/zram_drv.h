@@ -57,6 +57,21 @@ static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*-- End of configurable params */
 
+/*
+ * Compressed pages only live in memory, so the compressor is a build
+ * time choice.  Both take (src, src_len, dst, &dst_len[, wrkmem]) and
+ * return 0 on success.
+ */
+#ifdef CONFIG_ZRAM_LZ4
+#define zram_compress		lz4_compress
+#define zram_decompress		lz4_decompress_unknownoutputsize
+#define ZRAM_COMPRESS_WORKMEM	LZ4_MEM_COMPRESS
+#else
+#define zram_compress		lzo1x_1_compress
+#define zram_decompress		lzo1x_decompress_safe
+#define ZRAM_COMPRESS_WORKMEM	LZO1X_MEM_COMPRESS
+#endif
+
 #define SECTOR_SHIFT		9
 #define SECTOR_SIZE		(1 << SECTOR_SHIFT)
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
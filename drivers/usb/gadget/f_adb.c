@@ -32,6 +32,19 @@
 /* number of tx requests to allocate */
 #define TX_REQ_MAX 4
 
+/*
+ * Bulk request size and TX queue depth; adbd may then move payloads of up
+ * to adb_req_len per read() and write().  Falls back to
+ * ADB_BULK_BUFFER_SIZE and TX_REQ_MAX if the buffers cannot be allocated.
+ */
+static unsigned int adb_req_len = 16384;
+module_param(adb_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_req_len, "ADB bulk request size in bytes");
+
+static unsigned int adb_tx_reqs = 8;
+module_param(adb_tx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_tx_reqs, "number of ADB bulk IN requests");
+
 static const char adb_shortname[] = "android_adb";
 
 struct adb_dev {
@@ -55,6 +68,9 @@ struct adb_dev {
 	wait_queue_head_t write_wq;
 	struct usb_request *rx_req;
 	int rx_done;
+
+	/* size the bulk requests were allocated with */
+	unsigned int req_len;
 };
 
 static struct usb_interface_descriptor adb_interface_desc = {
@@ -218,6 +234,7 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
 	struct usb_ep *ep;
+	unsigned int tx_reqs;
 	int i;
 
 	DBG(cdev, "create_bulk_endpoints dev: %p\n", dev);
@@ -240,23 +257,41 @@ static int adb_create_bulk_endpoints(struct adb_dev *dev,
 	ep->driver_data = dev;		/* claim the endpoint */
 	dev->ep_out = ep;
 
-	/* now allocate requests for our endpoints */
-	req = adb_request_new(dev->ep_out, ADB_BULK_BUFFER_SIZE);
+	/*
+	 * now allocate requests for our endpoints; OUT requests must be a
+	 * multiple of the high speed packet size
+	 */
+	tx_reqs = max(adb_tx_reqs, 1U);
+	dev->req_len = max(adb_req_len & ~511U, (unsigned)ADB_BULK_BUFFER_SIZE);
+
+retry_alloc:
+	req = adb_request_new(dev->ep_out, dev->req_len);
 	if (!req)
-		goto fail;
+		goto fallback;
 	req->complete = adb_complete_out;
 	dev->rx_req = req;
 
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_in, ADB_BULK_BUFFER_SIZE);
+	for (i = 0; i < tx_reqs; i++) {
+		req = adb_request_new(dev->ep_in, dev->req_len);
 		if (!req)
-			goto fail;
+			goto fallback;
 		req->complete = adb_complete_in;
 		adb_req_put(dev, &dev->tx_idle, req);
 	}
 
 	return 0;
 
+fallback:
+	if (dev->req_len == ADB_BULK_BUFFER_SIZE)
+		goto fail;
+	adb_request_free(dev->rx_req, dev->ep_out);
+	dev->rx_req = NULL;
+	while ((req = adb_req_get(dev, &dev->tx_idle)))
+		adb_request_free(req, dev->ep_in);
+	dev->req_len = ADB_BULK_BUFFER_SIZE;
+	tx_reqs = TX_REQ_MAX;
+	goto retry_alloc;
+
 fail:
 	printk(KERN_ERR "adb_bind() could not allocate requests\n");
 	return -1;
@@ -274,7 +309,7 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 	if (!_adb_dev)
 		return -ENODEV;
 
-	if (count > ADB_BULK_BUFFER_SIZE)
+	if (count > dev->req_len)
 		return -EINVAL;
 
 	if (adb_lock(&dev->read_excl))
@@ -370,8 +405,8 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 		}
 
 		if (req != 0) {
-			if (count > ADB_BULK_BUFFER_SIZE)
-				xfer = ADB_BULK_BUFFER_SIZE;
+			if (count > dev->req_len)
+				xfer = dev->req_len;
 			else
 				xfer = count;
 			if (copy_from_user(req->buf, buf, xfer)) {
@@ -54,6 +54,24 @@
 #define RX_REQ_MAX 2
 #define INTR_REQ_MAX 5
 
+/*
+ * Bulk request size and TX queue depth used for file transfers.  Larger
+ * requests mean fewer completions and fewer vfs calls per megabyte; if
+ * the buffers cannot be allocated at bind time we fall back to
+ * MTP_BULK_BUFFER_SIZE and TX_REQ_MAX.
+ */
+static unsigned int mtp_tx_req_len = 65536;
+module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_req_len, "MTP bulk IN request size in bytes");
+
+static unsigned int mtp_rx_req_len = 65536;
+module_param(mtp_rx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_rx_req_len, "MTP bulk OUT request size in bytes");
+
+static unsigned int mtp_tx_reqs = 8;
+module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_reqs, "number of MTP bulk IN requests");
+
 /* ID for Microsoft MTP OS String */
 #define MTP_OS_STRING_ID   0xEE
 
@@ -94,6 +112,10 @@ struct mtp_dev {
 	struct usb_request *rx_req[RX_REQ_MAX];
 	int rx_done;
 
+	/* sizes the bulk requests were allocated with */
+	unsigned int tx_req_len;
+	unsigned int rx_req_len;
+
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
 	 */
@@ -388,6 +410,7 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
 	struct usb_ep *ep;
+	unsigned int tx_reqs;
 	int i;
 
 	DBG(cdev, "create_bulk_endpoints dev: %p\n", dev);
@@ -428,18 +451,45 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	ep->driver_data = dev;		/* claim the endpoint */
 	dev->ep_intr = ep;
 
-	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+	/*
+	 * now allocate requests for our endpoints; all but the last request
+	 * of a transfer must be a multiple of the high speed packet size
+	 */
+	tx_reqs = max(mtp_tx_reqs, 1U);
+	dev->tx_req_len = max(mtp_tx_req_len & ~511U,
+			      (unsigned)MTP_BULK_BUFFER_SIZE);
+	dev->rx_req_len = max(mtp_rx_req_len & ~511U,
+			      (unsigned)MTP_BULK_BUFFER_SIZE);
+
+retry_tx_alloc:
+	for (i = 0; i < tx_reqs; i++) {
+		req = mtp_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len == MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while ((req = mtp_req_get(dev, &dev->tx_idle)))
+				mtp_request_free(req, dev->ep_in);
+			dev->tx_req_len = MTP_BULK_BUFFER_SIZE;
+			tx_reqs = TX_REQ_MAX;
+			goto retry_tx_alloc;
+		}
 		req->complete = mtp_complete_in;
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
+
+retry_rx_alloc:
 	for (i = 0; i < RX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_out, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+		req = mtp_request_new(dev->ep_out, dev->rx_req_len);
+		if (!req) {
+			if (dev->rx_req_len == MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while (--i >= 0) {
+				mtp_request_free(dev->rx_req[i], dev->ep_out);
+				dev->rx_req[i] = NULL;
+			}
+			dev->rx_req_len = MTP_BULK_BUFFER_SIZE;
+			goto retry_rx_alloc;
+		}
 		req->complete = mtp_complete_out;
 		dev->rx_req[i] = req;
 	}
@@ -469,7 +519,7 @@ static ssize_t mtp_read(struct file *fp, char __user *buf,
 
 	DBG(cdev, "mtp_read(%d)\n", count);
 
-	if (count > MTP_BULK_BUFFER_SIZE)
+	if (count > dev->rx_req_len)
 		return -EINVAL;
 
 	/* we will block until we're online */
@@ -589,8 +639,8 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 		if (xfer && copy_from_user(req->buf, buf, xfer)) {
@@ -681,8 +731,8 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 
@@ -753,8 +803,8 @@ static void receive_file_work(struct work_struct *data)
 			read_req = dev->rx_req[cur_buf];
 			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
 
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
-					? MTP_BULK_BUFFER_SIZE : count);
+			read_req->length = (count > dev->rx_req_len
+					? dev->rx_req_len : count);
 			dev->rx_done = 0;
 			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
 			if (ret < 0) {
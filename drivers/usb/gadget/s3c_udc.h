@@ -39,6 +39,7 @@
 #include <linux/mm.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
 
 #include <asm/byteorder.h>
 #include <asm/dma.h>
@@ -112,6 +113,13 @@ struct s3c_request {
 	struct usb_request req;
 	struct list_head queue;
 	unsigned char mapped;
+	unsigned char zlp;		/* trailing zero length packet sent */
+
+	/* data endpoints: position of the chunk programmed into DxEPTSIZ */
+	struct scatterlist *sg;
+	unsigned sg_left;
+	unsigned sg_off;
+	unsigned xfer_len;
 };
 
 struct s3c_udc {
@@ -420,6 +420,8 @@ static void done(struct s3c_ep *ep, struct s3c_request *req, int status)
 {
 	unsigned int stopped = ep->stopped;
 	struct device *dev = &the_controller->dev->dev;
+	enum dma_data_direction dir = (ep->bEndpointAddress & USB_DIR_IN) ?
+				DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	DEBUG("%s: %s %p, req = %p, stopped = %d\n",
 		__func__, ep->ep.name, ep, &req->req, stopped);
 
@@ -431,10 +433,14 @@ static void done(struct s3c_ep *ep, struct s3c_request *req, int status)
 		status = req->req.status;
 
 	if (req->mapped) {
-		dma_unmap_single(dev, req->req.dma, req->req.length,
-				(ep->bEndpointAddress & USB_DIR_IN) ?
-				DMA_TO_DEVICE : DMA_FROM_DEVICE);
-		req->req.dma = DMA_ADDR_INVALID;
+		if (req->req.num_mapped_sgs) {
+			dma_unmap_sg(dev, req->req.sg, req->req.num_sgs, dir);
+			req->req.num_mapped_sgs = 0;
+		} else {
+			dma_unmap_single(dev, req->req.dma, req->req.length,
+					dir);
+			req->req.dma = DMA_ADDR_INVALID;
+		}
 		req->mapped = 0;
 	}
 	if (status && status != -ESHUTDOWN) {
@@ -935,6 +941,7 @@ static struct s3c_udc memory = {
 		   .ops = &s3c_udc_ops,
 		   .ep0 = &memory.ep[0].ep,
 		   .name = driver_name,
+		   .sg_supported = 1,
 		   .dev = {
 			   .release = nop_release,
 			   },
@@ -28,6 +28,9 @@
 
 #define	DMA_ADDR_INVALID	(~(dma_addr_t)0)
 
+/* endpoint interrupt passes per s3c_udc_irq() call */
+#define EP_INTR_LOOPS		4
+
 static u8 clear_feature_num;
 static int clear_feature_flag;
 static int set_conf_done;
@@ -178,6 +181,191 @@ static int setdma_tx(struct s3c_ep *ep, struct s3c_request *req)
 	return length;
 }
 
+/*
+ * Data endpoint requests are mapped once when they are queued, so that the
+ * cache maintenance is paid by the submitter and not in the interrupt
+ * handler while the endpoint sits idle between two requests.
+ */
+static int s3c_udc_map_request(struct s3c_ep *ep, struct s3c_request *req)
+{
+	struct device *dev = &the_controller->dev->dev;
+	enum dma_data_direction dir = ep_is_in(ep) ?
+				DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	struct scatterlist *sg;
+	int i, nents;
+
+	req->zlp = 0;
+	req->sg = NULL;
+
+	if (!req->req.num_sgs) {
+		req->req.dma = dma_map_single(dev, req->req.buf,
+				req->req.length, dir);
+		req->mapped = 1;
+		return 0;
+	}
+
+	nents = dma_map_sg(dev, req->req.sg, req->req.num_sgs, dir);
+	if (!nents)
+		return -ENOMEM;
+
+	/* a segment that is not a whole number of packets ends in a short one */
+	for_each_sg(req->req.sg, sg, nents - 1, i) {
+		if (sg_dma_len(sg) % ep_maxpacket(ep)) {
+			dma_unmap_sg(dev, req->req.sg, req->req.num_sgs, dir);
+			return -EINVAL;
+		}
+	}
+
+	req->req.num_mapped_sgs = nents;
+	req->sg = req->req.sg;
+	req->sg_left = nents;
+	req->sg_off = 0;
+	req->mapped = 1;
+
+	return 0;
+}
+
+/*
+ * Program the next chunk of a data endpoint request. A chunk stays within
+ * one scatterlist segment and is only bounded by the width of the DxEPTSIZ
+ * fields, so a request costs one transfer complete interrupt per segment
+ * or per 511KB, whichever is smaller.
+ */
+static void s3c_udc_start_xfer(struct s3c_ep *ep, struct s3c_request *req)
+{
+	u32 ep_num = ep_index(ep);
+	u32 maxpacket = ep_maxpacket(ep);
+	u32 length, pktcnt, max, ctrl;
+	dma_addr_t dma;
+
+	if (req->sg) {
+		dma = sg_dma_address(req->sg) + req->sg_off;
+		length = sg_dma_len(req->sg) - req->sg_off;
+	} else {
+		dma = req->req.dma + req->req.actual;
+		length = req->req.length - req->req.actual;
+	}
+
+	max = min_t(u32, DEPTSIZ_PKT_CNT_MAX * maxpacket,
+			DEPTSIZ_XFER_SIZE_MAX);
+	length = min(length, max - max % maxpacket);
+
+	if (length == 0)
+		pktcnt = 1;
+	else
+		pktcnt = DIV_ROUND_UP(length, maxpacket);
+
+	req->xfer_len = length;
+
+	if (ep_is_in(ep)) {
+		ctrl = readl(S3C_UDC_OTG_DIEPCTL(ep_num));
+#ifdef DED_TX_FIFO
+		ctrl &= ~DEPCTL_TXFNUM_MASK;
+		ctrl |= (ep_num << DEPCTL_TXFNUM_BIT);
+#endif
+		writel(dma, S3C_UDC_OTG_DIEPDMA(ep_num));
+		writel((pktcnt << DEPTSIZ_PKT_CNT_BIT) | length,
+			S3C_UDC_OTG_DIEPTSIZ(ep_num));
+		writel(DEPCTL_EPENA|DEPCTL_CNAK|ctrl,
+			S3C_UDC_OTG_DIEPCTL(ep_num));
+	} else {
+		ctrl = readl(S3C_UDC_OTG_DOEPCTL(ep_num));
+		writel(dma, S3C_UDC_OTG_DOEPDMA(ep_num));
+		writel((pktcnt << DEPTSIZ_PKT_CNT_BIT) | length,
+			S3C_UDC_OTG_DOEPTSIZ(ep_num));
+		writel(DEPCTL_EPENA|DEPCTL_CNAK|ctrl,
+			S3C_UDC_OTG_DOEPCTL(ep_num));
+	}
+
+	DEBUG("%s: EP%d %s DMA start : dma = 0x%x, pktcnt = %d, "
+		"xfersize = %d, %d/%d done\n",
+		__func__, ep_num, ep_is_in(ep) ? "TX" : "RX", dma, pktcnt,
+		length, req->req.actual, req->req.length);
+}
+
+/*
+ * Account the chunk that just completed. Returns 1 once the request is
+ * finished, or 0 when the next chunk (or the trailing zero length packet)
+ * has been started.
+ */
+static int s3c_udc_xfer_done(struct s3c_ep *ep, struct s3c_request *req)
+{
+	u32 ep_num = ep_index(ep);
+	u32 left, count;
+	int is_short = 0;
+
+	if (ep_is_in(ep))
+		left = readl(S3C_UDC_OTG_DIEPTSIZ(ep_num));
+	else
+		left = readl(S3C_UDC_OTG_DOEPTSIZ(ep_num));
+	left &= DEPTSIZ_XFER_SIZE_MAX;
+
+	count = req->xfer_len - left;
+	req->req.actual += count;
+
+	/* OUT transfers end early on a short packet */
+	if (!ep_is_in(ep))
+		is_short = left || (count % ep_maxpacket(ep));
+
+	if (req->sg) {
+		req->sg_off += count;
+		if (req->sg_off == sg_dma_len(req->sg)) {
+			req->sg = --req->sg_left ? sg_next(req->sg) : NULL;
+			req->sg_off = 0;
+		}
+	}
+
+	if (!is_short && req->req.actual < req->req.length &&
+	    (req->sg || !req->req.num_mapped_sgs)) {
+		s3c_udc_start_xfer(ep, req);
+		return 0;
+	}
+
+	if (ep_is_in(ep) && req->req.zero && !req->zlp && req->req.length &&
+	    !(req->req.length % ep_maxpacket(ep))) {
+		req->zlp = 1;
+		req->sg = NULL;
+		s3c_udc_start_xfer(ep, req);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Transfer complete on a data endpoint. The next queued request is already
+ * mapped, so it is handed to the core before the completion callback of
+ * the finished one runs and the endpoint does not idle across it.
+ */
+static void s3c_udc_complete_xfer(struct s3c_udc *dev, u8 ep_num)
+{
+	struct s3c_ep *ep = &dev->ep[ep_num];
+	struct s3c_request *req, *next = NULL;
+
+	if (list_empty(&ep->queue)) {
+		DEBUG("%s: DMA done : NULL REQ on EP-%d\n", __func__, ep_num);
+		return;
+	}
+
+	req = list_entry(ep->queue.next, struct s3c_request, queue);
+
+	if (!s3c_udc_xfer_done(ep, req))
+		return;
+
+	if (!list_is_last(&req->queue, &ep->queue)) {
+		next = list_entry(req->queue.next, struct s3c_request, queue);
+		s3c_udc_start_xfer(ep, next);
+	}
+
+	done(ep, req, 0);
+
+	/* requests queued from the callback find the endpoint stopped */
+	if (!next && !list_empty(&ep->queue)) {
+		req = list_entry(ep->queue.next, struct s3c_request, queue);
+		s3c_udc_start_xfer(ep, req);
+	}
+}
+
 static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 {
 	struct s3c_ep *ep = &dev->ep[ep_num];
@@ -295,10 +483,7 @@ static inline void s3c_udc_check_tx_queue(struct s3c_udc *dev, u8 ep_num)
 		req = list_entry(ep->queue.next, struct s3c_request, queue);
 		DEBUG_IN_EP("%s: Next Tx request(0x%p) start...\n", __func__, req);
 
-		if (ep_is_in(ep))
-			setdma_tx(ep, req);
-		else
-			setdma_rx(ep, req);
+		s3c_udc_start_xfer(ep, req);
 	} else {
 		DEBUG_IN_EP("%s: NULL REQ on IN EP-%d\n", __func__, ep_num);
 
@@ -328,9 +513,11 @@ static void process_ep_in_intr(struct s3c_udc *dev)
 			writel(ep_intr_status, S3C_UDC_OTG_DIEPINT(ep_num));
 
 			if (ep_intr_status & TRANSFER_DONE) {
-				complete_tx(dev, ep_num);
+				if (ep_num != 0) {
+					s3c_udc_complete_xfer(dev, ep_num);
+				} else {
+					complete_tx(dev, ep_num);
 
-				if (ep_num == 0) {
 					if (dev->ep0state == WAIT_FOR_SETUP)
 						s3c_udc_pre_setup();
 
@@ -389,7 +576,7 @@ static void process_ep_out_intr(struct s3c_udc *dev)
 
 			} else {
 				if (ep_intr_status & TRANSFER_DONE)
-					complete_rx(dev, ep_num);
+					s3c_udc_complete_xfer(dev, ep_num);
 			}
 		}
 		ep_num++;
@@ -406,6 +593,7 @@ static irqreturn_t s3c_udc_irq(int irq, void *_dev)
 	u32 intr_status;
 	u32 usb_status, gintmsk;
 	unsigned long flags;
+	int loops;
 
 	spin_lock_irqsave(&dev->lock, flags);
 
@@ -516,11 +704,23 @@ static irqreturn_t s3c_udc_irq(int irq, void *_dev)
 		}
 	}
 
-	if (intr_status & INT_IN_EP)
-		process_ep_in_intr(dev);
+	/*
+	 * Completions that arrive while the previous ones are handled are
+	 * serviced without taking the exception again, which is the common
+	 * case when bulk IN and OUT streams run back to back.
+	 */
+	for (loops = 0; loops < EP_INTR_LOOPS; loops++) {
+		if (!(intr_status & (INT_IN_EP | INT_OUT_EP)))
+			break;
+
+		if (intr_status & INT_IN_EP)
+			process_ep_in_intr(dev);
 
-	if (intr_status & INT_OUT_EP)
-		process_ep_out_intr(dev);
+		if (intr_status & INT_OUT_EP)
+			process_ep_out_intr(dev);
+
+		intr_status = readl(S3C_UDC_OTG_GINTSTS) & gintmsk;
+	}
 
 	spin_unlock_irqrestore(&dev->lock, flags);
 
@@ -537,10 +737,12 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 	struct s3c_ep *ep;
 	struct s3c_udc *dev;
 	unsigned long flags;
-	u32 ep_num, gintsts;
+	u32 ep_num;
+	int ret;
 
 	req = container_of(_req, struct s3c_request, req);
-	if (unlikely(!_req || !_req->complete || !_req->buf || !list_empty(&req->queue))) {
+	if (unlikely(!_req || !_req->complete || (!_req->buf && !_req->num_sgs) ||
+			!list_empty(&req->queue))) {
 
 		DEBUG("%s: bad params\n", __func__);
 		return -EINVAL;
@@ -562,6 +764,18 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 		return -ESHUTDOWN;
 	}
 
+	if (ep_num == 0) {
+		if (unlikely(_req->num_sgs))
+			return -EINVAL;
+	} else {
+		ret = s3c_udc_map_request(ep, req);
+		if (ret) {
+			DEBUG("%s: %s can't map req = %p\n",
+				__func__, _ep->name, _req);
+			return ret;
+		}
+	}
+
 	spin_lock_irqsave(&dev->lock, flags);
 
 	_req->status = -EINPROGRESS;
@@ -583,12 +797,8 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 			req = 0;
 
 		} else if (ep_is_in(ep)) {
-			gintsts = readl(S3C_UDC_OTG_GINTSTS);
-			DEBUG_IN_EP("%s: ep_is_in, S3C_UDC_OTG_GINTSTS=0x%x\n",
-						__func__, gintsts);
-
 			if (set_conf_done == 1) {
-				setdma_tx(ep, req);
+				s3c_udc_start_xfer(ep, req);
 			} else {
 				done(ep, req, 0);
 				DEBUG("%s: Not yet Set_configureation, ep_num = %d, req = %p\n",
@@ -597,11 +807,7 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 			}
 
 		} else {
-			gintsts = readl(S3C_UDC_OTG_GINTSTS);
-			DEBUG_OUT_EP("%s: ep_is_out, S3C_UDC_OTG_GINTSTS=0x%x\n",
-				__func__, gintsts);
-
-			setdma_rx(ep, req);
+			s3c_udc_start_xfer(ep, req);
 		}
 	}
 
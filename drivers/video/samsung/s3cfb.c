@@ -29,6 +29,9 @@
 #include <linux/io.h>
 #include <linux/memory.h>
 #include <linux/cpufreq.h>
+#include <linux/math64.h>
+#include <linux/kref.h>
+#include <linux/slab.h>
 #include <plat/clock.h>
 #include <plat/cpu-freq.h>
 #ifdef CONFIG_HAS_WAKELOCK
@@ -109,18 +112,128 @@ static int s3cfb_draw_logo(struct fb_info *fb)
 }
 #endif
 
+/* called with flip_lock held */
+static void s3cfb_flip_latch(struct s3cfb_global *ctrl,
+			     struct s3cfb_window *win, struct s3cfb_flip *flip)
+{
+	struct fb_info *fb = ctrl->fb[win->id];
+
+	if (win->owner == DMA_MEM_OTHER)
+		fb->fix.smem_start = win->other_mem_addr;
+
+	fb->var.yoffset = flip->yoffset;
+	s3cfb_set_buffer_address(ctrl, win->id);
+
+	win->flip_latched = *flip;
+	win->flip_latched_valid = 1;
+}
+
+/* called with flip_lock held */
+static void s3cfb_flip_present(struct s3cfb_global *ctrl,
+			       struct s3cfb_window *win, ktime_t now)
+{
+	struct s3cfb_flip *flip = &win->flip_latched;
+	struct s3cfb_flip_stats *stats = &win->flip_stats;
+	u64 latency = ktime_to_ns(ktime_sub(now, flip->queued));
+
+	win->flip_status.id = flip->id;
+	win->flip_status.frame = ctrl->vsync_count;
+	win->flip_status.timestamp = ktime_to_ns(now);
+
+	stats->flips++;
+	if (ctrl->vsync_count - flip->frame > 1)
+		stats->missed++;
+
+	stats->latency_ns += latency;
+	if (latency > stats->max_latency_ns)
+		stats->max_latency_ns = latency;
+
+	win->flip_latched_valid = 0;
+}
+
+/* called with flip_lock held */
+static void s3cfb_flip_next(struct s3cfb_global *ctrl,
+			    struct s3cfb_window *win)
+{
+	s3cfb_flip_latch(ctrl, win, &win->flip[win->flip_head]);
+
+	win->flip_head = (win->flip_head + 1) % ARRAY_SIZE(win->flip);
+	win->flip_count--;
+}
+
+/*
+ * The window address registers are shadowed and only take effect at the
+ * next vsync, so the flip written at the previous interrupt is the one
+ * which has just reached the screen.
+ */
 static irqreturn_t s3cfb_irq_frame(int irq, void *data)
 {
 	struct s3cfb_global *fbdev = (struct s3cfb_global *)data;
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	ktime_t now = ktime_get();
+	int i;
 
 	s3cfb_clear_interrupt(fbdev);
 
-	complete_all(&fbdev->fb_complete);
+	spin_lock(&fbdev->flip_lock);
+
+	fbdev->vsync_count++;
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		if (win->flip_latched_valid)
+			s3cfb_flip_present(fbdev, win, now);
+
+		if (win->flip_count)
+			s3cfb_flip_next(fbdev, win);
+	}
+
+	spin_unlock(&fbdev->flip_lock);
+
+	wake_up_interruptible_all(&fbdev->vsync_wait);
 
 	return IRQ_HANDLED;
 }
 
-static void s3cfb_set_window(struct s3cfb_global *ctrl, int id, int enable)
+/*
+ * Put the newest queued buffer on the window right away, for when no more
+ * vsync interrupts are to be expected.
+ */
+static void s3cfb_flip_flush(struct s3cfb_global *ctrl,
+			     struct s3cfb_window *win)
+{
+	unsigned long flags;
+	ktime_t now = ktime_get();
+
+	spin_lock_irqsave(&ctrl->flip_lock, flags);
+
+	if (win->flip_latched_valid)
+		s3cfb_flip_present(ctrl, win, now);
+
+	while (win->flip_count) {
+		s3cfb_flip_next(ctrl, win);
+		s3cfb_flip_present(ctrl, win, now);
+	}
+
+	spin_unlock_irqrestore(&ctrl->flip_lock, flags);
+
+	wake_up_interruptible_all(&ctrl->vsync_wait);
+}
+
+/* the vsync interrupt is shared, so none of the windows will see one */
+static void s3cfb_flip_flush_all(struct s3cfb_global *ctrl)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	int i;
+
+	for (i = 0; i < pdata->nr_wins; i++)
+		s3cfb_flip_flush(ctrl, ctrl->fb[i]->par);
+}
+
+/* called with flip_lock held, the vsync path also writes S3C_WINSHMAP */
+static void __s3cfb_set_window(struct s3cfb_global *ctrl, int id, int enable)
 {
 	struct s3cfb_window *win = ctrl->fb[id]->par;
 
@@ -133,12 +246,20 @@ static void s3cfb_set_window(struct s3cfb_global *ctrl, int id, int enable)
 	}
 }
 
+static void s3cfb_set_window(struct s3cfb_global *ctrl, int id, int enable)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctrl->flip_lock, flags);
+	__s3cfb_set_window(ctrl, id, enable);
+	spin_unlock_irqrestore(&ctrl->flip_lock, flags);
+}
+
 static int s3cfb_init_global(struct s3cfb_global *ctrl)
 {
 	ctrl->output = OUTPUT_RGB;
 	ctrl->rgb_mode = MODE_RGB_P;
 
-	init_completion(&ctrl->fb_complete);
 	mutex_init(&ctrl->lock);
 
 	s3cfb_set_output(ctrl);
@@ -150,6 +271,49 @@ static int s3cfb_init_global(struct s3cfb_global *ctrl)
 	return 0;
 }
 
+/*
+ * struct s3cfb_vmem
+ * @ref:		held by the window and by each dma-buf exported from it
+ * @dev:		device the memory was allocated for
+ * @cpu:		kernel mapping
+ * @dma:		bus address
+ * @size:		length of the allocation
+ * @pmem:		carved out by the board, only ioremapped
+ *
+ * The memory a window allocated itself may still be scanned out until the
+ * next vsync or be mapped by importers after the window has let go of it,
+ * so it is freed when the last reference is dropped.
+*/
+struct s3cfb_vmem {
+	struct kref	ref;
+	struct device	*dev;
+	char __iomem	*cpu;
+	dma_addr_t	dma;
+	size_t		size;
+	int		pmem;
+};
+
+static void s3cfb_vmem_free(struct kref *ref)
+{
+	struct s3cfb_vmem *vmem = container_of(ref, struct s3cfb_vmem, ref);
+
+	if (vmem->pmem)
+		iounmap(vmem->cpu);
+	else
+		dma_free_writecombine(vmem->dev, vmem->size,
+				(void __force *)vmem->cpu, vmem->dma);
+
+	kfree(vmem);
+}
+
+/* also the release callback of the exported dma-bufs */
+static void s3cfb_vmem_put(void *data)
+{
+	struct s3cfb_vmem *vmem = data;
+
+	kref_put(&vmem->ref, s3cfb_vmem_free);
+}
+
 static int s3cfb_map_video_memory(struct fb_info *fb)
 {
 	struct fb_fix_screeninfo *fix = &fb->fix;
@@ -157,6 +321,7 @@ static int s3cfb_map_video_memory(struct fb_info *fb)
 	struct s3cfb_global *fbdev =
 		platform_get_drvdata(to_platform_device(fb->device));
 	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_vmem *vmem;
 
 	if (win->owner == DMA_MEM_OTHER) {
 		fix->smem_start = win->other_mem_addr;
@@ -167,10 +332,15 @@ static int s3cfb_map_video_memory(struct fb_info *fb)
 	if (fb->screen_base)
 		return 0;
 
+	vmem = kzalloc(sizeof(*vmem), GFP_KERNEL);
+	if (!vmem)
+		return -ENOMEM;
+
 	if (pdata && pdata->pmem_start[win->id] && (pdata->pmem_size[win->id] >= fix->smem_len)) {
 		fix->smem_start = pdata->pmem_start[win->id];
 		fix->smem_len = pdata->pmem_size[win->id]; 
 		fb->screen_base = ioremap_wc(fix->smem_start, pdata->pmem_size[win->id]);
+		vmem->pmem = 1;
 
 		dev_err(fbdev->dev, "win %d: pmem_start=0x%x\n",
 				win->id, pdata->pmem_start[win->id]);
@@ -182,9 +352,17 @@ static int s3cfb_map_video_memory(struct fb_info *fb)
 
 	if (!fb->screen_base) {
 		printk("s3cfb: map video memory failed\n");
+		kfree(vmem);
 		return -ENOMEM;
 	}
 
+	kref_init(&vmem->ref);
+	vmem->dev = fbdev->dev;
+	vmem->cpu = fb->screen_base;
+	vmem->dma = fix->smem_start;
+	vmem->size = vmem->pmem ? fix->smem_len : PAGE_ALIGN(fix->smem_len);
+	win->vmem = vmem;
+
 	dev_info(fbdev->dev, "[fb%d] dma: 0x%08x, cpu: 0x%08x, "
 			"size: 0x%08x\n", win->id,
 			(unsigned int)fix->smem_start,
@@ -225,22 +403,22 @@ static int s3cfb_map_default_video_memory(struct fb_info *fb)
 	return 0;
 }
 
-static int s3cfb_unmap_video_memory(struct fb_info *fb)
+/*
+ * Takes the memory the window allocated away from it, returning the
+ * reference the window held, or NULL if it scans out other memory.
+ */
+static struct s3cfb_vmem *s3cfb_detach_video_memory(struct fb_info *fb)
 {
 	struct s3cfb_global *fbdev =
 		platform_get_drvdata(to_platform_device(fb->device));
-	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
 	struct fb_fix_screeninfo *fix = &fb->fix;
 	struct s3cfb_window *win = fb->par;
+	struct s3cfb_vmem *vmem = NULL;
 
 	if (fix->smem_start) {
 		if (win->owner == DMA_MEM_FIMD) {
-			if (pdata && pdata->pmem_start[win->id] &&
-					(pdata->pmem_size[win->id] >= fix->smem_len))
-				iounmap(fb->screen_base);
-			else
-				dma_free_writecombine(fbdev->dev, fix->smem_len,
-						fb->screen_base, fix->smem_start);
+			vmem = win->vmem;
+			win->vmem = NULL;
 		}
 
 		fix->smem_start = 0;
@@ -249,6 +427,16 @@ static int s3cfb_unmap_video_memory(struct fb_info *fb)
 		dev_info(fbdev->dev, "[fb%d] video memory released\n", win->id);
 	}
 
+	return vmem;
+}
+
+static int s3cfb_unmap_video_memory(struct fb_info *fb)
+{
+	struct s3cfb_vmem *vmem = s3cfb_detach_video_memory(fb);
+
+	if (vmem)
+		s3cfb_vmem_put(vmem);
+
 	return 0;
 }
 
@@ -263,8 +451,10 @@ static int s3cfb_unmap_default_video_memory(struct fb_info *fb)
 #if defined(CONFIG_FB_S3C_VIRTUAL)
 		iounmap(fb->screen_base);
 #else
-		dma_free_writecombine(fbdev->dev, fix->smem_len,
-				fb->screen_base, fix->smem_start);
+		if (win->vmem) {
+			s3cfb_vmem_put(win->vmem);
+			win->vmem = NULL;
+		}
 #endif
 
 		fix->smem_start = 0;
@@ -386,6 +576,10 @@ static int s3cfb_check_var(struct fb_var_screeninfo *var, struct fb_info *fb)
 
 static void s3cfb_set_win_params(struct s3cfb_global *ctrl, int id)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctrl->flip_lock, flags);
+
 	s3cfb_set_window_control(ctrl, id);
 	s3cfb_set_window_position(ctrl, id);
 	s3cfb_set_window_size(ctrl, id);
@@ -396,6 +590,8 @@ static void s3cfb_set_win_params(struct s3cfb_global *ctrl, int id)
 		s3cfb_set_alpha_blending(ctrl, id);
 		s3cfb_set_chroma_key(ctrl, id);
 	}
+
+	spin_unlock_irqrestore(&ctrl->flip_lock, flags);
 }
 static int s3cfb_set_par(struct fb_info *fb)
 {
@@ -467,12 +663,16 @@ static int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 	struct s3cfb_window *win = fb->par;
 	struct s3cfb_global *fbdev =
 		platform_get_drvdata(to_platform_device(fb->device));
+	unsigned long flags;
 
 	if (var->yoffset + var->yres > var->yres_virtual) {
 		dev_err(fbdev->dev, "invalid yoffset value\n");
 		return -EINVAL;
 	}
 
+	/* an explicit pan overrides whatever is still queued */
+	s3cfb_flip_flush(fbdev, win);
+
 	if (win->owner == DMA_MEM_OTHER)
 		fix->smem_start = win->other_mem_addr;
 
@@ -481,7 +681,9 @@ static int s3cfb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fb)
 	dev_dbg(fbdev->dev, "[fb%d] yoffset for pan display: %d\n",
 			win->id, var->yoffset);
 
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
 	s3cfb_set_buffer_address(fbdev, win->id);
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
 
 	return 0;
 }
@@ -539,11 +741,24 @@ static int s3cfb_release_window(struct fb_info *fb)
 		platform_get_drvdata(to_platform_device(fb->device));
 	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
 	struct s3cfb_window *win = fb->par;
+	unsigned long flags;
+
+	s3cfb_flip_flush(fbdev, win);
 
 	if (win->id != pdata->default_win) {
 		s3cfb_set_window(fbdev, win->id, 0);
 		s3cfb_unmap_video_memory(fb);
+
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
 		s3cfb_set_buffer_address(fbdev, win->id);
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+		if (win->dmabuf.dmabuf) {
+			s5p_dmabuf_release(&win->dmabuf);
+			win->owner = DMA_MEM_NONE;
+			win->other_mem_addr = 0;
+			win->other_mem_size = 0;
+		}
 	}
 
 	win->x = 0;
@@ -571,12 +786,14 @@ static int s3cfb_release(struct fb_info *fb, int user)
 
 static int s3cfb_wait_for_vsync(struct s3cfb_global *ctrl)
 {
+	unsigned long count = ctrl->vsync_count;
 	int ret;
 
 	dev_dbg(ctrl->dev, "waiting for VSYNC interrupt\n");
 
-	ret = wait_for_completion_interruptible_timeout(
-		&ctrl->fb_complete, msecs_to_jiffies(100));
+	ret = wait_event_interruptible_timeout(ctrl->vsync_wait,
+		ACCESS_ONCE(ctrl->vsync_count) != count,
+		msecs_to_jiffies(100));
 	if (ret == 0)
 		return -ETIMEDOUT;
 	if (ret < 0)
@@ -587,6 +804,363 @@ static int s3cfb_wait_for_vsync(struct s3cfb_global *ctrl)
 	return ret;
 }
 
+static int s3cfb_export_dmabuf(struct fb_info *fb)
+{
+	struct s3cfb_window *win = fb->par;
+
+	if (!fb->fix.smem_start || win->owner != DMA_MEM_FIMD || !win->vmem)
+		return -EINVAL;
+
+	/* the memory is freed once the window and every export let go */
+	kref_get(&win->vmem->ref);
+	return s5p_dmabuf_export_fd(win->vmem->dma, win->vmem->size, 0,
+				    s3cfb_vmem_put, win->vmem);
+}
+
+static int s3cfb_set_win_dmabuf(struct fb_info *fb, int fd)
+{
+	struct s3cfb_global *fbdev =
+		platform_get_drvdata(to_platform_device(fb->device));
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win = fb->par;
+	struct s5p_dmabuf_import old = win->dmabuf;
+	struct s5p_dmabuf_import imp;
+	struct s3cfb_vmem *old_vmem = NULL;
+	unsigned long flags;
+	int ret;
+
+	if (win->id == pdata->default_win)
+		return -EBUSY;
+
+	ret = s5p_dmabuf_import(fd, fbdev->dev, DMA_TO_DEVICE, &imp);
+	if (ret < 0)
+		return ret;
+
+	if (imp.size < fb->fix.line_length * fb->var.yres) {
+		dev_err(fbdev->dev, "[fb%d] shared buffer is too small\n",
+				win->id);
+		s5p_dmabuf_release(&imp);
+		return -EINVAL;
+	}
+
+	/* the window scans out the shared buffer instead of its own memory */
+	if (win->owner == DMA_MEM_FIMD)
+		old_vmem = s3cfb_detach_video_memory(fb);
+
+	win->dmabuf = imp;
+	win->owner = DMA_MEM_OTHER;
+	win->other_mem_addr = imp.paddr;
+	win->other_mem_size = imp.size;
+
+	fb->fix.smem_start = imp.paddr;
+	fb->fix.smem_len = imp.size;
+	fb->var.yoffset = 0;
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+	s3cfb_set_buffer_address(fbdev, win->id);
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+	/* the previous buffer is still fetched until the next frame starts */
+	if (old.dmabuf || old_vmem) {
+		if (win->enabled)
+			s3cfb_wait_for_vsync(fbdev);
+		s5p_dmabuf_release(&old);
+		if (old_vmem)
+			s3cfb_vmem_put(old_vmem);
+	}
+
+	return 0;
+}
+
+static int s3cfb_queue_flip(struct fb_info *fb, struct s3cfb_user_flip *req)
+{
+	struct s3cfb_global *fbdev =
+		platform_get_drvdata(to_platform_device(fb->device));
+	struct s3cfb_window *win = fb->par;
+	struct s3cfb_flip flip;
+	unsigned long flags;
+	int ret = 0;
+
+	if (req->yoffset + fb->var.yres > fb->var.yres_virtual) {
+		dev_err(fbdev->dev, "invalid yoffset value\n");
+		return -EINVAL;
+	}
+
+	flip.id = req->id;
+	flip.yoffset = req->yoffset;
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+
+	/*
+	 * Flips are completed from the vsync interrupt.  It is turned back on
+	 * even when the queue is full, or the flips in it would never drain.
+	 */
+	if (!s3cfb_get_vsync_interrupt(fbdev)) {
+		s3cfb_set_global_interrupt(fbdev, 1);
+		s3cfb_set_vsync_interrupt(fbdev, 1);
+	}
+
+	if (win->flip_latched_valid + win->flip_count >= S3CFB_FLIP_BUFS - 1) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	flip.frame = fbdev->vsync_count;
+	flip.queued = ktime_get();
+
+	/*
+	 * Nothing is waiting for the shadow registers to be latched, so the
+	 * buffer can be shown at the next vsync already.
+	 */
+	if (!win->flip_latched_valid) {
+		s3cfb_flip_latch(fbdev, win, &flip);
+	} else {
+		win->flip[(win->flip_head + win->flip_count) %
+			  ARRAY_SIZE(win->flip)] = flip;
+		win->flip_count++;
+	}
+
+out:
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+	return ret;
+}
+
+static void s3cfb_get_flip_status(struct fb_info *fb,
+				  struct s3cfb_flip_status *status)
+{
+	struct s3cfb_global *fbdev =
+		platform_get_drvdata(to_platform_device(fb->device));
+	struct s3cfb_window *win = fb->par;
+	unsigned long flags;
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+	*status = win->flip_status;
+	status->pending = win->flip_latched_valid + win->flip_count;
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+}
+
+/*
+ * struct s3cfb_plane_state
+ * @fb:			fb_info of the window
+ * @req:		requested update
+ * @imp:		newly imported buffer
+ * @old:		previous shared buffer, released after the next vsync
+ * @old_vmem:		previous window memory, freed after the next vsync
+*/
+struct s3cfb_plane_state {
+	struct fb_info			*fb;
+	struct s3cfb_user_plane		*req;
+	struct s5p_dmabuf_import	imp;
+	struct s5p_dmabuf_import	old;
+	struct s3cfb_vmem		*old_vmem;
+};
+
+static int s3cfb_check_plane(struct s3cfb_global *ctrl,
+			     struct s3cfb_user_plane *req)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	struct fb_info *fb = ctrl->fb[req->id];
+	struct fb_var_screeninfo *var = &fb->var;
+
+	if ((req->flags & S3CFB_PLANE_ALPHA) && req->id == 0) {
+		dev_err(ctrl->dev, "[fb%d] does not support alpha blending\n",
+			req->id);
+		return -EINVAL;
+	}
+
+	if (!(req->flags & S3CFB_PLANE_BUFFER))
+		return 0;
+
+	if (req->fd < 0) {
+		if (req->yoffset + var->yres > var->yres_virtual) {
+			dev_err(ctrl->dev, "invalid yoffset value\n");
+			return -EINVAL;
+		}
+	} else if (req->id == pdata->default_win) {
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static int s3cfb_import_plane(struct s3cfb_global *ctrl,
+			      struct s3cfb_plane_state *state)
+{
+	struct fb_info *fb = state->fb;
+	struct s3cfb_user_plane *req = state->req;
+	int ret;
+
+	ret = s5p_dmabuf_import(req->fd, ctrl->dev, DMA_TO_DEVICE, &state->imp);
+	if (ret < 0)
+		return ret;
+
+	if (state->imp.size < ALIGN(fb->fix.line_length * req->yoffset,
+				    PAGE_SIZE) +
+			      fb->fix.line_length * fb->var.yres) {
+		dev_err(ctrl->dev, "[fb%d] shared buffer is too small\n",
+				req->id);
+		s5p_dmabuf_release(&state->imp);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* called with flip_lock held and the shadow update held back */
+static void s3cfb_apply_plane(struct s3cfb_global *ctrl,
+			      struct s3cfb_plane_state *state)
+{
+	struct fb_info *fb = state->fb;
+	struct s3cfb_user_plane *req = state->req;
+	struct s3cfb_window *win = fb->par;
+	struct s3cfb_lcd *lcd = ctrl->lcd;
+
+	if (req->flags & S3CFB_PLANE_POSITION) {
+		win->x = clamp_t(int, req->x, 0, lcd->width - fb->var.xres);
+		win->y = clamp_t(int, req->y, 0, lcd->height - fb->var.yres);
+
+		s3cfb_set_window_position(ctrl, win->id);
+	}
+
+	if (req->flags & S3CFB_PLANE_ALPHA) {
+		win->alpha.mode = PLANE_BLENDING;
+		win->alpha.channel = req->alpha.channel;
+		win->alpha.value = S3CFB_AVALUE(req->alpha.red,
+					req->alpha.green, req->alpha.blue);
+
+		s3cfb_set_alpha_blending(ctrl, win->id);
+	}
+
+	if (req->flags & S3CFB_PLANE_BUFFER) {
+		if (state->imp.dmabuf) {
+			state->old = win->dmabuf;
+
+			win->dmabuf = state->imp;
+			win->owner = DMA_MEM_OTHER;
+			win->other_mem_addr = state->imp.paddr;
+			win->other_mem_size = state->imp.size;
+
+			fb->fix.smem_start = state->imp.paddr;
+			fb->fix.smem_len = state->imp.size;
+		}
+
+		fb->var.yoffset = req->yoffset;
+		s3cfb_set_buffer_address(ctrl, win->id);
+	}
+
+	if (req->flags & S3CFB_PLANE_ENABLE)
+		__s3cfb_set_window(ctrl, win->id, req->enabled);
+}
+
+/*
+ * Updates several windows so that all of the changes reach the screen at
+ * the same vsync, by holding back the shadow register update meanwhile.
+ */
+static int s3cfb_win_commit(struct s3cfb_global *ctrl,
+			    struct s3cfb_user_commit *commit)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	struct s3cfb_plane_state state[S3CFB_MAX_PLANES];
+	struct s3cfb_user_plane *req;
+	struct s3cfb_window *win;
+	unsigned long flags;
+	u32 wins = 0;
+	int i, ret = 0, release = 0;
+
+	if (commit->count <= 0 || commit->count > S3CFB_MAX_PLANES)
+		return -EINVAL;
+
+	memset(state, 0, sizeof(state));
+
+	for (i = 0; i < commit->count; i++) {
+		req = &commit->planes[i];
+
+		if (req->id < 0 || req->id >= pdata->nr_wins ||
+		    (wins & (1 << req->id)))
+			return -EINVAL;
+
+		ret = s3cfb_check_plane(ctrl, req);
+		if (ret < 0)
+			return ret;
+
+		wins |= 1 << req->id;
+		state[i].fb = ctrl->fb[req->id];
+		state[i].req = req;
+	}
+
+	mutex_lock(&ctrl->lock);
+
+	for (i = 0; i < commit->count; i++) {
+		req = state[i].req;
+		if (!(req->flags & S3CFB_PLANE_BUFFER) || req->fd < 0)
+			continue;
+
+		ret = s3cfb_import_plane(ctrl, &state[i]);
+		if (ret < 0)
+			goto err_import;
+	}
+
+	for (i = 0; i < commit->count; i++) {
+		req = state[i].req;
+		win = state[i].fb->par;
+
+		/* a window needs memory to be scanned out from */
+		if ((req->flags & S3CFB_PLANE_ENABLE) && req->enabled &&
+		    !state[i].imp.dmabuf && !state[i].fb->fix.smem_start) {
+			ret = -EINVAL;
+			goto err_import;
+		}
+	}
+
+	for (i = 0; i < commit->count; i++) {
+		win = state[i].fb->par;
+
+		/* the committed state overrides whatever is still queued */
+		s3cfb_flip_flush(ctrl, win);
+
+		if (state[i].imp.dmabuf && win->owner == DMA_MEM_FIMD)
+			state[i].old_vmem =
+				s3cfb_detach_video_memory(state[i].fb);
+	}
+
+	spin_lock_irqsave(&ctrl->flip_lock, flags);
+	s3cfb_set_shadow_protect(ctrl, wins, 1);
+
+	for (i = 0; i < commit->count; i++)
+		s3cfb_apply_plane(ctrl, &state[i]);
+
+	s3cfb_set_shadow_protect(ctrl, wins, 0);
+	spin_unlock_irqrestore(&ctrl->flip_lock, flags);
+
+	for (i = 0; i < commit->count; i++)
+		if (state[i].old.dmabuf || state[i].old_vmem)
+			release = 1;
+
+	/* the previous buffers are still fetched until the next frame starts */
+	if (release) {
+		s3cfb_wait_for_vsync(ctrl);
+
+		for (i = 0; i < commit->count; i++) {
+			s5p_dmabuf_release(&state[i].old);
+			if (state[i].old_vmem)
+				s3cfb_vmem_put(state[i].old_vmem);
+		}
+	}
+
+	mutex_unlock(&ctrl->lock);
+
+	return 0;
+
+err_import:
+	for (i = 0; i < commit->count; i++)
+		s5p_dmabuf_release(&state[i].imp);
+
+	mutex_unlock(&ctrl->lock);
+
+	return ret;
+}
+
 static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 {
 	struct s3cfb_global *fbdev =
@@ -599,6 +1173,7 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 
 	volatile unsigned int * LCDControllerBase = NULL;
 	int framebuffer_addr = 0;
+	unsigned long flags;
 
 	int ret = 0;
 
@@ -606,7 +1181,11 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 		struct s3cfb_user_window user_window;
 		struct s3cfb_user_plane_alpha user_alpha;
 		struct s3cfb_user_chroma user_chroma;
+		struct s3cfb_user_flip user_flip;
+		struct s3cfb_flip_status flip_status;
+		struct s3cfb_user_commit user_commit;
 		int vsync;
+		int fd;
 	} p;
 
 	switch (cmd) {
@@ -636,7 +1215,9 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 			else
 				win->y = p.user_window.y;
 
+			spin_lock_irqsave(&fbdev->flip_lock, flags);
 			s3cfb_set_window_position(fbdev, win->id);
+			spin_unlock_irqrestore(&fbdev->flip_lock, flags);
 		}
 		break;
 
@@ -674,11 +1255,16 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 	case S3CFB_SET_VSYNC_INT:
 		if (get_user(p.vsync, (int __user *)arg))
 			ret = -EFAULT;
-		else {
-			if (p.vsync)
-				s3cfb_set_global_interrupt(fbdev, 1);
+		else if (p.vsync) {
+			s3cfb_set_global_interrupt(fbdev, 1);
+			s3cfb_set_vsync_interrupt(fbdev, 1);
+		} else {
+			spin_lock_irqsave(&fbdev->flip_lock, flags);
+			s3cfb_set_vsync_interrupt(fbdev, 0);
+			spin_unlock_irqrestore(&fbdev->flip_lock, flags);
 
-			s3cfb_set_vsync_interrupt(fbdev, p.vsync);
+			/* flips queued before this would wait forever */
+			s3cfb_flip_flush_all(fbdev);
 		}
 		break;
 
@@ -711,6 +1297,50 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd, unsigned long arg)
 			return -EFAULT;
 
 		break;
+
+	case S3CFB_EXPORT_DMABUF:
+		ret = s3cfb_export_dmabuf(fb);
+		if (ret < 0)
+			break;
+
+		if (put_user(ret, (int __user *)arg))
+			return -EFAULT;
+
+		ret = 0;
+		break;
+
+	case S3CFB_SET_WIN_DMABUF:
+		if (get_user(p.fd, (int __user *)arg))
+			ret = -EFAULT;
+		else
+			ret = s3cfb_set_win_dmabuf(fb, p.fd);
+		break;
+
+	case S3CFB_QUEUE_FLIP:
+		if (copy_from_user(&p.user_flip,
+				   (struct s3cfb_user_flip __user *)arg,
+				   sizeof(p.user_flip)))
+			ret = -EFAULT;
+		else
+			ret = s3cfb_queue_flip(fb, &p.user_flip);
+		break;
+
+	case S3CFB_GET_FLIP_STATUS:
+		s3cfb_get_flip_status(fb, &p.flip_status);
+
+		if (copy_to_user((struct s3cfb_flip_status __user *)arg,
+				 &p.flip_status, sizeof(p.flip_status)))
+			ret = -EFAULT;
+		break;
+
+	case S3CFB_WIN_COMMIT:
+		if (copy_from_user(&p.user_commit,
+				   (struct s3cfb_user_commit __user *)arg,
+				   sizeof(p.user_commit)))
+			ret = -EFAULT;
+		else
+			ret = s3cfb_win_commit(fbdev, &p.user_commit);
+		break;
 	}
 
 	return ret;
@@ -952,6 +1582,71 @@ static int s3cfb_sysfs_store_win_power(struct device *dev,
 static DEVICE_ATTR(win_power, S_IRUGO | S_IWUSR,
 		s3cfb_sysfs_show_win_power, s3cfb_sysfs_store_win_power);
 
+static ssize_t s3cfb_sysfs_show_flip_stats(struct device *dev,
+					   struct device_attribute *attr,
+					   char *buf)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(dev);
+	struct platform_device *pdev = to_platform_device(dev);
+	struct s3cfb_global *fbdev = platform_get_drvdata(pdev);
+	struct s3cfb_flip_stats stats;
+	struct s3cfb_window *win;
+	unsigned long flags, vsyncs, avg_us, max_us;
+	int i, len;
+
+	spin_lock_irqsave(&fbdev->flip_lock, flags);
+	vsyncs = fbdev->vsync_count;
+	spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+	len = sprintf(buf, "vsync: %lu\n", vsyncs);
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
+		stats = win->flip_stats;
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+
+		avg_us = 0;
+		if (stats.flips)
+			avg_us = div_u64(div64_u64(stats.latency_ns,
+					stats.flips), NSEC_PER_USEC);
+		max_us = div_u64(stats.max_latency_ns, NSEC_PER_USEC);
+
+		len += sprintf(buf + len, "[fb%d] flips: %lu missed: %lu "
+				"latency avg: %luus max: %luus\n", i,
+				stats.flips, stats.missed, avg_us, max_us);
+	}
+
+	return len;
+}
+
+static ssize_t s3cfb_sysfs_store_flip_stats(struct device *dev,
+					    struct device_attribute *attr,
+					    const char *buf, size_t len)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(dev);
+	struct platform_device *pdev = to_platform_device(dev);
+	struct s3cfb_global *fbdev = platform_get_drvdata(pdev);
+	struct s3cfb_window *win;
+	unsigned long flags;
+	int i;
+
+	/* any write clears the counters */
+	for (i = 0; i < pdata->nr_wins; i++) {
+		win = fbdev->fb[i]->par;
+
+		spin_lock_irqsave(&fbdev->flip_lock, flags);
+		memset(&win->flip_stats, 0, sizeof(win->flip_stats));
+		spin_unlock_irqrestore(&fbdev->flip_lock, flags);
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR(flip_stats, S_IRUGO | S_IWUSR,
+		s3cfb_sysfs_show_flip_stats, s3cfb_sysfs_store_flip_stats);
+
 static int __devinit s3cfb_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fb *pdata;
@@ -967,6 +1662,8 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 		goto err_global;
 	}
 	fbdev->dev = &pdev->dev;
+	spin_lock_init(&fbdev->flip_lock);
+	init_waitqueue_head(&fbdev->vsync_wait);
 
 	fbdev->regulator = regulator_get(&pdev->dev, "pd");
 	if (IS_ERR(fbdev->regulator)) {
@@ -1092,6 +1789,10 @@ static int __devinit s3cfb_probe(struct platform_device *pdev)
 	if (ret < 0)
 		dev_err(fbdev->dev, "failed to add sysfs entries\n");
 
+	ret = device_create_file(&(pdev->dev), &dev_attr_flip_stats);
+	if (ret < 0)
+		dev_err(fbdev->dev, "failed to add sysfs entries\n");
+
 	dev_info(fbdev->dev, "registered successfully\n");
 
 #if defined(CONFIG_LOGO)
@@ -1160,6 +1861,7 @@ static int __devexit s3cfb_remove(struct platform_device *pdev)
 	struct fb_info *fb;
 	int i;
 
+	device_remove_file(&(pdev->dev), &dev_attr_flip_stats);
 	device_remove_file(&(pdev->dev), &dev_attr_win_power);
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -1206,6 +1908,9 @@ void s3cfb_early_suspend(struct early_suspend *h)
 
 	pr_debug("s3cfb_early_suspend is called\n");
 
+	/* no vsync will come to complete the queued flips */
+	s3cfb_flip_flush_all(fbdev);
+
 	s3cfb_display_off(fbdev);
 	clk_disable(fbdev->clock);
 #if defined(CONFIG_FB_S3C_TL2796)
@@ -16,12 +16,15 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/fb.h>
 #ifdef CONFIG_HAS_WAKELOCK
 #include <linux/wakelock.h>
 #include <linux/earlysuspend.h>
 #endif
 #include <plat/fb.h>
+#include <plat/dmabuf.h>
 #endif
 
 /*
@@ -37,6 +40,18 @@
 				((g & 0xff) << 8) | \
 				((b & 0xff) << 0))
 
+/* buffers rotated through S3CFB_QUEUE_FLIP, one of them is always on screen */
+#define S3CFB_FLIP_BUFS		3
+
+/* windows updated by one S3CFB_WIN_COMMIT */
+#define S3CFB_MAX_PLANES	5
+
+/* s3cfb_user_plane flags */
+#define S3CFB_PLANE_POSITION	(1 << 0)
+#define S3CFB_PLANE_BUFFER	(1 << 1)
+#define S3CFB_PLANE_ALPHA	(1 << 2)
+#define S3CFB_PLANE_ENABLE	(1 << 3)
+
 /*
  * E N U M E R A T I O N S
  *
@@ -179,6 +194,50 @@ struct s3cfb_lcd {
 	unsigned long args;
 };
 
+#ifdef __KERNEL__
+/*
+ * struct s3cfb_flip
+ * @id:			cookie given by the user, reported once on screen
+ * @yoffset:		virtual y offset of the buffer to be scanned out
+ * @frame:		vsync count at the time the flip was queued
+ * @queued:		time the flip was queued
+*/
+struct s3cfb_flip {
+	unsigned int	id;
+	unsigned int	yoffset;
+	unsigned long	frame;
+	ktime_t		queued;
+};
+
+/*
+ * struct s3cfb_flip_stats
+ * @flips:		flips which reached the screen
+ * @missed:		flips not on screen at the first vsync after queueing
+ * @latency_ns:		sum of the queue to present latencies
+ * @max_latency_ns:	worst queue to present latency
+*/
+struct s3cfb_flip_stats {
+	unsigned long	flips;
+	unsigned long	missed;
+	u64		latency_ns;
+	u64		max_latency_ns;
+};
+#endif
+
+/*
+ * struct s3cfb_flip_status
+ * @id:			cookie of the flip currently on screen
+ * @pending:		flips queued but not on screen yet
+ * @frame:		vsync count at which it was presented
+ * @timestamp:		CLOCK_MONOTONIC time it was presented, in ns
+*/
+struct s3cfb_flip_status {
+	unsigned int		id;
+	unsigned int		pending;
+	unsigned int		frame;
+	unsigned long long	timestamp;
+};
+
 /*
  * struct s3cfb_window
  * @id:			window id
@@ -192,6 +251,14 @@ struct s3cfb_lcd {
  * @pseudo_pal:		pseudo palette for fb layer
  * @alpha:		alpha blending structure
  * @chroma:		chroma key structure
+ * @dmabuf:		shared buffer currently scanned out, if imported
+ * @flip:		ring of flips waiting for a vsync
+ * @flip_head:		oldest entry of @flip
+ * @flip_count:		number of entries in @flip
+ * @flip_latched:	flip written to the shadow registers
+ * @flip_latched_valid:	if @flip_latched becomes visible at the next vsync
+ * @flip_status:	last presented flip
+ * @flip_stats:		flip counters exported through sysfs
 */
 struct s3cfb_window {
 	int			id;
@@ -208,12 +275,26 @@ struct s3cfb_window {
 	unsigned int		pseudo_pal[16];
 	struct			s3cfb_alpha alpha;
 	struct			s3cfb_chroma chroma;
+#ifdef __KERNEL__
+	struct			s3cfb_vmem *vmem;
+	struct			s5p_dmabuf_import dmabuf;
+	struct			s3cfb_flip flip[S3CFB_FLIP_BUFS - 1];
+	int			flip_head;
+	int			flip_count;
+	struct			s3cfb_flip flip_latched;
+	int			flip_latched_valid;
+	struct			s3cfb_flip_status flip_status;
+	struct			s3cfb_flip_stats flip_stats;
+#endif
 };
 
 /*
  * struct s3cfb_global
  *
  * @fb:			pointer to fb_info
+ * @flip_lock:		protects the flip state of all windows
+ * @vsync_wait:		woken up at every vsync interrupt
+ * @vsync_count:	number of vsync interrupts taken
  * @enabled:		if signal output enabled
  * @dsi:		if mipi-dsim enabled
  * @interlace:		if interlace format is used
@@ -232,7 +313,9 @@ struct s3cfb_global {
 	struct regulator	*vlcd;
 	int			irq;
 	struct fb_info		**fb;
-	struct completion	fb_complete;
+	spinlock_t		flip_lock;
+	wait_queue_head_t	vsync_wait;
+	unsigned long		vsync_count;
 
 	/* fimd */
 	int			enabled;
@@ -291,6 +374,39 @@ struct s3cfb_next_info {
 	unsigned int lcd_offset_y;
 };
 
+struct s3cfb_user_flip {
+	unsigned int	id;
+	unsigned int	yoffset;
+};
+
+/*
+ * struct s3cfb_user_plane
+ * @id:			window to update
+ * @flags:		S3CFB_PLANE_* fields to apply
+ * @enabled:		window on/off, for S3CFB_PLANE_ENABLE
+ * @x:			left x of start offset, for S3CFB_PLANE_POSITION
+ * @y:			top y of start offset, for S3CFB_PLANE_POSITION
+ * @fd:			dma-buf to scan out or -1 to keep the current memory,
+ *			for S3CFB_PLANE_BUFFER
+ * @yoffset:		virtual y offset in the buffer, for S3CFB_PLANE_BUFFER
+ * @alpha:		plane alpha, for S3CFB_PLANE_ALPHA
+*/
+struct s3cfb_user_plane {
+	int				id;
+	unsigned int			flags;
+	int				enabled;
+	int				x;
+	int				y;
+	int				fd;
+	unsigned int			yoffset;
+	struct s3cfb_user_plane_alpha	alpha;
+};
+
+struct s3cfb_user_commit {
+	int				count;
+	struct s3cfb_user_plane		planes[S3CFB_MAX_PLANES];
+};
+
 /*
  * C U S T O M  I O C T L S
  *
@@ -315,6 +431,13 @@ struct s3cfb_next_info {
 #define S3CFB_SET_WIN_MEM		_IOW('F', 310, \
 						enum s3cfb_mem_owner_t)
 #define S3CFB_GET_LCD_ADDR		_IOR('F', 311, int)
+#define S3CFB_EXPORT_DMABUF		_IOR('F', 312, int)
+#define S3CFB_SET_WIN_DMABUF		_IOW('F', 313, int)
+#define S3CFB_QUEUE_FLIP		_IOW('F', 314, struct s3cfb_user_flip)
+#define S3CFB_GET_FLIP_STATUS		_IOR('F', 315, \
+						struct s3cfb_flip_status)
+#define S3CFB_WIN_COMMIT		_IOW('F', 316, \
+						struct s3cfb_user_commit)
 
 /*
  * E X T E R N S
@@ -348,6 +471,8 @@ extern int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_alpha_blending(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_size(struct s3cfb_global *ctrl, int id);
+extern int s3cfb_set_shadow_protect(struct s3cfb_global *ctrl, u32 wins,
+				    int enable);
 extern int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_buffer_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_chroma_key(struct s3cfb_global *ctrl, int id);
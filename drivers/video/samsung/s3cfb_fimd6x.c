@@ -571,13 +571,65 @@ int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id)
 	return 0;
 }
 
+/*
+ * Holds back the shadow register update of window @id. Returns 0 if the
+ * caller already did so for a bigger update, which then releases it.
+ * S3C_WINSHMAP is also written from the vsync interrupt, so this,
+ * s3cfb_unprotect_window() and s3cfb_set_shadow_protect() are called with
+ * ctrl->flip_lock held.
+ */
+static int s3cfb_protect_window(struct s3cfb_global *ctrl, int id)
+{
+	u32 shw;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	if (shw & S3C_WINSHMAP_PROTECT(1 << id))
+		return 0;
+
+	writel(shw | S3C_WINSHMAP_PROTECT(1 << id), ctrl->regs + S3C_WINSHMAP);
+
+	return 1;
+}
+
+static void s3cfb_unprotect_window(struct s3cfb_global *ctrl, int id)
+{
+	u32 shw;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+	shw &= ~S3C_WINSHMAP_PROTECT(1 << id);
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+}
+
+int s3cfb_set_shadow_protect(struct s3cfb_global *ctrl, u32 wins, int enable)
+{
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	u32 shw;
+
+	if (pdata->hw_ver != 0x62)
+		return 0;
+
+	shw = readl(ctrl->regs + S3C_WINSHMAP);
+
+	if (enable)
+		shw |= S3C_WINSHMAP_PROTECT(wins);
+	else
+		shw &= ~S3C_WINSHMAP_PROTECT(wins);
+
+	writel(shw, ctrl->regs + S3C_WINSHMAP);
+
+	dev_dbg(ctrl->dev, "shadow update of 0x%02x %s\n", wins,
+		enable ? "held" : "released");
+
+	return 0;
+}
+
 int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
 {
 	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
 	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
 	dma_addr_t start_addr = 0, end_addr = 0;
-	u32 shw;
+	int protect = 0;
 
 	if (fix->smem_start) {
 		start_addr = fix->smem_start + ALIGN(var->xres_virtual *
@@ -586,20 +638,14 @@ int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
 		end_addr = start_addr + fix->line_length * var->yres;
 	}
 
-	if (pdata->hw_ver == 0x62) {
-		shw = readl(ctrl->regs + S3C_WINSHMAP);
-		shw |= S3C_WINSHMAP_PROTECT(id);
-		writel(shw, ctrl->regs + S3C_WINSHMAP);
-	}
+	if (pdata->hw_ver == 0x62)
+		protect = s3cfb_protect_window(ctrl, id);
 
 	writel(start_addr, ctrl->regs + S3C_VIDADDR_START0(id));
 	writel(end_addr, ctrl->regs + S3C_VIDADDR_END0(id));
 
-	if (pdata->hw_ver == 0x62) {
-		shw = readl(ctrl->regs + S3C_WINSHMAP);
-		shw &= ~(S3C_WINSHMAP_PROTECT(id));
-		writel(shw, ctrl->regs + S3C_WINSHMAP);
-	}
+	if (protect)
+		s3cfb_unprotect_window(ctrl, id);
 
 	dev_dbg(ctrl->dev, "[fb%d] start_addr: 0x%08x, end_addr: 0x%08x\n",
 		id, start_addr, end_addr);
@@ -652,11 +698,10 @@ int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id)
 {
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
 	struct s3cfb_window *win = ctrl->fb[id]->par;
-	u32 cfg, shw;
+	int protect;
+	u32 cfg;
 
-	shw = readl(ctrl->regs + S3C_WINSHMAP);
-	shw |= S3C_WINSHMAP_PROTECT(id);
-	writel(shw, ctrl->regs + S3C_WINSHMAP);
+	protect = s3cfb_protect_window(ctrl, id);
 
 	cfg = S3C_VIDOSD_LEFT_X(win->x) | S3C_VIDOSD_TOP_Y(win->y);
 	writel(cfg, ctrl->regs + S3C_VIDOSD_A(id));
@@ -666,9 +711,8 @@ int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id)
 
 	writel(cfg, ctrl->regs + S3C_VIDOSD_B(id));
 
-	shw = readl(ctrl->regs + S3C_WINSHMAP);
-	shw &= ~(S3C_WINSHMAP_PROTECT(id));
-	writel(shw, ctrl->regs + S3C_WINSHMAP);
+	if (protect)
+		s3cfb_unprotect_window(ctrl, id);
 
 	dev_dbg(ctrl->dev, "[fb%d] offset: (%d, %d, %d, %d)\n", id,
 		win->x, win->y, win->x + var->xres - 1, win->y + var->yres - 1);
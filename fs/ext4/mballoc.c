@@ -1516,6 +1516,22 @@ static int mb_mark_used(struct ext4_buddy *e4b, struct ext4_free_extent *ex)
 	return ret;
 }
 
+/*
+ * Small files are allocated from the per-CPU locality group.  The group
+ * its last request of the same order was satisfied from is where the
+ * next one is most likely to fit, so the scan starts there rather than
+ * at the goal, which for unrelated small files is anywhere.  The order
+ * is that of the original request: the goal length has been normalized
+ * to the group preallocation size by now.
+ */
+static inline ext4_group_t *
+ext4_mb_lg_group_hint(struct ext4_allocation_context *ac)
+{
+	int order = fls(ac->ac_o_ex.fe_len) - 1;
+
+	return &ac->ac_lg->lg_group_hint[min(order, LG_GROUP_HINTS - 1)];
+}
+
 /*
  * Must be called under group lock!
  */
@@ -1558,6 +1574,9 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
 		spin_unlock(&sbi->s_md_lock);
 	}
+	/* and per CPU for small files, lg_mutex is held */
+	if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC)
+		*ext4_mb_lg_group_hint(ac) = ac->ac_f_ex.fe_group + 1;
 }
 
 /*
@@ -1957,7 +1976,7 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
-	ext4_group_t ngroups, group, i;
+	ext4_group_t ngroups, group, start, hint = 0, i;
 	int cr;
 	int err = 0;
 	struct ext4_sb_info *sbi;
@@ -2010,6 +2029,15 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 		spin_unlock(&sbi->s_md_lock);
 	}
 
+	start = ac->ac_g_ex.fe_group;
+	if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC) {
+		hint = *ext4_mb_lg_group_hint(ac);
+		if (hint && hint <= ngroups)
+			start = hint - 1;
+		else
+			hint = 0;
+	}
+
 	/* Let's just scan groups to find more-less suitable blocks */
 	cr = ac->ac_2order ? 0 : 1;
 	/*
@@ -2023,7 +2051,7 @@ repeat:
 		 * searching for the right group start
 		 * from the goal value specified
 		 */
-		group = ac->ac_g_ex.fe_group;
+		group = start;
 
 		for (i = 0; i < ngroups; group++, i++) {
 			if (group == ngroups)
@@ -2091,6 +2119,10 @@ repeat:
 			goto repeat;
 		}
 	}
+
+	if (sbi->s_mb_stats && hint && ac->ac_status == AC_STATUS_FOUND &&
+	    ac->ac_f_ex.fe_group == start)
+		atomic_inc(&sbi->s_bal_lg_hits);
 out:
 	return err;
 }
@@ -2194,6 +2226,53 @@ static const struct file_operations ext4_mb_seq_groups_fops = {
 	.release	= seq_release,
 };
 
+static int ext4_mb_seq_stats_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+
+	if (!sbi->s_mb_stats) {
+		seq_printf(seq, "statistics disabled, "
+			   "write 1 to /sys/fs/ext4/%s/mb_stats\n", sb->s_id);
+		return 0;
+	}
+
+	seq_printf(seq, "reqs: %u\n", atomic_read(&sbi->s_bal_reqs));
+	seq_printf(seq, "success: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "blocks: %u\n", atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "groups_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_groups_scanned));
+	seq_printf(seq, "extents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "goal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "lg_hint_hits: %u\n",
+		   atomic_read(&sbi->s_bal_lg_hits));
+	seq_printf(seq, "2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "breaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "lost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "buddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	seq_printf(seq, "buddies_time: %llu\n", sbi->s_mb_generation_time);
+	seq_printf(seq, "preallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "discarded: %u\n", atomic_read(&sbi->s_mb_discarded));
+
+	return 0;
+}
+
+static int ext4_mb_seq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_mb_seq_stats_show, PDE(inode)->data);
+}
+
+static const struct file_operations ext4_mb_seq_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ext4_mb_seq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2487,9 +2566,12 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		spin_lock_init(&lg->lg_prealloc_lock);
 	}
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
+		proc_create_data("mb_stats", S_IRUGO, sbi->s_proc,
+				 &ext4_mb_seq_stats_fops, sb);
+	}
 
 	if (sbi->s_journal)
 		sbi->s_journal->j_commit_callback = release_blocks_on_commit;
@@ -2557,10 +2639,13 @@ int ext4_mb_release(struct super_block *sb)
 				atomic_read(&sbi->s_bal_reqs),
 				atomic_read(&sbi->s_bal_success));
 		printk(KERN_INFO
-		      "EXT4-fs: mballoc: %u extents scanned, %u goal hits, "
+		      "EXT4-fs: mballoc: %u groups, %u extents scanned, "
+				"%u goal hits, %u hint hits, "
 				"%u 2^N hits, %u breaks, %u lost\n",
+				atomic_read(&sbi->s_bal_groups_scanned),
 				atomic_read(&sbi->s_bal_ex_scanned),
 				atomic_read(&sbi->s_bal_goals),
+				atomic_read(&sbi->s_bal_lg_hits),
 				atomic_read(&sbi->s_bal_2orders),
 				atomic_read(&sbi->s_bal_breaks),
 				atomic_read(&sbi->s_mb_lost_chunks));
@@ -2575,8 +2660,10 @@ int ext4_mb_release(struct super_block *sb)
 	}
 
 	free_percpu(sbi->s_locality_groups);
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
+		remove_proc_entry("mb_stats", sbi->s_proc);
 		remove_proc_entry("mb_groups", sbi->s_proc);
+	}
 
 	return 0;
 }
@@ -3046,6 +3133,7 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 		if (ac->ac_b_ex.fe_len >= ac->ac_o_ex.fe_len)
 			atomic_inc(&sbi->s_bal_success);
 		atomic_add(ac->ac_found, &sbi->s_bal_ex_scanned);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
 		if (ac->ac_g_ex.fe_start == ac->ac_b_ex.fe_start &&
 				ac->ac_g_ex.fe_group == ac->ac_b_ex.fe_group)
 			atomic_inc(&sbi->s_bal_goals);
@@ -153,6 +153,9 @@ struct ext4_free_extent {
  *   order value.ie, fls(pa_free)-1;
  */
 #define PREALLOC_TB_SIZE 10
+/* orders of request size with their own group hint, larger share the last */
+#define LG_GROUP_HINTS		16
+
 struct ext4_locality_group {
 	/* for allocator */
 	/* to serialize allocates */
@@ -160,6 +163,8 @@ struct ext4_locality_group {
 	/* list of preallocations */
 	struct list_head	lg_prealloc_list[PREALLOC_TB_SIZE];
 	spinlock_t		lg_prealloc_lock;
+	/* group + 1 the last request of each order was satisfied from */
+	ext4_group_t		lg_group_hint[LG_GROUP_HINTS];
 };
 
 struct ext4_allocation_context {
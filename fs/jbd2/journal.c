@@ -82,6 +82,7 @@ EXPORT_SYMBOL(jbd2_journal_errno);
 EXPORT_SYMBOL(jbd2_journal_ack_err);
 EXPORT_SYMBOL(jbd2_journal_clear_err);
 EXPORT_SYMBOL(jbd2_log_wait_commit);
+EXPORT_SYMBOL(jbd2_log_sync_commit);
 EXPORT_SYMBOL(jbd2_log_start_commit);
 EXPORT_SYMBOL(jbd2_journal_start_commit);
 EXPORT_SYMBOL(jbd2_journal_force_commit_nested);
@@ -662,6 +663,50 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Commit transaction 'tid' and wait for it, on behalf of fsync().
+ *
+ * fsync() has no handle to mark synchronous, so it gets the batching of
+ * jbd2_journal_stop() here: unless the caller was also the last task to
+ * sync, or no handle is attached to the still running transaction, it
+ * first gives the writers holding handles the time of an average commit
+ * to add their changes, and one commit then covers all of them.  With no
+ * handle attached there is nobody to wait for.
+ */
+int jbd2_log_sync_commit(journal_t *journal, tid_t tid)
+{
+	transaction_t *transaction;
+	ktime_t start = ktime_get();
+	ktime_t t_start = start;
+	pid_t pid = current->pid;
+	u64 batch = 0;
+	int running = 0;
+	int err;
+
+	if (journal->j_last_sync_writer != pid) {
+		journal->j_last_sync_writer = pid;
+
+		read_lock(&journal->j_state_lock);
+		transaction = journal->j_running_transaction;
+		if (transaction && transaction->t_tid == tid &&
+		    atomic_read(&transaction->t_updates)) {
+			t_start = transaction->t_start_time;
+			running = 1;
+		}
+		read_unlock(&journal->j_state_lock);
+
+		if (running)
+			batch = __jbd2_batch_wait(journal, t_start);
+	}
+
+	jbd2_log_start_commit(journal, tid);
+	err = jbd2_log_wait_commit(journal, tid);
+
+	trace_jbd2_sync_commit(journal, tid, batch,
+			       ktime_to_ns(ktime_sub(ktime_get(), start)));
+	return err;
+}
+
 /*
  * Log buffer allocation routines:
  */
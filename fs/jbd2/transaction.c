@@ -1269,6 +1269,39 @@ drop:
 	return err;
 }
 
+/*
+ * Synchronous transaction batching, see jbd2_journal_stop(): if the
+ * transaction started less than an average commit ago, sleep for that
+ * long so that other synchronous writers can join it.  Returns the time
+ * slept, in nanoseconds.
+ */
+u64 __jbd2_batch_wait(journal_t *journal, ktime_t start_time)
+{
+	u64 commit_time, trans_time;
+	ktime_t now = ktime_get();
+	ktime_t expires;
+
+	read_lock(&journal->j_state_lock);
+	commit_time = journal->j_average_commit_time;
+	read_unlock(&journal->j_state_lock);
+
+	trans_time = ktime_to_ns(ktime_sub(now, start_time));
+
+	commit_time = max_t(u64, commit_time,
+			    1000*journal->j_min_batch_time);
+	commit_time = min_t(u64, commit_time,
+			    1000*journal->j_max_batch_time);
+
+	if (trans_time >= commit_time)
+		return 0;
+
+	expires = ktime_add_ns(now, commit_time);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+
+	return ktime_to_ns(ktime_sub(ktime_get(), now));
+}
+
 /**
  * int jbd2_journal_stop() - complete a transaction
  * @handle: tranaction to complete.
@@ -1339,28 +1372,8 @@ int jbd2_journal_stop(handle_t *handle)
 	 */
 	pid = current->pid;
 	if (handle->h_sync && journal->j_last_sync_writer != pid) {
-		u64 commit_time, trans_time;
-
 		journal->j_last_sync_writer = pid;
-
-		read_lock(&journal->j_state_lock);
-		commit_time = journal->j_average_commit_time;
-		read_unlock(&journal->j_state_lock);
-
-		trans_time = ktime_to_ns(ktime_sub(ktime_get(),
-						   transaction->t_start_time));
-
-		commit_time = max_t(u64, commit_time,
-				    1000*journal->j_min_batch_time);
-		commit_time = min_t(u64, commit_time,
-				    1000*journal->j_max_batch_time);
-
-		if (trans_time < commit_time) {
-			ktime_t expires = ktime_add_ns(ktime_get(),
-						       commit_time);
-			set_current_state(TASK_UNINTERRUPTIBLE);
-			schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
-		}
+		__jbd2_batch_wait(journal, transaction->t_start_time);
 	}
 
 	if (handle->h_sync)
@@ -1198,6 +1198,31 @@ static int nilfs_segctor_collect_blocks(struct nilfs_sc_info *sci, int mode)
 	return err;
 }
 
+/*
+ * With the coldseg option, blocks moved by GC have survived at least one
+ * cleaning and are likely to stay, while newly written blocks are likely
+ * to be overwritten soon.  Keeping the two in separate segments leaves
+ * segments that either die quickly or stay full, both cheap to clean.
+ * A log of the other kind than the current segment holds starts a new
+ * full segment; the rest of the current one is left unused, as when it
+ * is too short for a log.  Returns 1 if the segment must be switched.
+ */
+static int nilfs_segctor_switch_temperature(struct nilfs_sc_info *sci,
+					    struct the_nilfs *nilfs)
+{
+	int cold = !list_empty(&sci->sc_gc_inodes);
+
+	if (cold == !!test_bit(NILFS_SC_COLD_SEGMENT, &sci->sc_flags))
+		return 0;
+
+	if (cold)
+		set_bit(NILFS_SC_COLD_SEGMENT, &sci->sc_flags);
+	else
+		clear_bit(NILFS_SC_COLD_SEGMENT, &sci->sc_flags);
+
+	return nilfs->ns_pseg_offset != 0;
+}
+
 /**
  * nilfs_segctor_begin_construction - setup segment buffer to make a new log
  * @sci: nilfs_sc_info
@@ -1208,16 +1233,19 @@ static int nilfs_segctor_begin_construction(struct nilfs_sc_info *sci,
 {
 	struct nilfs_segment_buffer *segbuf, *prev;
 	__u64 nextnum;
-	int err, alloc = 0;
+	int err, alloc = 0, shift = 0;
 
 	segbuf = nilfs_segbuf_new(sci->sc_super);
 	if (unlikely(!segbuf))
 		return -ENOMEM;
 
 	if (list_empty(&sci->sc_write_logs)) {
+		if (nilfs_test_opt(nilfs, COLDSEG))
+			shift = nilfs_segctor_switch_temperature(sci, nilfs);
+
 		nilfs_segbuf_map(segbuf, nilfs->ns_segnum,
 				 nilfs->ns_pseg_offset, nilfs);
-		if (segbuf->sb_rest_blocks < NILFS_PSEG_MIN_BLOCKS) {
+		if (shift || segbuf->sb_rest_blocks < NILFS_PSEG_MIN_BLOCKS) {
 			nilfs_shift_to_next_segment(nilfs);
 			nilfs_segbuf_map(segbuf, nilfs->ns_segnum, 0, nilfs);
 		}
@@ -2326,6 +2354,13 @@ int nilfs_clean_segments(struct super_block *sb, struct nilfs_argv *argv,
 
 	nilfs_transaction_lock(sb, &ti, 1);
 
+	if (nilfs_test_opt(nilfs, COLDSEG)) {
+		/* keep files written so far out of the segments of GC */
+		err = nilfs_segctor_construct(sci, SC_LSEG_SR);
+		if (unlikely(err))
+			goto out_unlock;
+	}
+
 	err = nilfs_mdt_save_to_shadow_map(nilfs->ns_dat);
 	if (unlikely(err))
 		goto out_unlock;
@@ -192,6 +192,8 @@ enum {
 	NILFS_SC_HAVE_DELTA,	/* Next checkpoint will have update of files
 				   other than DAT, cpfile, sufile, or files
 				   moved by GC */
+	NILFS_SC_COLD_SEGMENT,	/* The current segment holds blocks moved by
+				   GC (coldseg option) */
 };
 
 /* sc_state */
@@ -670,6 +670,8 @@ static int nilfs_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_puts(seq, ",norecovery");
 	if (nilfs_test_opt(nilfs, DISCARD))
 		seq_puts(seq, ",discard");
+	if (nilfs_test_opt(nilfs, COLDSEG))
+		seq_puts(seq, ",coldseg");
 
 	return 0;
 }
@@ -698,7 +700,7 @@ static const struct super_operations nilfs_sops = {
 enum {
 	Opt_err_cont, Opt_err_panic, Opt_err_ro,
 	Opt_barrier, Opt_nobarrier, Opt_snapshot, Opt_order, Opt_norecovery,
-	Opt_discard, Opt_nodiscard, Opt_err,
+	Opt_discard, Opt_nodiscard, Opt_coldseg, Opt_nocoldseg, Opt_err,
 };
 
 static match_table_t tokens = {
@@ -712,6 +714,8 @@ static match_table_t tokens = {
 	{Opt_norecovery, "norecovery"},
 	{Opt_discard, "discard"},
 	{Opt_nodiscard, "nodiscard"},
+	{Opt_coldseg, "coldseg"},
+	{Opt_nocoldseg, "nocoldseg"},
 	{Opt_err, NULL}
 };
 
@@ -773,6 +777,12 @@ static int parse_options(char *options, struct super_block *sb, int is_remount)
 		case Opt_nodiscard:
 			nilfs_clear_opt(nilfs, DISCARD);
 			break;
+		case Opt_coldseg:
+			nilfs_set_opt(nilfs, COLDSEG);
+			break;
+		case Opt_nocoldseg:
+			nilfs_clear_opt(nilfs, COLDSEG);
+			break;
 		default:
 			printk(KERN_ERR
 			       "NILFS: Unrecognized mount option \"%s\"\n", p);
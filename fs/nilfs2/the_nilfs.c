@@ -414,6 +414,34 @@ static int nilfs_store_disk_layout(struct the_nilfs *nilfs,
 	return 0;
 }
 
+/*
+ * Flash media erase in units much larger than a block.  A segment that
+ * doesn't cover whole erase units makes the card's translation layer
+ * copy the data of the neighbouring segment each time it is rewritten,
+ * which is what a log-structured layout is meant to avoid.  The layout
+ * is chosen by mkfs, so only report it.
+ */
+static void nilfs_check_erase_unit(struct the_nilfs *nilfs)
+{
+	struct block_device *bdev = nilfs->ns_bdev;
+	struct request_queue *q = bdev_get_queue(bdev);
+	unsigned int erase_size = q->limits.discard_granularity;
+	u64 seg_bytes, start, rem_seg, rem_start;
+
+	if (!blk_queue_discard(q) ||
+	    erase_size <= bdev_logical_block_size(bdev))
+		return;
+
+	seg_bytes = (u64)nilfs->ns_blocks_per_segment <<
+		nilfs->ns_blocksize_bits;
+	start = (u64)get_start_sect(bdev) << 9;
+	rem_seg = do_div(seg_bytes, erase_size);
+	rem_start = do_div(start, erase_size);
+	if (rem_seg || rem_start)
+		printk(KERN_INFO "NILFS: segments are not aligned to the "
+		       "%u byte erase unit of the device\n", erase_size);
+}
+
 static int nilfs_valid_sb(struct nilfs_super_block *sbp)
 {
 	static unsigned char sum[4];
@@ -614,6 +642,8 @@ int init_nilfs(struct the_nilfs *nilfs, struct super_block *sb, char *data)
 	if (err)
 		goto failed_sbh;
 
+	nilfs_check_erase_unit(nilfs);
+
 	sb->s_maxbytes = nilfs_max_size(sb->s_blocksize_bits);
 
 	nilfs->ns_mount_state = le16_to_cpu(sbp->s_state);
@@ -659,7 +689,8 @@ int nilfs_discard_segments(struct the_nilfs *nilfs, __u64 *segnump,
 						   GFP_NOFS, 0);
 			if (ret < 0)
 				return ret;
-			nblocks = 0;
+			start = seg_start;
+			nblocks = seg_end - seg_start + 1;
 		}
 	}
 	if (nblocks)
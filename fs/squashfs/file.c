@@ -46,6 +46,7 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/pagemap.h>
+#include <linux/highmem.h>
 #include <linux/mutex.h>
 
 #include "squashfs_fs.h"
@@ -371,26 +372,98 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
-static int squashfs_readpage(struct file *file, struct page *page)
+/*
+ * Number of page cache pages of datablock 'index' that lie inside the file.
+ */
+static int squashfs_block_pages(struct inode *inode, int index)
 {
-	struct inode *inode = page->mapping->host;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-	int bytes, i, offset = 0, sparse = 0;
-	struct squashfs_cache_entry *buffer = NULL;
-	void *pageaddr;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_pages = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
+					PAGE_CACHE_SHIFT;
 
-	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
-	int index = page->index >> (msblk->block_log - PAGE_CACHE_SHIFT);
-	int start_index = page->index & ~mask;
-	int end_index = start_index | mask;
-	int file_end = i_size_read(inode) >> msblk->block_log;
+	return min(1 << shift, file_pages - (index << shift));
+}
 
-	TRACE("Entered squashfs_readpage, page index %lx, start block %llx\n",
-				page->index, squashfs_i(inode)->start);
 
-	if (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
-					PAGE_CACHE_SHIFT))
-		goto out;
+/*
+ * Decompress a datablock straight into its page cache pages, without going
+ * through the read_page cache and copying out of it.  All pages of the
+ * block must be present.  Returns the number of bytes decompressed, or a
+ * negative error; -ENOMEM means the caller should use the cache instead.
+ */
+static int squashfs_read_direct(struct inode *inode, u64 block, int bsize,
+	struct page **page, int pages)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	void **pageaddr;
+	int i, res, bytes;
+
+	pageaddr = kmalloc(pages * sizeof(void *), GFP_KERNEL);
+	if (pageaddr == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	/* the last block of a file may have fewer pages than block_size */
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		min_t(int, msblk->block_size, pages << PAGE_CACHE_SHIFT),
+		pages);
+
+	/* zero whatever the block didn't fill */
+	for (i = 0, bytes = max(res, 0); i < pages; i++,
+					bytes -= PAGE_CACHE_SIZE) {
+		if (bytes < (int) PAGE_CACHE_SIZE) {
+			int avail = max(bytes, 0);
+			memset(pageaddr[i] + avail, 0, PAGE_CACHE_SIZE - avail);
+		}
+		kunmap(page[i]);
+	}
+
+	kfree(pageaddr);
+
+	return res < 0 ? -EIO : res;
+}
+
+
+/*
+ * Fill the pages of datablock 'index'.  'page' has one slot per page of
+ * the block inside the file (see squashfs_block_pages()).  Slots set by the
+ * caller hold locked pages that are not uptodate; the others are grabbed
+ * here if that can be done without blocking.  Every page is unlocked and
+ * released on return.  Errors are only flagged on 'target', the page a
+ * reader is waiting on, the others are left !uptodate for ->readpage to
+ * retry.
+ *
+ * If all pages could be had a datablock is decompressed directly into
+ * them.  Otherwise, and for fragments which are shared between files, the
+ * block goes through the cache and is copied into the pages there are.
+ */
+static void squashfs_fill_block(struct inode *inode, int index,
+	struct page **page, int pages, struct page *target)
+{
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_cache_entry *buffer;
+	int start_index = index << (msblk->block_log - PAGE_CACHE_SHIFT);
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int i, bytes, offset = 0, missing = 0;
+	void *pageaddr;
+
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL) {
+			page[i] = grab_cache_page_nowait(inode->i_mapping,
+							start_index + i);
+			if (page[i] && PageUptodate(page[i])) {
+				unlock_page(page[i]);
+				page_cache_release(page[i]);
+				page[i] = NULL;
+			}
+		}
+		if (page[i] == NULL)
+			missing++;
+	}
 
 	if (index < file_end || squashfs_i(inode)->fragment_block ==
 					SQUASHFS_INVALID_BLK) {
@@ -404,30 +477,45 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			goto error_out;
 
 		if (bsize == 0) { /* hole */
-			bytes = index == file_end ?
-				(i_size_read(inode) & (msblk->block_size - 1)) :
-				 msblk->block_size;
-			sparse = 1;
-		} else {
-			/*
-			 * Read and decompress datablock.
-			 */
-			buffer = squashfs_get_datablock(inode->i_sb,
-								block, bsize);
-			if (buffer->error) {
+			for (i = 0; i < pages; i++) {
+				if (page[i] == NULL)
+					continue;
+				pageaddr = kmap_atomic(page[i], KM_USER0);
+				memset(pageaddr, 0, PAGE_CACHE_SIZE);
+				kunmap_atomic(pageaddr, KM_USER0);
+			}
+			goto uptodate;
+		}
+
+		if (!missing) {
+			int res = squashfs_read_direct(inode, block, bsize,
+							page, pages);
+			if (res >= 0)
+				goto uptodate;
+			if (res != -ENOMEM) {
 				ERROR("Unable to read page, block %llx, size %x"
 					"\n", block, bsize);
-				squashfs_cache_put(buffer);
 				goto error_out;
 			}
-			bytes = buffer->length;
 		}
+
+		/*
+		 * Read and decompress datablock.
+		 */
+		buffer = squashfs_get_datablock(sb, block, bsize);
+		if (buffer->error) {
+			ERROR("Unable to read page, block %llx, size %x\n",
+				block, bsize);
+			squashfs_cache_put(buffer);
+			goto error_out;
+		}
+		bytes = buffer->length;
 	} else {
 		/*
 		 * Datablock is stored inside a fragment (tail-end packed
 		 * block).
 		 */
-		buffer = squashfs_get_fragment(inode->i_sb,
+		buffer = squashfs_get_fragment(sb,
 				squashfs_i(inode)->fragment_block,
 				squashfs_i(inode)->fragment_size);
 
@@ -442,47 +530,83 @@ static int squashfs_readpage(struct file *file, struct page *page)
 		offset = squashfs_i(inode)->fragment_offset;
 	}
 
-	/*
-	 * Loop copying datablock into pages.  As the datablock likely covers
-	 * many PAGE_CACHE_SIZE pages (default block size is 128 KiB) explicitly
-	 * grab the pages from the page cache, except for the page that we've
-	 * been called to fill.
-	 */
-	for (i = start_index; i <= end_index && bytes > 0; i++,
-			bytes -= PAGE_CACHE_SIZE, offset += PAGE_CACHE_SIZE) {
-		struct page *push_page;
-		int avail = sparse ? 0 : min_t(int, bytes, PAGE_CACHE_SIZE);
+	for (i = 0; i < pages; i++, bytes -= PAGE_CACHE_SIZE,
+					offset += PAGE_CACHE_SIZE) {
+		int avail = clamp_t(int, bytes, 0, PAGE_CACHE_SIZE);
 
 		TRACE("bytes %d, i %d, available_bytes %d\n", bytes, i, avail);
 
-		push_page = (i == page->index) ? page :
-			grab_cache_page_nowait(page->mapping, i);
-
-		if (!push_page)
+		if (page[i] == NULL)
 			continue;
 
-		if (PageUptodate(push_page))
-			goto skip_page;
-
-		pageaddr = kmap_atomic(push_page, KM_USER0);
+		pageaddr = kmap_atomic(page[i], KM_USER0);
 		squashfs_copy_data(pageaddr, buffer, offset, avail);
 		memset(pageaddr + avail, 0, PAGE_CACHE_SIZE - avail);
 		kunmap_atomic(pageaddr, KM_USER0);
-		flush_dcache_page(push_page);
-		SetPageUptodate(push_page);
-skip_page:
-		unlock_page(push_page);
-		if (i != page->index)
-			page_cache_release(push_page);
 	}
 
-	if (!sparse)
-		squashfs_cache_put(buffer);
+	squashfs_cache_put(buffer);
 
-	return 0;
+uptodate:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+	return;
 
 error_out:
-	SetPageError(page);
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
+		if (page[i] == target) {
+			pageaddr = kmap_atomic(target, KM_USER0);
+			memset(pageaddr, 0, PAGE_CACHE_SIZE);
+			kunmap_atomic(pageaddr, KM_USER0);
+			flush_dcache_page(target);
+			SetPageError(target);
+		}
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+}
+
+
+static int squashfs_readpage(struct file *file, struct page *page)
+{
+	struct inode *inode = page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int index = page->index >> shift;
+	struct page **block_page;
+	void *pageaddr;
+
+	TRACE("Entered squashfs_readpage, page index %lx, start block %llx\n",
+				page->index, squashfs_i(inode)->start);
+
+	if (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
+					PAGE_CACHE_SHIFT))
+		goto out;
+
+	block_page = kcalloc(squashfs_block_pages(inode, index),
+			sizeof(*block_page), GFP_KERNEL);
+	if (block_page == NULL) {
+		SetPageError(page);
+		goto out;
+	}
+
+	/* squashfs_fill_block() drops a reference on every page it fills */
+	page_cache_get(page);
+	block_page[page->index - (index << shift)] = page;
+	squashfs_fill_block(inode, index, block_page,
+		squashfs_block_pages(inode, index), page);
+	kfree(block_page);
+
+	return 0;
+
 out:
 	pageaddr = kmap_atomic(page, KM_USER0);
 	memset(pageaddr, 0, PAGE_CACHE_SIZE);
@@ -496,6 +620,61 @@ out:
 }
 
 
+/*
+ * Readahead.  The pages come in ascending index order from the tail of the
+ * list; those belonging to one datablock are added to the page cache
+ * together and the block is filled once, straight into them.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	struct page **block_page;
+
+	TRACE("Entered squashfs_readpages, %u pages, start block %llx\n",
+				nr_pages, squashfs_i(inode)->start);
+
+	block_page = kcalloc(1 << shift, sizeof(*block_page), GFP_KERNEL);
+	if (block_page == NULL)
+		return 0;
+
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+		int index = page->index >> shift;
+		int start_index = index << shift;
+		int added = 0;
+
+		while (1) {
+			list_del(&page->lru);
+			if (add_to_page_cache_lru(page, mapping, page->index,
+							GFP_KERNEL) == 0) {
+				block_page[page->index - start_index] = page;
+				added++;
+			} else
+				page_cache_release(page);
+
+			if (list_empty(pages))
+				break;
+			page = list_entry(pages->prev, struct page, lru);
+			if (page->index >> shift != index)
+				break;
+		}
+
+		if (added)
+			squashfs_fill_block(inode, index, block_page,
+				squashfs_block_pages(inode, index), NULL);
+		memset(block_page, 0, sizeof(*block_page) << shift);
+	}
+
+	kfree(block_page);
+
+	return 0;
+}
+
+
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
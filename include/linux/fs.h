@@ -920,6 +920,8 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+	pgoff_t stride;			/* Distance between the last random reads */
+	pgoff_t stride_start;		/* Origin of the next stride */
 };
 
 /*
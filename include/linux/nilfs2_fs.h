@@ -134,6 +134,8 @@ struct nilfs_super_root {
 #define NILFS_MOUNT_NORECOVERY		0x4000  /* Disable write access during
 						   mount-time recovery */
 #define NILFS_MOUNT_DISCARD		0x8000  /* Issue DISCARD requests */
+#define NILFS_MOUNT_COLDSEG		0x10000 /* Write blocks moved by GC
+						   to segments of their own */
 
 
 /**
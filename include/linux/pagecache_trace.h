@@ -0,0 +1,28 @@
+#ifndef _LINUX_PAGECACHE_TRACE_H
+#define _LINUX_PAGECACHE_TRACE_H
+
+#include <linux/fs.h>
+#include <linux/compiler.h>
+
+#ifdef CONFIG_PAGECACHE_TRACE
+extern int pagecache_trace_on;
+extern void __pagecache_trace(struct address_space *mapping, pgoff_t index);
+
+/*
+ * Record an access to page 'index' of 'mapping' while a trace is being
+ * taken, see Documentation/vm/pagecache-trace.txt.
+ */
+static inline void pagecache_trace(struct address_space *mapping,
+				   pgoff_t index)
+{
+	if (unlikely(pagecache_trace_on))
+		__pagecache_trace(mapping, index);
+}
+#else
+static inline void pagecache_trace(struct address_space *mapping,
+				   pgoff_t index)
+{
+}
+#endif
+
+#endif /* _LINUX_PAGECACHE_TRACE_H */
@@ -227,6 +227,31 @@ TRACE_EVENT(jbd2_cleanup_journal_tail,
 		  __entry->first_tid, __entry->block_nr, __entry->freed)
 );
 
+TRACE_EVENT(jbd2_sync_commit,
+
+	TP_PROTO(journal_t *journal, tid_t tid, u64 batch, u64 latency),
+
+	TP_ARGS(journal, tid, batch, latency),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,	dev			)
+		__field(	tid_t,	tid			)
+		__field(unsigned long,	batch_us		)
+		__field(unsigned long,	latency_us		)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= journal->j_fs_dev->bd_dev;
+		__entry->tid		= tid;
+		__entry->batch_us	= div_u64(batch, NSEC_PER_USEC);
+		__entry->latency_us	= div_u64(latency, NSEC_PER_USEC);
+	),
+
+	TP_printk("dev %s transaction %u batch %lu us latency %lu us",
+		  jbd2_dev_to_name(__entry->dev), __entry->tid,
+		  __entry->batch_us, __entry->latency_us)
+);
+
 #endif /* _TRACE_JBD2_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,79 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM readahead
+
+#if !defined(_TRACE_READAHEAD_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_READAHEAD_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+#include <linux/fs.h>
+
+/* which access pattern a readahead decision was based on */
+#define RA_PATTERN_INITIAL	0	/* start of file or of a stream */
+#define RA_PATTERN_SEQUENTIAL	1	/* expected offset, window ramped up */
+#define RA_PATTERN_MARKER	2	/* PG_readahead hit without state */
+#define RA_PATTERN_OVERSIZE	3	/* request larger than the window */
+#define RA_PATTERN_CONTEXT	4	/* stream found in the page cache */
+#define RA_PATTERN_STRIDE	5	/* constant distance between reads */
+#define RA_PATTERN_RANDOM	6	/* read as is */
+#define RA_PATTERN_AROUND	7	/* mmap read-around */
+
+#define show_ra_pattern(pattern)				\
+	__print_symbolic(pattern,				\
+		{RA_PATTERN_INITIAL,	"initial"},		\
+		{RA_PATTERN_SEQUENTIAL,	"sequential"},		\
+		{RA_PATTERN_MARKER,	"marker"},		\
+		{RA_PATTERN_OVERSIZE,	"oversize"},		\
+		{RA_PATTERN_CONTEXT,	"context"},		\
+		{RA_PATTERN_STRIDE,	"stride"},		\
+		{RA_PATTERN_RANDOM,	"random"},		\
+		{RA_PATTERN_AROUND,	"around"})
+
+/*
+ * One per readahead decision.  The pages requested against those
+ * actually read (not already cached), per inode, give the efficiency
+ * of readahead on each file.
+ */
+TRACE_EVENT(readahead,
+
+	TP_PROTO(struct address_space *mapping, pgoff_t offset,
+		 unsigned long req_size, pgoff_t start, unsigned long size,
+		 int pattern, unsigned long actual),
+
+	TP_ARGS(mapping, offset, req_size, start, size, pattern, actual),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	ino_t,		ino		)
+		__field(	pgoff_t,	offset		)
+		__field(	unsigned long,	req_size	)
+		__field(	pgoff_t,	start		)
+		__field(	unsigned long,	size		)
+		__field(	int,		pattern		)
+		__field(	unsigned long,	actual		)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= mapping->host->i_sb->s_dev;
+		__entry->ino		= mapping->host->i_ino;
+		__entry->offset		= offset;
+		__entry->req_size	= req_size;
+		__entry->start		= start;
+		__entry->size		= size;
+		__entry->pattern	= pattern;
+		__entry->actual		= actual;
+	),
+
+	TP_printk("dev %d,%d ino %lu %s offset %lu req %lu "
+		  "window %lu+%lu read %lu",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  (unsigned long) __entry->ino,
+		  show_ra_pattern(__entry->pattern),
+		  __entry->offset, __entry->req_size,
+		  __entry->start, __entry->size, __entry->actual)
+);
+
+#endif /* _TRACE_READAHEAD_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,161 @@
+/*
+ * LZ4 decompressor for the Linux kernel: kernel images, initramfs and
+ * initrd compressed with "lz4 -l", the legacy LZ4 frame format.
+ *
+ * The stream is a 4 byte magic number followed by chunks, each a little
+ * endian 32 bit compressed size and an LZ4 block of at most 8 MiB of
+ * output.  There is no end marker and no checksum: the stream ends with
+ * the input, at a zero chunk size (padding), or at the 4 byte size that
+ * is appended to a compressed kernel image.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_LEGACY_MAGIC	0x184c2102
+#define LZ4_LEGACY_CHUNK	(8 << 20)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	u32 src_len;
+	size_t dst_len;
+	u8 *in_buf, *in_buf_save, *out_buf;
+	int ret = -1;
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_LEGACY_CHUNK);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(lz4_compressbound(LZ4_LEGACY_CHUNK));
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+	}
+	in_buf_save = in_buf;
+
+	if (posp)
+		*posp = 0;
+
+	if (fill)
+		in_len = fill(in_buf, 4);
+
+	if (in_len < 4 || get_unaligned_le32(in_buf) != LZ4_LEGACY_MAGIC) {
+		error("invalid header");
+		goto exit_2;
+	}
+	in_buf += 4;
+	in_len -= 4;
+	if (posp)
+		*posp = 4;
+
+	for (;;) {
+		/*
+		 * With a fill function every chunk is read to the start of
+		 * the buffer, otherwise the buffer is walked.
+		 */
+		if (fill) {
+			in_buf = in_buf_save;
+			in_len = fill(in_buf, 4);
+			if (in_len == 0)
+				break;
+		} else if (in_len <= 4) {
+			break;
+		}
+		if (in_len < 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		src_len = get_unaligned_le32(in_buf);
+
+		/* padding */
+		if (src_len == 0)
+			break;
+
+		in_buf += 4;
+		in_len -= 4;
+		if (posp)
+			*posp += 4;
+
+		/* another stream concatenated to this one */
+		if (src_len == LZ4_LEGACY_MAGIC)
+			continue;
+
+		if (src_len > lz4_compressbound(LZ4_LEGACY_CHUNK)) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		if (fill)
+			in_len = fill(in_buf, src_len);
+		if (in_len < (int)src_len) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		dst_len = LZ4_LEGACY_CHUNK;
+		if (lz4_decompress_unknownoutputsize(in_buf, src_len,
+						out_buf, &dst_len)) {
+			error("Compressed data violation");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, dst_len) != dst_len)
+			goto exit_2;
+		if (output)
+			out_buf += dst_len;
+		if (posp)
+			*posp += src_len;
+
+		in_buf += src_len;
+		in_len -= src_len;
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf_save);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
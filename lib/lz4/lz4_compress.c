@@ -0,0 +1,103 @@
+/*
+ * LZ4 - Fast LZ compression algorithm
+ *
+ * A single pass over the input with a hash table of the last position
+ * each 4 byte sequence was seen at.  The step between probes grows while
+ * no match is found, so incompressible data goes through quickly.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define HASH_LOG	12
+#define SKIPSTRENGTH	6
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *hash_table = wrkmem;
+	const u8 *ip = src, *anchor = src, *forward_ip, *ref;
+	const u8 * const iend = src + src_len;
+	const u8 * const mflimit = iend - MFLIMIT;
+	const u8 * const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst;
+	u32 h, forward_h;
+
+	BUILD_BUG_ON(LZ4_MEM_COMPRESS < (1 << HASH_LOG) * sizeof(u32));
+
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	/* stale entries point at src, every candidate is checked anyway */
+	memset(hash_table, 0, LZ4_MEM_COMPRESS);
+
+	hash_table[LZ4_HASH(ip, HASH_LOG)] = 0;
+	forward_h = LZ4_HASH(++ip, HASH_LOG);
+
+	for (;;) {
+		unsigned attempts = (1U << SKIPSTRENGTH) + 3;
+		size_t length;
+
+		/* find a match */
+		forward_ip = ip;
+		do {
+			h = forward_h;
+			ip = forward_ip;
+			forward_ip = ip + (attempts++ >> SKIPSTRENGTH);
+
+			if (unlikely(forward_ip > mflimit))
+				goto last_literals;
+
+			forward_h = LZ4_HASH(forward_ip, HASH_LOG);
+			ref = src + hash_table[h];
+			hash_table[h] = ip - src;
+		} while (ref + MAX_DISTANCE < ip || A32(ref) != A32(ip));
+
+		/* extend the match backwards over pending literals */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		for (;;) {
+			length = lz4_count(ip + MINMATCH, ref + MINMATCH,
+					matchlimit) + MINMATCH;
+			op = lz4_encode_sequence(op, anchor, ip, ref, length);
+			ip += length;
+			anchor = ip;
+
+			if (ip > mflimit)
+				goto last_literals;
+
+			/* fill the table for the position just covered */
+			hash_table[LZ4_HASH(ip - 2, HASH_LOG)] = ip - 2 - src;
+
+			/* a match right at the end of this one needs no search */
+			h = LZ4_HASH(ip, HASH_LOG);
+			ref = src + hash_table[h];
+			hash_table[h] = ip - src;
+			if (ref + MAX_DISTANCE < ip || A32(ref) != A32(ip))
+				break;
+		}
+
+		forward_h = LZ4_HASH(++ip, HASH_LOG);
+	}
+
+last_literals:
+	op = lz4_encode_last(op, anchor, iend);
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 compressor");
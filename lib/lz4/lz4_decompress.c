@@ -0,0 +1,151 @@
+/*
+ * LZ4 Decompressor
+ *
+ * Literals and matches are copied 8 bytes at a time while there is room
+ * for the overshoot, and byte by byte near the end of either buffer.
+ * Every length and offset is checked against the buffers, so corrupt
+ * input can't make it read or write out of bounds.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+/*
+ * A match closer than 8 bytes overlaps its own copy.  Once its first 8
+ * bytes are written byte by byte, the source is moved back by a whole
+ * number of periods to at least 8 bytes behind, from where the pattern
+ * can be copied 8 bytes at a time.
+ */
+static const int lz4_period[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	const u8 *ip = src, *ref;
+	const u8 * const iend = ip + src_len;
+	u8 *op = dest, *cpy;
+	u8 * const oend = op + *dest_len;
+	size_t length, offset;
+	unsigned token;
+	int s;
+
+	while (ip < iend) {
+		/* literal run */
+		token = *ip++;
+		length = token >> ML_BITS;
+
+		if (likely(length < RUN_MASK && iend - ip >= 16 &&
+				oend - op >= 16)) {
+			/*
+			 * Most runs are short: copy 16 bytes whatever the
+			 * length, the match overwrites the excess.
+			 */
+			COPY8(op, ip);
+			COPY8(op + 8, ip + 8);
+			op += length;
+			ip += length;
+		} else {
+			if (length == RUN_MASK) {
+				do {
+					if (unlikely(ip >= iend))
+						goto malformed;
+					s = *ip++;
+					length += s;
+				} while (s == 255);
+			}
+
+			if (unlikely(length > (size_t)(iend - ip) ||
+					length > (size_t)(oend - op)))
+				goto malformed;
+
+			cpy = op + length;
+			if (cpy > oend - COPYLENGTH ||
+					ip + length > iend - COPYLENGTH) {
+				memcpy(op, ip, length);
+				ip += length;
+				op = cpy;
+				/* the block ends with a literal run */
+				if (ip == iend)
+					break;
+			} else {
+				LZ4_WILDCOPY(ip, op, cpy);
+				ip -= op - cpy;
+				op = cpy;
+			}
+		}
+
+		/* match */
+		if (unlikely(iend - ip < 2))
+			goto malformed;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(offset == 0 || offset > (size_t)(op - dest)))
+			goto malformed;
+		ref = op - offset;
+
+		length = token & ML_MASK;
+		if (length == ML_MASK) {
+			do {
+				if (unlikely(ip >= iend))
+					goto malformed;
+				s = *ip++;
+				length += s;
+			} while (s == 255);
+		}
+		length += MINMATCH;
+
+		if (unlikely(length > (size_t)(oend - op)))
+			goto malformed;
+
+		cpy = op + length;
+		if (likely(length <= 16 && offset >= 8 && oend - op >= 16)) {
+			/* likewise for short matches that don't overlap */
+			COPY8(op, ref);
+			COPY8(op + 8, ref + 8);
+			op = cpy;
+			continue;
+		}
+		if (cpy > oend - COPYLENGTH) {
+			while (op < cpy)
+				*op++ = *ref++;
+			continue;
+		}
+
+		if (unlikely(offset < 8)) {
+			int i;
+
+			for (i = 0; i < 8; i++)
+				op[i] = ref[i];
+			op += 8;
+			ref = op - lz4_period[offset];
+		}
+		while (op < cpy) {
+			COPY8(op, ref);
+			op += 8;
+			ref += 8;
+		}
+		op = cpy;
+	}
+
+	*dest_len = op - dest;
+	return 0;
+
+malformed:
+	return -1;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
@@ -0,0 +1,122 @@
+/*
+ * lz4defs.h -- common definitions of the LZ4 compressors and decompressor
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * A sequence is a token, the extra literal length bytes, the literals, a
+ * 16-bit little endian offset and the extra match length bytes.  The high
+ * nibble of the token holds the literal run length, the low nibble the
+ * match length minus MINMATCH; 15 means more length bytes follow, each
+ * adding up to 255.  The block ends with a sequence of literals only.
+ */
+#define MINMATCH	4
+
+#define COPYLENGTH	8
+#define LASTLITERALS	5
+#define MFLIMIT		(COPYLENGTH + MINMATCH)
+#define MINLENGTH	(MFLIMIT + 1)
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define MAX_DISTANCE	((1 << 16) - 1)
+
+#define A32(p)		get_unaligned((const u32 *)(p))
+#define COPY4(dst, src)	\
+		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
+#define COPY8(dst, src)	\
+		do { COPY4(dst, src); COPY4((dst) + 4, (src) + 4); } while (0)
+
+/* copies in 8 byte steps, so may write up to 7 bytes past 'e' */
+#define LZ4_WILDCOPY(s, d, e)	\
+		do { COPY8(d, s); d += 8; s += 8; } while (d < e)
+
+/* hash of the 4 bytes at p, 'bits' wide */
+#define LZ4_HASH(p, bits)	\
+		((A32(p) * 2654435761U) >> (32 - (bits)))
+
+/*
+ * Number of bytes that match at p and match, not reading at or beyond
+ * limit.
+ */
+static inline size_t lz4_count(const u8 *p, const u8 *match, const u8 *limit)
+{
+	const u8 *start = p;
+
+	while (p < limit - 3) {
+		if (A32(match) != A32(p))
+			break;
+		p += 4;
+		match += 4;
+	}
+	while (p < limit && *match == *p) {
+		p++;
+		match++;
+	}
+
+	return p - start;
+}
+
+/* a literal run or match length: 15 in the token and the rest in bytes */
+static inline u8 *lz4_put_length(u8 *op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = length;
+
+	return op;
+}
+
+/*
+ * Emits the literals from anchor up to ip, followed by a match of
+ * 'length' bytes at distance ip - ref.
+ */
+static inline u8 *lz4_encode_sequence(u8 *op, const u8 *anchor,
+		const u8 *ip, const u8 *ref, size_t length)
+{
+	size_t run = ip - anchor;
+	u8 *token = op++;
+
+	if (run >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, run - RUN_MASK);
+	} else
+		*token = run << ML_BITS;
+
+	memcpy(op, anchor, run);
+	op += run;
+
+	put_unaligned_le16(ip - ref, op);
+	op += 2;
+
+	length -= MINMATCH;
+	if (length >= ML_MASK) {
+		*token |= ML_MASK;
+		op = lz4_put_length(op, length - ML_MASK);
+	} else
+		*token |= length;
+
+	return op;
+}
+
+/* the final sequence: the literals from anchor to the end of the input */
+static inline u8 *lz4_encode_last(u8 *op, const u8 *anchor, const u8 *iend)
+{
+	size_t run = iend - anchor;
+
+	if (run >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, run - RUN_MASK);
+	} else
+		*op++ = run << ML_BITS;
+
+	memcpy(op, anchor, run);
+
+	return op + run;
+}
@@ -0,0 +1,137 @@
+/*
+ * LZ4 HC - High Compression Mode of LZ4
+ *
+ * Every position is entered into hash chains, and the longest match among
+ * the most recent candidates is taken, unless starting one byte later
+ * gives a longer one.  The output is a normal LZ4 block: compression is
+ * several times slower than lz4_compress(), decompression just as fast.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define HASH_LOG	15
+#define MAXD_LOG	16
+#define MAXD_MASK	((1 << MAXD_LOG) - 1)
+#define MAX_ATTEMPTS	256
+
+struct lz4hc_data {
+	const u8 *base;
+	u32 next_to_update;
+	u32 hash_table[1 << HASH_LOG];
+	u16 chain_table[1 << MAXD_LOG];
+};
+
+/* enter the positions up to ip into the chains */
+static inline void lz4hc_insert(struct lz4hc_data *hc, const u8 *ip)
+{
+	u32 target = ip - hc->base;
+
+	while (hc->next_to_update < target) {
+		u32 pos = hc->next_to_update++;
+		u32 h = LZ4_HASH(hc->base + pos, HASH_LOG);
+		u32 delta = pos - hc->hash_table[h];
+
+		if (delta == 0 || delta > MAX_DISTANCE)
+			delta = MAX_DISTANCE;
+		hc->chain_table[pos & MAXD_MASK] = delta;
+		hc->hash_table[h] = pos;
+	}
+}
+
+static inline size_t lz4hc_find_match(struct lz4hc_data *hc, const u8 *ip,
+		const u8 *matchlimit, const u8 **matchpos)
+{
+	const u8 *base = hc->base;
+	u32 pos = ip - base, cand;
+	int attempts = MAX_ATTEMPTS;
+	size_t ml = 0, length;
+
+	lz4hc_insert(hc, ip);
+
+	cand = hc->hash_table[LZ4_HASH(ip, HASH_LOG)];
+	while (cand < pos && pos - cand <= MAX_DISTANCE && attempts--) {
+		const u8 *ref = base + cand;
+		u32 delta;
+
+		/* a longer match must also differ from the best one at ml */
+		if (ref[ml] == ip[ml] && A32(ref) == A32(ip)) {
+			length = lz4_count(ip + MINMATCH, ref + MINMATCH,
+					matchlimit) + MINMATCH;
+			if (length > ml) {
+				ml = length;
+				*matchpos = ref;
+			}
+		}
+
+		delta = hc->chain_table[cand & MAXD_MASK];
+		if (delta > cand)
+			break;
+		cand -= delta;
+	}
+
+	return ml;
+}
+
+int lz4hc_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	struct lz4hc_data *hc = wrkmem;
+	const u8 *ip = src, *anchor = src, *ref = NULL, *ref2 = NULL;
+	const u8 * const iend = src + src_len;
+	const u8 * const mflimit = iend - MFLIMIT;
+	const u8 * const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst;
+	size_t ml, ml2;
+
+	BUILD_BUG_ON(sizeof(struct lz4hc_data) > LZ4HC_MEM_COMPRESS);
+
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	hc->base = src;
+	hc->next_to_update = 0;
+	memset(hc->hash_table, 0, sizeof(hc->hash_table));
+	/* all ones sends a chain out of the window */
+	memset(hc->chain_table, 0xff, sizeof(hc->chain_table));
+
+	while (ip <= mflimit) {
+		ml = lz4hc_find_match(hc, ip, matchlimit, &ref);
+		if (!ml) {
+			ip++;
+			continue;
+		}
+
+		/* lazy evaluation: defer by a literal for a longer match */
+		while (ip + 1 <= mflimit) {
+			ml2 = lz4hc_find_match(hc, ip + 1, matchlimit, &ref2);
+			if (ml2 <= ml)
+				break;
+			ip++;
+			ml = ml2;
+			ref = ref2;
+		}
+
+		op = lz4_encode_sequence(op, anchor, ip, ref, ml);
+		ip += ml;
+		anchor = ip;
+	}
+
+last_literals:
+	op = lz4_encode_last(op, anchor, iend);
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4hc_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4HC compressor");
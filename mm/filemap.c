@@ -35,6 +35,8 @@
 #include <linux/memcontrol.h>
 #include <linux/mm_inline.h> /* for page_is_file_cache() */
 #include <linux/cleancache.h>
+#include <linux/pagecache_trace.h>
+#include <trace/events/readahead.h>
 #include "internal.h"
 
 /*
@@ -1136,6 +1138,8 @@ find_page:
 			unlock_page(page);
 		}
 page_ok:
+		pagecache_trace(mapping, index);
+
 		/*
 		 * i_size must be checked after we know the page is Uptodate.
 		 *
@@ -1561,7 +1565,7 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 				   struct file *file,
 				   pgoff_t offset)
 {
-	unsigned long ra_pages;
+	unsigned long ra_pages, actual;
 	struct address_space *mapping = file->f_mapping;
 
 	/* If we don't want any read-ahead, don't bother */
@@ -1588,13 +1592,19 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 		return;
 
 	/*
-	 * mmap read-around
+	 * mmap read-around, sized by how well it has been doing so far:
+	 * mmap_miss counts faults that missed less those that found
+	 * their page read in already, and the window shrinks from the
+	 * full size towards a single page as it approaches MMAP_LOTSAMISS.
 	 */
 	ra_pages = max_sane_readahead(ra->ra_pages);
+	ra_pages -= ra_pages * ra->mmap_miss / (MMAP_LOTSAMISS + 1);
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
-	ra_submit(ra, mapping, file);
+	actual = ra_submit(ra, mapping, file);
+	trace_readahead(mapping, offset, 1, ra->start, ra->size,
+			RA_PATTERN_AROUND, actual);
 }
 
 /*
@@ -1700,6 +1710,7 @@ retry_find:
 		return VM_FAULT_SIGBUS;
 	}
 
+	pagecache_trace(mapping, offset);
 	vmf->page = page;
 	return ret | VM_FAULT_LOCKED;
 
@@ -0,0 +1,419 @@
+/*
+ * Frontswap frontend
+ *
+ * This code provides the generic "frontend" layer to call a matching
+ * "backend" driver implementation of frontswap, such as zcache, which
+ * keeps swapped out pages compressed in RAM.  A page the backend refuses,
+ * typically because its pool is full, goes to the swap device as before.
+ *
+ * The pages in the pool are kept in the order they were swapped out.
+ * When the backend refuses a page with -ENOSPC, because its pool is full,
+ * the oldest ones are written back to the swap device to make room, so
+ * the pool holds the most recently swapped out pages, those most likely
+ * to be needed again.  See Documentation/vm/frontswap.txt for more
+ * information.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ */
+
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/slab.h>
+#include <linux/pagemap.h>
+#include <linux/radix-tree.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/writeback.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+#include <linux/swapfile.h>
+#include <linux/frontswap.h>
+
+/*
+ * frontswap_ops is set by frontswap_register_ops to contain the pointers
+ * to the frontswap "backend" implementation functions.
+ */
+static struct frontswap_ops frontswap_ops;
+
+/*
+ * This global enablement flag reduces overhead on systems where frontswap_ops
+ * has not been registered, so is preferred to the slower alternative: a
+ * function call that checks a non-global.
+ */
+int frontswap_enabled;
+EXPORT_SYMBOL(frontswap_enabled);
+
+/* pages written back from the pool each time it is found full */
+#define FRONTSWAP_WRITEBACK_BATCH	32
+
+/* useful stats available in /sys/kernel/mm/frontswap */
+static unsigned long frontswap_gets;
+static unsigned long frontswap_succ_puts;
+static unsigned long frontswap_failed_puts;
+static unsigned long frontswap_flushes;
+static unsigned long frontswap_writebacks;
+static atomic_t frontswap_pages = ATOMIC_INIT(0);
+
+/*
+ * The pages in the pool, oldest first, and per swap area a radix tree
+ * by offset to find them when they are flushed.  A page is in the lru
+ * exactly when its bit is set in the frontswap_map of its swap area.
+ */
+struct frontswap_lru_entry {
+	struct list_head lru;
+	swp_entry_t entry;
+};
+
+static LIST_HEAD(frontswap_lru);
+static struct radix_tree_root frontswap_lru_tree[MAX_SWAPFILES];
+static DEFINE_SPINLOCK(frontswap_lru_lock);
+static struct kmem_cache *frontswap_lru_cache;
+
+static void frontswap_writeback_work_fn(struct work_struct *work);
+static DECLARE_WORK(frontswap_writeback_work, frontswap_writeback_work_fn);
+
+/*
+ * register operations for frontswap, returning previous thus allowing
+ * detection of multiple backends and possible nesting
+ */
+struct frontswap_ops frontswap_register_ops(struct frontswap_ops *ops)
+{
+	struct frontswap_ops old = frontswap_ops;
+
+	frontswap_ops = *ops;
+	frontswap_enabled = 1;
+	return old;
+}
+EXPORT_SYMBOL(frontswap_register_ops);
+
+unsigned long frontswap_curr_pages(void)
+{
+	return atomic_read(&frontswap_pages);
+}
+EXPORT_SYMBOL(frontswap_curr_pages);
+
+/* add a page just put into the pool, or make it the youngest again */
+static int frontswap_lru_add(unsigned type, pgoff_t offset)
+{
+	struct frontswap_lru_entry *fe;
+	int err;
+
+	spin_lock(&frontswap_lru_lock);
+	fe = radix_tree_lookup(&frontswap_lru_tree[type], offset);
+	if (fe) {
+		list_move_tail(&fe->lru, &frontswap_lru);
+		spin_unlock(&frontswap_lru_lock);
+		return 0;
+	}
+	spin_unlock(&frontswap_lru_lock);
+
+	/* called from reclaim, which must neither wait nor do I/O */
+	fe = kmem_cache_alloc(frontswap_lru_cache,
+			      GFP_NOIO | __GFP_NORETRY | __GFP_NOWARN);
+	if (!fe)
+		return -ENOMEM;
+	err = radix_tree_preload(GFP_NOIO | __GFP_NORETRY | __GFP_NOWARN);
+	if (err) {
+		kmem_cache_free(frontswap_lru_cache, fe);
+		return err;
+	}
+
+	fe->entry = swp_entry(type, offset);
+	spin_lock(&frontswap_lru_lock);
+	err = radix_tree_insert(&frontswap_lru_tree[type], offset, fe);
+	if (!err)
+		list_add_tail(&fe->lru, &frontswap_lru);
+	spin_unlock(&frontswap_lru_lock);
+	radix_tree_preload_end();
+
+	if (err)
+		kmem_cache_free(frontswap_lru_cache, fe);
+	return err;
+}
+
+static void frontswap_lru_del(unsigned type, pgoff_t offset)
+{
+	struct frontswap_lru_entry *fe;
+
+	spin_lock(&frontswap_lru_lock);
+	fe = radix_tree_delete(&frontswap_lru_tree[type], offset);
+	if (fe)
+		list_del(&fe->lru);
+	spin_unlock(&frontswap_lru_lock);
+
+	if (fe)
+		kmem_cache_free(frontswap_lru_cache, fe);
+}
+
+/* Called when a swap device is swapon'd */
+void __frontswap_init(unsigned type)
+{
+	BUG_ON(type >= MAX_SWAPFILES);
+	(*frontswap_ops.init)(type);
+}
+EXPORT_SYMBOL(__frontswap_init);
+
+/*
+ * "Put" data from a page to frontswap and associate it with the page's
+ * swaptype and offset.  Page must be locked and in the swap cache.
+ * If frontswap already contains a page with matching swaptype and
+ * offset, the frontswap implmentation may either overwrite the data
+ * and return success or flush the page from frontswap and return failure
+ */
+int __frontswap_put_page(struct page *page)
+{
+	int ret = -1, dup = 0;
+	swp_entry_t entry = { .val = page_private(page), };
+	int type = swp_type(entry);
+	struct swap_info_struct *sis = swap_info[type];
+	pgoff_t offset = swp_offset(entry);
+
+	BUG_ON(!PageLocked(page));
+	if (!frontswap_map_get(sis))
+		return ret;
+	if (frontswap_test(sis, offset))
+		dup = 1;
+	ret = (*frontswap_ops.put_page)(type, offset, page);
+	if (ret == 0 && frontswap_lru_add(type, offset)) {
+		/* can't be written back if not in the lru */
+		(*frontswap_ops.flush_page)(type, offset);
+		ret = -1;
+	}
+	if (ret == 0) {
+		frontswap_set(sis, offset);
+		frontswap_succ_puts++;
+		if (!dup)
+			atomic_inc(&frontswap_pages);
+		return ret;
+	}
+
+	if (dup) {
+		/*
+		 * failed dup always results in automatic flush of
+		 * the (older) page from frontswap
+		 */
+		frontswap_clear(sis, offset);
+		frontswap_lru_del(type, offset);
+		atomic_dec(&frontswap_pages);
+	}
+	frontswap_failed_puts++;
+
+	/*
+	 * make room in the pool for the pages swapped out next; other
+	 * refusals, such as a page that compresses badly, say nothing
+	 * about the pool
+	 */
+	if (ret == -ENOSPC)
+		schedule_work(&frontswap_writeback_work);
+	return ret;
+}
+EXPORT_SYMBOL(__frontswap_put_page);
+
+/*
+ * "Get" data from frontswap associated with swaptype and offset that were
+ * specified when the data was put to frontswap and use it to fill the
+ * specified page with data. Page must be locked and in the swap cache
+ */
+int __frontswap_get_page(struct page *page)
+{
+	int ret = -1;
+	swp_entry_t entry = { .val = page_private(page), };
+	int type = swp_type(entry);
+	struct swap_info_struct *sis = swap_info[type];
+	pgoff_t offset = swp_offset(entry);
+
+	BUG_ON(!PageLocked(page));
+	if (frontswap_test(sis, offset))
+		ret = (*frontswap_ops.get_page)(type, offset, page);
+	if (ret == 0)
+		frontswap_gets++;
+	return ret;
+}
+EXPORT_SYMBOL(__frontswap_get_page);
+
+/*
+ * Flush any data from frontswap associated with the specified swaptype
+ * and offset so that a subsequent "get" will fail.
+ */
+void __frontswap_flush_page(unsigned type, pgoff_t offset)
+{
+	struct swap_info_struct *sis = swap_info[type];
+
+	if (frontswap_test(sis, offset)) {
+		(*frontswap_ops.flush_page)(type, offset);
+		frontswap_clear(sis, offset);
+		frontswap_lru_del(type, offset);
+		atomic_dec(&frontswap_pages);
+		frontswap_flushes++;
+	}
+}
+EXPORT_SYMBOL(__frontswap_flush_page);
+
+/*
+ * Flush all data from frontswap associated with all offsets for the
+ * specified swaptype.
+ */
+void __frontswap_flush_area(unsigned type)
+{
+	struct swap_info_struct *sis = swap_info[type];
+	struct frontswap_lru_entry *fe, *next;
+	LIST_HEAD(victims);
+
+	if (!frontswap_map_get(sis))
+		return;
+
+	(*frontswap_ops.flush_area)(type);
+	bitmap_zero(frontswap_map_get(sis), sis->max);
+
+	spin_lock(&frontswap_lru_lock);
+	list_for_each_entry_safe(fe, next, &frontswap_lru, lru) {
+		if (swp_type(fe->entry) != type)
+			continue;
+		radix_tree_delete(&frontswap_lru_tree[type],
+				  swp_offset(fe->entry));
+		list_move(&fe->lru, &victims);
+	}
+	spin_unlock(&frontswap_lru_lock);
+
+	list_for_each_entry_safe(fe, next, &victims, lru) {
+		kmem_cache_free(frontswap_lru_cache, fe);
+		atomic_dec(&frontswap_pages);
+	}
+}
+EXPORT_SYMBOL(__frontswap_flush_area);
+
+/*
+ * Write the page of 'entry' from the pool back to the swap device.  It is
+ * read into the swap cache, which gets it from the pool, dropped from the
+ * pool and written out from the swap cache as reclaim would.
+ */
+static void frontswap_writeback_entry(swp_entry_t entry)
+{
+	struct swap_info_struct *sis = swap_info[swp_type(entry)];
+	pgoff_t offset = swp_offset(entry);
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_NONE,
+	};
+	struct page *page;
+
+	/* NULL if the entry was freed meanwhile */
+	page = read_swap_cache_async(entry, GFP_KERNEL, NULL, 0);
+	if (!page)
+		return;
+
+	/*
+	 * While the page is locked in the swap cache, the entry can't be
+	 * freed nor its swap area swapoff'd.
+	 */
+	lock_page(page);
+	if (!PageSwapCache(page) || page_private(page) != entry.val ||
+	    !PageUptodate(page) || PageWriteback(page) ||
+	    !frontswap_test(sis, offset)) {
+		unlock_page(page);
+		goto out;
+	}
+
+	/* nothing to write if the entry is only used by the swap cache */
+	if (try_to_free_swap(page)) {
+		unlock_page(page);
+		goto out;
+	}
+
+	__frontswap_flush_page(swp_type(entry), offset);
+	/* have reclaim free the page as soon as it is written */
+	SetPageReclaim(page);
+	__swap_writepage(page, &wbc);
+	frontswap_writebacks++;
+out:
+	page_cache_release(page);
+}
+
+static void frontswap_writeback_work_fn(struct work_struct *work)
+{
+	struct frontswap_lru_entry *fe;
+	swp_entry_t entry;
+	int i;
+
+	for (i = 0; i < FRONTSWAP_WRITEBACK_BATCH; i++) {
+		spin_lock(&frontswap_lru_lock);
+		if (list_empty(&frontswap_lru)) {
+			spin_unlock(&frontswap_lru_lock);
+			break;
+		}
+		fe = list_first_entry(&frontswap_lru,
+				      struct frontswap_lru_entry, lru);
+		/* stays the youngest if it can't be written back now */
+		list_move_tail(&fe->lru, &frontswap_lru);
+		entry = fe->entry;
+		spin_unlock(&frontswap_lru_lock);
+
+		frontswap_writeback_entry(entry);
+	}
+}
+
+#ifdef CONFIG_SYSFS
+
+/* see Documentation/vm/frontswap.txt */
+
+#define FRONTSWAP_SYSFS_RO(_name) \
+	static ssize_t frontswap_##_name##_show(struct kobject *kobj, \
+				struct kobj_attribute *attr, char *buf) \
+	{ \
+		return sprintf(buf, "%lu\n", frontswap_##_name); \
+	} \
+	static struct kobj_attribute frontswap_##_name##_attr = { \
+		.attr = { .name = __stringify(_name), .mode = 0444 }, \
+		.show = frontswap_##_name##_show, \
+	}
+
+FRONTSWAP_SYSFS_RO(gets);
+FRONTSWAP_SYSFS_RO(succ_puts);
+FRONTSWAP_SYSFS_RO(failed_puts);
+FRONTSWAP_SYSFS_RO(flushes);
+FRONTSWAP_SYSFS_RO(writebacks);
+
+static ssize_t frontswap_curr_pages_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", frontswap_curr_pages());
+}
+
+static struct kobj_attribute frontswap_curr_pages_attr = {
+	.attr = { .name = "curr_pages", .mode = 0444 },
+	.show = frontswap_curr_pages_show,
+};
+
+static struct attribute *frontswap_attrs[] = {
+	&frontswap_gets_attr.attr,
+	&frontswap_succ_puts_attr.attr,
+	&frontswap_failed_puts_attr.attr,
+	&frontswap_flushes_attr.attr,
+	&frontswap_writebacks_attr.attr,
+	&frontswap_curr_pages_attr.attr,
+	NULL,
+};
+
+static struct attribute_group frontswap_attr_group = {
+	.attrs = frontswap_attrs,
+	.name = "frontswap",
+};
+
+#endif /* CONFIG_SYSFS */
+
+/* before any backend can register */
+static int __init init_frontswap(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_SWAPFILES; i++)
+		INIT_RADIX_TREE(&frontswap_lru_tree[i],
+				GFP_ATOMIC | __GFP_NOWARN);
+	frontswap_lru_cache = KMEM_CACHE(frontswap_lru_entry, SLAB_PANIC);
+#ifdef CONFIG_SYSFS
+	if (sysfs_create_group(mm_kobj, &frontswap_attr_group))
+		printk(KERN_ERR "frontswap: can't create sysfs\n");
+#endif /* CONFIG_SYSFS */
+	return 0;
+}
+subsys_initcall(init_frontswap);
@@ -0,0 +1,280 @@
+/*
+ * Record the file pages read during boot or an application launch
+ *
+ * Every page found by a read(2) or a page fault is appended to a buffer
+ * as a (device, inode, index, number of pages) extent, extending the last
+ * one when the access is contiguous with it.  Once recording stops the
+ * buffer is sorted and overlapping extents are merged, so the trace can
+ * be replayed by userspace as large readaheads in disk order before the
+ * pages are needed.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/pagecache_trace.h>
+
+struct pagecache_extent {
+	dev_t		dev;
+	unsigned long	ino;
+	pgoff_t		index;
+	unsigned long	nr;
+};
+
+int pagecache_trace_on __read_mostly;
+
+/* number of extents in the buffer of the next recording */
+static u32 trace_size = 65536;
+
+/* keeps the buffer within what vmalloc can give on 32-bit */
+#define TRACE_SIZE_MAX	(1U << 20)
+static int trace_at_boot;
+
+static DEFINE_SPINLOCK(trace_lock);	/* recording into the buffer */
+static DEFINE_MUTEX(trace_mutex);	/* starting, stopping and reading */
+static struct pagecache_extent *trace_buf;
+static unsigned long trace_len, trace_max;
+
+void __pagecache_trace(struct address_space *mapping, pgoff_t index)
+{
+	struct inode *inode = mapping->host;
+	struct pagecache_extent *e;
+	dev_t dev;
+
+	if (!inode || !S_ISREG(inode->i_mode))
+		return;
+	dev = inode->i_sb->s_dev;
+
+	spin_lock(&trace_lock);
+	if (!pagecache_trace_on)
+		goto out;
+
+	if (trace_len) {
+		e = &trace_buf[trace_len - 1];
+		if (e->dev == dev && e->ino == inode->i_ino &&
+		    index >= e->index && index <= e->index + e->nr) {
+			if (index == e->index + e->nr)
+				e->nr++;
+			goto out;
+		}
+	}
+
+	if (trace_len == trace_max) {
+		pagecache_trace_on = 0;
+		printk(KERN_WARNING "pagecache_trace: buffer full after %lu "
+		       "extents, recording stopped\n", trace_len);
+		goto out;
+	}
+
+	e = &trace_buf[trace_len++];
+	e->dev = dev;
+	e->ino = inode->i_ino;
+	e->index = index;
+	e->nr = 1;
+out:
+	spin_unlock(&trace_lock);
+}
+
+static int extent_cmp(const void *a, const void *b)
+{
+	const struct pagecache_extent *l = a, *r = b;
+
+	if (l->dev != r->dev)
+		return l->dev < r->dev ? -1 : 1;
+	if (l->ino != r->ino)
+		return l->ino < r->ino ? -1 : 1;
+	if (l->index != r->index)
+		return l->index < r->index ? -1 : 1;
+	return 0;
+}
+
+/* sort the trace by file and offset, and merge what touches */
+static void trace_merge(void)
+{
+	struct pagecache_extent *prev, *e;
+	unsigned long i, n;
+
+	if (!trace_len)
+		return;
+
+	sort(trace_buf, trace_len, sizeof(*trace_buf), extent_cmp, NULL);
+
+	n = 1;
+	for (i = 1; i < trace_len; i++) {
+		prev = &trace_buf[n - 1];
+		e = &trace_buf[i];
+		if (e->dev == prev->dev && e->ino == prev->ino &&
+		    e->index <= prev->index + prev->nr) {
+			if (e->index + e->nr > prev->index + prev->nr)
+				prev->nr = e->index + e->nr - prev->index;
+			continue;
+		}
+		trace_buf[n++] = *e;
+	}
+	trace_len = n;
+}
+
+static int trace_start(void)
+{
+	struct pagecache_extent *buf;
+
+	mutex_lock(&trace_mutex);
+	if (pagecache_trace_on) {
+		mutex_unlock(&trace_mutex);
+		return 0;
+	}
+
+	if (!trace_size || trace_size > TRACE_SIZE_MAX) {
+		mutex_unlock(&trace_mutex);
+		return -EINVAL;
+	}
+
+	buf = vmalloc(trace_size * sizeof(*buf));
+	if (!buf) {
+		mutex_unlock(&trace_mutex);
+		return -ENOMEM;
+	}
+	vfree(trace_buf);
+
+	spin_lock(&trace_lock);
+	trace_buf = buf;
+	trace_len = 0;
+	trace_max = trace_size;
+	pagecache_trace_on = 1;
+	spin_unlock(&trace_lock);
+
+	mutex_unlock(&trace_mutex);
+	return 0;
+}
+
+static void trace_stop(void)
+{
+	mutex_lock(&trace_mutex);
+	spin_lock(&trace_lock);
+	pagecache_trace_on = 0;
+	spin_unlock(&trace_lock);
+	trace_merge();
+	mutex_unlock(&trace_mutex);
+}
+
+static int record_get(void *data, u64 *val)
+{
+	*val = pagecache_trace_on;
+	return 0;
+}
+
+static int record_set(void *data, u64 val)
+{
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (val)
+		return trace_start();
+	trace_stop();
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(record_fops, record_get, record_set, "%llu\n");
+
+static void *trace_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&trace_mutex);
+	if (pagecache_trace_on)
+		return ERR_PTR(-EBUSY);
+	/*
+	 * Recording may have stopped itself on a full buffer, in which
+	 * case it is merged here, merging again changes nothing.
+	 */
+	if (*pos == 0)
+		trace_merge();
+	if (*pos >= trace_len)
+		return NULL;
+	return &trace_buf[*pos];
+}
+
+static void *trace_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	if (++*pos >= trace_len)
+		return NULL;
+	return &trace_buf[*pos];
+}
+
+static void trace_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&trace_mutex);
+}
+
+static int trace_seq_show(struct seq_file *m, void *v)
+{
+	struct pagecache_extent *e = v;
+
+	seq_printf(m, "%u:%u %lu %lu %lu\n", MAJOR(e->dev), MINOR(e->dev),
+		   e->ino, (unsigned long)e->index, e->nr);
+	return 0;
+}
+
+static const struct seq_operations trace_seq_ops = {
+	.start	= trace_seq_start,
+	.next	= trace_seq_next,
+	.stop	= trace_seq_stop,
+	.show	= trace_seq_show,
+};
+
+static int trace_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &trace_seq_ops);
+}
+
+static const struct file_operations trace_fops = {
+	.owner		= THIS_MODULE,
+	.open		= trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init pagecache_trace_setup(char *str)
+{
+	unsigned long size;
+
+	trace_at_boot = 1;
+	if (*str == '=' && !strict_strtoul(str + 1, 0, &size) && size)
+		trace_size = min_t(unsigned long, size, TRACE_SIZE_MAX);
+	return 1;
+}
+__setup("pagecache_trace", pagecache_trace_setup);
+
+static int __init pagecache_trace_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("pagecache_trace", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("record", 0600, dir, NULL, &record_fops) ||
+	    !debugfs_create_file("trace", 0400, dir, NULL, &trace_fops) ||
+	    !debugfs_create_u32("size", 0600, dir, &trace_size)) {
+		debugfs_remove_recursive(dir);
+		return -ENOMEM;
+	}
+
+	/* before the root filesystem is mounted */
+	if (trace_at_boot && trace_start())
+		printk(KERN_ERR "pagecache_trace: no memory for %u extents\n",
+		       trace_size);
+	return 0;
+}
+fs_initcall(pagecache_trace_init);
@@ -18,6 +18,9 @@
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/readahead.h>
+
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -327,6 +330,12 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
  * for sequential patterns. Hence interleaved reads might be served as
  * sequential ones.
  *
+ * Small reads that each start the same distance past the start of the
+ * previous one (records of a fixed size, every n-th block of a file) are
+ * a stride: the chunk one stride further is read along with the requested
+ * one.  stride_start keeps the first page of the previous small read, as
+ * prev_pos only has its last.
+ *
  * There is a special-case: if the first page which the application tries to
  * read happens to be the first page of the file, it is assumed that a linear
  * read is about to happen and the window is immediately set to the initial size
@@ -399,10 +408,14 @@ ondemand_readahead(struct address_space *mapping,
 		   unsigned long req_size)
 {
 	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long actual;
+	pgoff_t stride;
+	int pattern;
 
 	/*
 	 * start of file
 	 */
+	pattern = RA_PATTERN_INITIAL;
 	if (!offset)
 		goto initial_readahead;
 
@@ -415,6 +428,7 @@ ondemand_readahead(struct address_space *mapping,
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
+		pattern = RA_PATTERN_SEQUENTIAL;
 		goto readit;
 	}
 
@@ -439,33 +453,63 @@ ondemand_readahead(struct address_space *mapping,
 		ra->size += req_size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
+		pattern = RA_PATTERN_MARKER;
 		goto readit;
 	}
 
 	/*
 	 * oversize read
 	 */
+	pattern = RA_PATTERN_OVERSIZE;
 	if (req_size > max)
 		goto initial_readahead;
 
 	/*
 	 * sequential cache miss
 	 */
-	if (offset - (ra->prev_pos >> PAGE_CACHE_SHIFT) <= 1UL)
+	stride = offset - (ra->prev_pos >> PAGE_CACHE_SHIFT);
+	pattern = RA_PATTERN_INITIAL;
+	if (stride <= 1UL)
 		goto initial_readahead;
 
 	/*
 	 * Query the page cache and look for the traces(cached history pages)
 	 * that a sequential stream would leave behind.
 	 */
-	if (try_context_readahead(mapping, ra, offset, req_size, max))
+	if (try_context_readahead(mapping, ra, offset, req_size, max)) {
+		pattern = RA_PATTERN_CONTEXT;
 		goto readit;
+	}
+
+	/*
+	 * small reads at a constant stride
+	 * Read the chunk one stride ahead as well.  Reading it later hits
+	 * the page cache and does not come here, so it stands for the
+	 * previous read when the next miss, one stride further, is measured.
+	 */
+	stride = offset - ra->stride_start;
+	ra->stride_start = offset;
+	if (stride == ra->stride && stride > req_size) {
+		ra->stride_start = offset + stride;
+		actual = __do_page_cache_readahead(mapping, filp, offset,
+						   req_size, 0);
+		actual += __do_page_cache_readahead(mapping, filp,
+						    offset + stride,
+						    req_size, 0);
+		trace_readahead(mapping, offset, req_size, offset + stride,
+				req_size, RA_PATTERN_STRIDE, actual);
+		return actual;
+	}
+	ra->stride = stride;
 
 	/*
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
-	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	actual = __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	trace_readahead(mapping, offset, req_size, offset, req_size,
+			RA_PATTERN_RANDOM, actual);
+	return actual;
 
 initial_readahead:
 	ra->start = offset;
@@ -483,7 +527,10 @@ readit:
 		ra->size += ra->async_size;
 	}
 
-	return ra_submit(ra, mapping, filp);
+	actual = ra_submit(ra, mapping, filp);
+	trace_readahead(mapping, offset, req_size, ra->start, ra->size,
+			pattern, actual);
+	return actual;
 }
 
 /**
@@ -16,9 +16,11 @@
 
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 
 #include <sound/soc.h>
 #include <sound/pcm_params.h>
+#include <sound/info.h>
 
 #include <asm/dma.h>
 #include <mach/hardware.h>
@@ -35,7 +37,8 @@ static const struct snd_pcm_hardware dma_hardware = {
 				    SNDRV_PCM_INFO_MMAP |
 				    SNDRV_PCM_INFO_MMAP_VALID |
 				    SNDRV_PCM_INFO_PAUSE |
-				    SNDRV_PCM_INFO_RESUME,
+				    SNDRV_PCM_INFO_RESUME |
+				    SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats		= SNDRV_PCM_FMTBIT_S16_LE |
 				    SNDRV_PCM_FMTBIT_U16_LE |
 				    SNDRV_PCM_FMTBIT_U8 |
@@ -43,25 +46,198 @@ static const struct snd_pcm_hardware dma_hardware = {
 	.channels_min		= 1,
 	.channels_max		= 2,
 	.buffer_bytes_max	= 128*1024,
-	.period_bytes_min	= PAGE_SIZE,
-	.period_bytes_max	= PAGE_SIZE*2,
+	.period_bytes_min	= 128,
+	.period_bytes_max	= 64*1024,
 	.periods_min		= 2,
-	.periods_max		= 128,
+	.periods_max		= 1024,
 	.fifo_size		= 32,
 };
 
+/*
+ * Periods smaller than this are grouped into one DMA transfer, so that
+ * small periods do not mean an interrupt every few hundred microseconds.
+ * The position is read back from the DMAC, so ALSA still sees every
+ * period go by; only the wakeups get coarser.
+ */
+static unsigned int dma_min_xfer = PAGE_SIZE;
+module_param(dma_min_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_min_xfer, "Minimum bytes per DMA interrupt "
+		 "(default: PAGE_SIZE)");
+
+/* per stream counters, reset on open and shown in /proc/asound */
+struct dma_stats {
+	unsigned long irqs;
+	unsigned long periods;
+	unsigned long xruns;
+	unsigned int max_irq_gap;	/* us */
+	snd_pcm_sframes_t min_headroom;	/* frames */
+	ktime_t last_irq;
+};
+
 struct runtime_data {
 	spinlock_t lock;
 	int state;
 	unsigned int dma_loaded;
 	unsigned int dma_limit;
 	unsigned int dma_period;
+	unsigned int dma_coalesce;
 	dma_addr_t dma_start;
 	dma_addr_t dma_pos;
 	dma_addr_t dma_end;
 	struct s3c_dma_params *params;
+	struct dma_stats stats;
+};
+
+static const struct samsung_dma_group dma_group = {
+	.var	= SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
+	.min	= &dma_min_xfer,
+	.scale	= 1,
 };
 
+/* dma_max_group
+ *
+ * the most periods one DMA transfer can cover. The transfers must tile
+ * the buffer and there must be at least two of them for the circular
+ * queue, so only divisors of the period count up to half of it are
+ * usable; a prime count allows no grouping at all.
+*/
+static unsigned int dma_max_group(unsigned int periods)
+{
+	unsigned int n;
+
+	for (n = periods / 2; n > 1; n--)
+		if (periods % n == 0)
+			break;
+
+	return n ? n : 1;
+}
+
+/* samsung_dma_coalesce
+ *
+ * work out how many periods go into each DMA transfer: the fewest that
+ * add up to the minimum of @group, which the hw_params rules added by
+ * samsung_dma_constrain_group() guarantee.
+*/
+unsigned int samsung_dma_coalesce(struct snd_pcm_hw_params *params,
+				  const struct samsung_dma_group *group)
+{
+	unsigned int periods = params_periods(params);
+	unsigned int period, want, n;
+
+	/* nobody waits for periods, so interrupt as rarely as possible */
+	if (params->flags & SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP)
+		return dma_max_group(periods);
+
+	if (group->var == SNDRV_PCM_HW_PARAM_PERIOD_TIME)
+		period = div_u64((u64)params_period_size(params) * USEC_PER_SEC,
+				 params_rate(params));
+	else
+		period = params_period_bytes(params);
+
+	want = DIV_ROUND_UP(*group->min * group->scale, period ? : 1);
+
+	for (n = max(want, 1U); n <= periods / 2; n++)
+		if (periods % n == 0)
+			return n;
+
+	return dma_max_group(periods);
+}
+EXPORT_SYMBOL_GPL(samsung_dma_coalesce);
+
+/*
+ * Periods below the minimum are only allowed in counts that can be
+ * grouped into transfers of at least the minimum, otherwise every small
+ * period would be an interrupt again. Once the period count is known,
+ * it bounds the period size from below...
+ */
+static int dma_rule_period(struct snd_pcm_hw_params *params,
+			   struct snd_pcm_hw_rule *rule)
+{
+	const struct samsung_dma_group *group = rule->private;
+	struct snd_interval *periods =
+		hw_param_interval(params, SNDRV_PCM_HW_PARAM_PERIODS);
+	struct snd_interval t;
+
+	if (!snd_interval_single(periods))
+		return 0;
+
+	snd_interval_any(&t);
+	t.min = DIV_ROUND_UP(*group->min * group->scale,
+			     dma_max_group(periods->min));
+	t.integer = 1;
+
+	return snd_interval_refine(hw_param_interval(params, rule->var), &t);
+}
+
+/* ...and once the period size is known, the period count is bounded. */
+static int dma_rule_periods(struct snd_pcm_hw_params *params,
+			    struct snd_pcm_hw_rule *rule)
+{
+	const struct samsung_dma_group *group = rule->private;
+	struct snd_interval *period = hw_param_interval(params, group->var);
+	unsigned int min = *group->min * group->scale;
+	struct snd_interval t;
+
+	if (!snd_interval_single(period) || period->min >= min)
+		return 0;
+
+	/* 2n periods can always be grouped n at a time */
+	snd_interval_any(&t);
+	t.min = 2 * DIV_ROUND_UP(min, period->min);
+	t.integer = 1;
+
+	return snd_interval_refine(hw_param_interval(params, rule->var), &t);
+}
+
+int samsung_dma_constrain_group(struct snd_pcm_runtime *runtime,
+				const struct samsung_dma_group *group)
+{
+	int ret;
+
+	ret = snd_pcm_hw_constraint_integer(runtime,
+					    SNDRV_PCM_HW_PARAM_PERIODS);
+	if (ret < 0)
+		return ret;
+
+	ret = snd_pcm_hw_rule_add(runtime, 0, group->var,
+				  dma_rule_period, (void *)group,
+				  SNDRV_PCM_HW_PARAM_PERIODS, -1);
+	if (ret < 0)
+		return ret;
+
+	return snd_pcm_hw_rule_add(runtime, 0, SNDRV_PCM_HW_PARAM_PERIODS,
+				   dma_rule_periods, (void *)group,
+				   group->var, -1);
+}
+EXPORT_SYMBOL_GPL(samsung_dma_constrain_group);
+
+static void dma_update_stats(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct runtime_data *prtd = runtime->private_data;
+	struct dma_stats *st = &prtd->stats;
+	snd_pcm_sframes_t headroom;
+	ktime_t now = ktime_get();
+	s64 gap;
+
+	if (st->last_irq.tv64) {
+		gap = ktime_us_delta(now, st->last_irq);
+		if (gap > st->max_irq_gap)
+			st->max_irq_gap = gap;
+	}
+	st->last_irq = now;
+	st->irqs++;
+	st->periods += prtd->dma_coalesce;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		headroom = snd_pcm_playback_hw_avail(runtime);
+	else
+		headroom = snd_pcm_capture_hw_avail(runtime);
+
+	if (headroom < st->min_headroom)
+		st->min_headroom = headroom;
+}
+
 /* dma_enqueue
  *
  * place a dma buffer onto the queue for the dma system
@@ -127,6 +303,7 @@ static void audio_buffdone(struct s3c2410_dma_chan *channel,
 		snd_pcm_period_elapsed(substream);
 
 	spin_lock(&prtd->lock);
+	dma_update_stats(substream);
 	if (prtd->state & ST_RUNNING && !s3c_dma_has_circular()) {
 		prtd->dma_loaded--;
 		dma_enqueue(substream);
@@ -187,7 +364,8 @@ static int dma_hw_params(struct snd_pcm_substream *substream,
 	spin_lock_irq(&prtd->lock);
 	prtd->dma_loaded = 0;
 	prtd->dma_limit = runtime->hw.periods_min;
-	prtd->dma_period = params_period_bytes(params);
+	prtd->dma_coalesce = samsung_dma_coalesce(params, &dma_group);
+	prtd->dma_period = params_period_bytes(params) * prtd->dma_coalesce;
 	prtd->dma_start = runtime->dma_addr;
 	prtd->dma_pos = prtd->dma_start;
 	prtd->dma_end = prtd->dma_start + totbytes;
@@ -225,6 +403,11 @@ static int dma_prepare(struct snd_pcm_substream *substream)
 	if (!prtd->params)
 		return 0;
 
+	/* recovering from an underrun or overrun */
+	if (substream->runtime->status->state == SNDRV_PCM_STATE_XRUN)
+		prtd->stats.xruns++;
+	prtd->stats.last_irq = ktime_set(0, 0);
+
 	/* channel needs configuring for mem=>device, increment memory addr,
 	 * sync to pclk, half-word transfers to the IIS-FIFO. */
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
@@ -307,16 +490,12 @@ dma_pointer(struct snd_pcm_substream *substream)
 
 	pr_debug("Pointer %x %x\n", src, dst);
 
-	/* we seem to be getting the odd error from the pcm library due
-	 * to out-of-bounds pointers. this is maybe due to the dma engine
-	 * not having loaded the new values for the channel before being
-	 * called... (todo - fix )
+	/* the channel still holds the addresses of its previous transfer
+	 * until the first one of this stream is loaded, which shows up as
+	 * a position outside the buffer; report the start of it instead.
 	 */
-
-	if (res >= snd_pcm_lib_buffer_bytes(substream)) {
-		if (res == snd_pcm_lib_buffer_bytes(substream))
-			res = 0;
-	}
+	if (res >= snd_pcm_lib_buffer_bytes(substream))
+		res = 0;
 
 	return bytes_to_frames(substream->runtime, res);
 }
@@ -328,7 +507,7 @@ static int dma_open(struct snd_pcm_substream *substream)
 
 	pr_debug("Entered %s\n", __func__);
 
-	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+	samsung_dma_constrain_group(runtime, &dma_group);
 	snd_soc_set_runtime_hwparams(substream, &dma_hardware);
 
 	prtd = kzalloc(sizeof(struct runtime_data), GFP_KERNEL);
@@ -336,6 +515,7 @@ static int dma_open(struct snd_pcm_substream *substream)
 		return -ENOMEM;
 
 	spin_lock_init(&prtd->lock);
+	prtd->stats.min_headroom = LONG_MAX;
 
 	runtime->private_data = prtd;
 	return 0;
@@ -426,6 +606,56 @@ static void dma_free_dma_buffers(struct snd_pcm *pcm)
 	}
 }
 
+static void dma_proc_read(struct snd_info_entry *entry,
+			  struct snd_info_buffer *buffer)
+{
+	struct snd_pcm_substream *substream = entry->private_data;
+	struct snd_pcm_runtime *runtime;
+	struct runtime_data *prtd;
+	struct dma_stats st;
+
+	mutex_lock(&substream->pcm->open_mutex);
+	runtime = substream->runtime;
+	if (!runtime || !runtime->private_data) {
+		snd_iprintf(buffer, "closed\n");
+		goto out;
+	}
+
+	prtd = runtime->private_data;
+	spin_lock_irq(&prtd->lock);
+	st = prtd->stats;
+	spin_unlock_irq(&prtd->lock);
+
+	snd_iprintf(buffer, "periods_per_irq: %u\n", prtd->dma_coalesce);
+	snd_iprintf(buffer, "irqs: %lu\n", st.irqs);
+	snd_iprintf(buffer, "periods: %lu\n", st.periods);
+	snd_iprintf(buffer, "xruns: %lu\n", st.xruns);
+	snd_iprintf(buffer, "max_irq_gap_us: %u\n", st.max_irq_gap);
+	if (st.irqs && runtime->rate)
+		snd_iprintf(buffer, "min_headroom_us: %llu\n",
+			    div_u64((u64)st.min_headroom * USEC_PER_SEC,
+				    runtime->rate));
+out:
+	mutex_unlock(&substream->pcm->open_mutex);
+}
+
+static void dma_proc_init(struct snd_card *card, struct snd_pcm *pcm,
+			  int stream)
+{
+	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
+	struct snd_info_entry *entry;
+	char name[16];
+
+	if (!substream)
+		return;
+
+	snprintf(name, sizeof(name), "pcm%d%c-dma", pcm->device,
+		 stream == SNDRV_PCM_STREAM_PLAYBACK ? 'p' : 'c');
+
+	if (!snd_card_proc_new(card, name, &entry))
+		snd_info_set_text_ops(entry, substream, dma_proc_read);
+}
+
 static u64 dma_mask = DMA_BIT_MASK(32);
 
 static int dma_new(struct snd_card *card,
@@ -454,6 +684,11 @@ static int dma_new(struct snd_card *card,
 		if (ret)
 			goto out;
 	}
+
+#ifndef CONFIG_S5P_INTERNAL_DMA
+	dma_proc_init(card, pcm, SNDRV_PCM_STREAM_PLAYBACK);
+#endif
+	dma_proc_init(card, pcm, SNDRV_PCM_STREAM_CAPTURE);
 out:
 	return ret;
 }
@@ -19,7 +19,21 @@ struct s3c_dma_params {
 	int dma_size;			/* Size of the DMA transfer */
 };
 
+/*
+ * Periods are grouped into DMA transfers of at least *min * scale, in the
+ * units of var: SNDRV_PCM_HW_PARAM_PERIOD_BYTES or _PERIOD_TIME (us).
+ */
+struct samsung_dma_group {
+	snd_pcm_hw_param_t var;
+	unsigned int *min;
+	unsigned int scale;
+};
 
 extern struct snd_soc_platform_driver samsung_asoc_platform;
 
+unsigned int samsung_dma_coalesce(struct snd_pcm_hw_params *params,
+				  const struct samsung_dma_group *group);
+int samsung_dma_constrain_group(struct snd_pcm_runtime *runtime,
+				const struct samsung_dma_group *group);
+
 #endif
@@ -17,12 +17,15 @@
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
 #include <sound/soc.h>
+#include <sound/info.h>
 
 #include <plat/regs-iis.h>
 
-#include "s3c-dma.h"
+#include "dma.h"
 #include "s3c-idma.h"
 
+#define ST_RUNNING		(1<<0)
+
 /** Debug **/
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -71,7 +74,8 @@ static const struct snd_pcm_hardware s3c_idma_hardware = {
 		    SNDRV_PCM_INFO_MMAP |
 		    SNDRV_PCM_INFO_MMAP_VALID |
 		    SNDRV_PCM_INFO_PAUSE |
-		    SNDRV_PCM_INFO_RESUME,
+		    SNDRV_PCM_INFO_RESUME |
+		    SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats = SNDRV_PCM_FMTBIT_S16_LE |
 		    SNDRV_PCM_FMTBIT_U16_LE |
 		    SNDRV_PCM_FMTBIT_S24_LE |
@@ -82,8 +86,7 @@ static const struct snd_pcm_hardware s3c_idma_hardware = {
 	.channels_max = 2,
 	.buffer_bytes_max = MAX_LP_BUFF,
 	.period_bytes_min = 128,
-	//.period_bytes_max = 16 * 1024,
-	.period_bytes_max = 32 * 1024,
+	.period_bytes_max = MAX_LP_BUFF / 2,
 	.periods_min = 2,
 	.periods_max = 128,
 	.fifo_size = 64,
@@ -99,6 +102,25 @@ struct lpam_i2s_pdata {
 
 };
 
+/*
+ * The level interrupt is raised at most every idma_irq_ms of audio, whole
+ * periods at a time, so that deep buffer playback lets the CPU stay in
+ * didle between refills. With no period wakeups it fires twice per ring.
+ */
+static unsigned int idma_irq_ms;
+module_param(idma_irq_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(idma_irq_ms, "Minimum time between IDMA interrupts in ms "
+		 "(default: 0, every period)");
+
+static const struct samsung_dma_group idma_group = {
+	.var	= SNDRV_PCM_HW_PARAM_PERIOD_TIME,
+	.min	= &idma_irq_ms,
+	.scale	= USEC_PER_MSEC,
+};
+
+/* didle is skipped when the level interrupt is due in less than this */
+#define IDMA_DIDLE_GUARD_US	2000
+
 	/********************
 	 * Internal DMA i/f *
 	 ********************/
@@ -106,9 +128,12 @@ static struct s3c_idma_info {
 	void __iomem  *regs;
 	unsigned int   dma_prd;
 	unsigned int   dma_end;
+	unsigned int   guard;
 	spinlock_t    lock;
 	void          *token;
 	void (*cb)(void *dt, int bytes_xfer);
+	unsigned long  irqs;
+	unsigned long  underruns;
 } s3c_idma;
 
 
@@ -118,14 +143,26 @@ static void s3c_idma_getpos(dma_addr_t *src)
 		(readl(s3c_idma.regs + S5P_IISTRNCNT) & 0xffffff) * 4;
 }
 
-void i2sdma_getpos(dma_addr_t *src)
+/*
+ * Called by cpuidle with interrupts off. Returns non-zero if didle must be
+ * skipped: the IDMA is stopped, or its next level interrupt would arrive
+ * while the SoC is still on its way into didle.
+ */
+int s5p_idma_didle_check(void)
 {
-	if (/*clk_enabled == 0 &&*/i2s_trigger_stop == 0)
-		*src = LP_TXBUFF_ADDR +
-			(readl(s3c_idma.regs + S5P_IISTRNCNT) & 0xffffff) * 4;
-	else
-		*src = LP_TXBUFF_ADDR;
+	u32 cur, next, ring;
 
+	if (i2s_trigger_stop || !s3c_idma.dma_end)
+		return 1;
+
+	cur = (readl(s3c_idma.regs + S5P_IISTRNCNT) & 0xffffff) * 4;
+	next = readl(s3c_idma.regs + S5P_IISADDR0) - LP_TXBUFF_ADDR;
+	ring = s3c_idma.dma_end - LP_TXBUFF_ADDR;
+
+	if (next <= cur)
+		next += ring;
+
+	return next - cur < s3c_idma.guard;
 }
 
 static int s3c_idma_enqueue(void *token)
@@ -215,6 +252,7 @@ static int s3c_idma_hw_params(struct snd_pcm_substream *substream,
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct lpam_i2s_pdata *prtd = substream->runtime->private_data;
 	unsigned long idma_totbytes;
+	unsigned int prd;
 
 	pr_debug("Entered %s\n", __func__);
 
@@ -228,7 +266,11 @@ static int s3c_idma_hw_params(struct snd_pcm_substream *substream,
 
 	runtime->dma_bytes = idma_totbytes;
 
-	s3c_idma_setcallbk(s3c_idma_done, params_period_bytes(params));
+	prd = params_period_bytes(params) * samsung_dma_coalesce(params, &idma_group);
+	s3c_idma_setcallbk(s3c_idma_done, prd);
+
+	s3c_idma.guard = params_rate(params) * IDMA_DIDLE_GUARD_US / 1000 *
+		(params_period_bytes(params) / params_period_size(params)) / 1000;
 
 	prtd->start = runtime->dma_addr;
 	prtd->pos = prtd->start;
@@ -357,6 +399,7 @@ static irqreturn_t s3c_iis_irq(int irqno, void *dev_id)
 		writel(iiscon | (1<<26), s3c_idma.regs+S3C2412_IISCON);
 	}
 	if (iiscon & S5P_IISCON_FTXSURSTAT) {
+		s3c_idma.underruns++;
 		iiscon |= S5P_IISCON_FTXURSTATUS;
 		writel(iiscon, s3c_idma.regs + S3C2412_IISCON);
 		pr_debug("TX_S underrun interrupt IISCON = 0x%08x\n",
@@ -364,6 +407,7 @@ static irqreturn_t s3c_iis_irq(int irqno, void *dev_id)
 	}
 
 	if (iiscon & S5P_IISCON_FTXURSTATUS) {
+		s3c_idma.underruns++;
 		iiscon &= ~S5P_IISCON_FTXURINTEN;
 		iiscon |= S5P_IISCON_FTXURSTATUS;
 		writel(iiscon, s3c_idma.regs + S3C2412_IISCON);
@@ -378,6 +422,7 @@ static irqreturn_t s3c_iis_irq(int irqno, void *dev_id)
 		val = 0;
 
 	if (val) {
+		s3c_idma.irqs++;
 		iisahb |= val;
 		writel(iisahb, s3c_idma.regs + S5P_IISAHB);
 
@@ -408,6 +453,7 @@ static int s3c_idma_open(struct snd_pcm_substream *substream)
 
 	pr_debug("Entered %s\n", __func__);
 
+	samsung_dma_constrain_group(runtime, &idma_group);
 	snd_soc_set_runtime_hwparams(substream, &s3c_idma_hardware);
 
 	prtd = kzalloc(sizeof(struct lpam_i2s_pdata), GFP_KERNEL);
@@ -478,6 +524,15 @@ static void s3c_idma_pcm_free(struct snd_pcm *pcm)
 	buf->addr = 0;
 }
 
+static void s3c_idma_proc_read(struct snd_info_entry *entry,
+			       struct snd_info_buffer *buffer)
+{
+	snd_iprintf(buffer, "irq_bytes: %u\n", s3c_idma.dma_prd);
+	snd_iprintf(buffer, "didle_guard_bytes: %u\n", s3c_idma.guard);
+	snd_iprintf(buffer, "irqs: %lu\n", s3c_idma.irqs);
+	snd_iprintf(buffer, "underruns: %lu\n", s3c_idma.underruns);
+}
+
 static int s3c_idma_preallocate_buffer(struct snd_pcm *pcm, int stream)
 {
 	struct snd_pcm_substream *substream = pcm->streams[stream].substream;
@@ -503,6 +558,7 @@ static u64 s3c_idma_mask = DMA_BIT_MASK(32);
 static int s3c_idma_pcm_new(struct snd_card *card,
 	struct snd_soc_dai *dai, struct snd_pcm *pcm)
 {
+	struct snd_info_entry *entry;
 	int ret = 0;
 
 	pr_debug("Entered %s\n", __func__);
@@ -516,6 +572,9 @@ static int s3c_idma_pcm_new(struct snd_card *card,
 		ret = s3c_idma_preallocate_buffer(pcm,
 				SNDRV_PCM_STREAM_PLAYBACK);
 
+	if (!ret && !snd_card_proc_new(card, "idma", &entry))
+		snd_info_set_text_ops(entry, NULL, s3c_idma_proc_read);
+
 	return ret;
 }
 
@@ -33,6 +33,7 @@ extern struct snd_soc_platform_driver idma_soc_platform;
 extern int i2s_trigger_stop;
 extern bool clk_enabled ;
 void s5p_idma_init(void *regs);
+int s5p_idma_didle_check(void);
 
 //#define pr_debug(fmt...) printk(fmt)
 #endif /* __S3C_IDMA_H_ */
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# randwrite-bench.sh -- random overwrites on nilfs2 and ext4, on loop devices
+#
+# For each filesystem, a fresh volume is made on a loop device, a file
+# filling part of it is written, and randwrite then overwrites random
+# blocks of that file.  Reported for each run are the rate randwrite
+# achieved and the write amplification: the bytes the loop device was
+# asked to write, cleaner and journal included, per byte randwrite
+# wrote.  On flash, the latter is what wears the card and what its
+# translation layer has to absorb.
+#
+# Needs root, losetup, mkfs.ext4 and nilfs-utils (mkfs.nilfs2 and the
+# cleaner, started by mount.nilfs2).  Build randwrite first:
+#
+#   cc -Wall -O2 -o randwrite randwrite.c -lrt
+#
+# Settings, from the environment:
+#
+#   DIR		where the volume images are created	(/tmp)
+#   SIZE_MB	size of each volume			(1024)
+#   FILL_MB	size of the file overwritten		(512)
+#   BS		bytes per write				(4096)
+#   WRITES	number of writes			(65536)
+#   SYNC	writes per fsync			(1)
+#   SEGBLKS	blocks per nilfs2 segment, ideally the erase unit (2048)
+#   NILFS_OPTS	mount options of the plain nilfs2 run	(pp=0)
+#
+# pp=0 lets the cleaner reclaim segments as soon as they are written;
+# with its default protection period of an hour, a short run would fill
+# the volume before anything could be cleaned.
+
+set -e
+
+DIR=${DIR:-/tmp}
+SIZE_MB=${SIZE_MB:-1024}
+FILL_MB=${FILL_MB:-512}
+BS=${BS:-4096}
+WRITES=${WRITES:-65536}
+SYNC=${SYNC:-1}
+SEGBLKS=${SEGBLKS:-2048}
+NILFS_OPTS=${NILFS_OPTS:-pp=0}
+
+RANDWRITE=$(dirname "$0")/randwrite
+IMG=$DIR/randwrite-bench.img
+MNT=$DIR/randwrite-bench.mnt
+
+if [ ! -x "$RANDWRITE" ]; then
+	echo "build $RANDWRITE first" >&2
+	exit 1
+fi
+
+# sectors written to a block device so far
+written()
+{
+	awk '{ print $7 }' /sys/block/$(basename "$1")/stat
+}
+
+# run <name> <mkfs command> <mount type> <mount options>
+run()
+{
+	name=$1
+	mkfs=$2
+	type=$3
+	opts=$4
+
+	rm -f "$IMG"
+	dd if=/dev/zero of="$IMG" bs=1M count=0 seek="$SIZE_MB" 2>/dev/null
+	dev=$(losetup -f --show "$IMG")
+	mkdir -p "$MNT"
+
+	$mkfs "$dev" >/dev/null 2>&1
+	mount -t "$type" -o "$opts" "$dev" "$MNT"
+
+	dd if=/dev/zero of="$MNT/file" bs=1M count="$FILL_MB" conv=fsync \
+		2>/dev/null
+	sync
+
+	before=$(written "$dev")
+	result=$("$RANDWRITE" -b "$BS" -n "$WRITES" -s "$SYNC" "$MNT/file")
+	sync
+	after=$(written "$dev")
+
+	umount "$MNT"
+	losetup -d "$dev"
+	rm -f "$IMG"
+
+	echo "$name: $result"
+	echo "$name: write amplification" \
+		$(awk "BEGIN { printf \"%.2f\", \
+			($after - $before) * 512 / ($BS * $WRITES) }")
+}
+
+run ext4 "mkfs.ext4 -q" ext4 "discard"
+run nilfs2 "mkfs.nilfs2 -q -f -B $SEGBLKS" nilfs2 "discard,$NILFS_OPTS"
+run nilfs2-coldseg "mkfs.nilfs2 -q -f -B $SEGBLKS" nilfs2 \
+	"discard,coldseg,$NILFS_OPTS"
@@ -0,0 +1,125 @@
+/*
+ * randwrite.c -- random overwrites of a file, for comparing filesystems
+ *
+ * Overwrites randomly chosen, aligned blocks of an existing file and
+ * syncs every few writes, the pattern of a database or an application
+ * updating its records in place.  Prints the rate it achieved; the
+ * writes reaching the device are counted by randwrite-bench.sh.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* $(CROSS_COMPILE)cc -Wall -O2 -o randwrite randwrite.c -lrt */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-b block size] [-n writes] [-s writes per sync] "
+		"[-r seed] file\n"
+		"  -b  bytes per write, default 4096\n"
+		"  -n  number of writes, default 65536\n"
+		"  -s  fsync() after this many writes, 0 for never, default 1\n"
+		"  -r  seed of the random offsets, default 1\n",
+		prog);
+	exit(2);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long bs = 4096, count = 65536, sync_every = 1, seed = 1;
+	unsigned long long blocks, i;
+	struct stat st;
+	double start, secs;
+	char *buf;
+	int fd, c;
+
+	while ((c = getopt(argc, argv, "b:n:s:r:")) != -1) {
+		switch (c) {
+		case 'b':
+			bs = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sync_every = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || !bs)
+		usage(argv[0]);
+
+	fd = open(argv[optind], O_RDWR);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	blocks = st.st_size / bs;
+	if (!blocks) {
+		fprintf(stderr, "%s: smaller than one block\n", argv[optind]);
+		return 1;
+	}
+
+	buf = malloc(bs);
+	if (!buf) {
+		perror("malloc");
+		return 1;
+	}
+
+	srandom(seed);
+	start = now();
+
+	for (i = 0; i < count; i++) {
+		unsigned long long blk;
+
+		blk = ((unsigned long long)random() << 31 | random()) % blocks;
+		memset(buf, (int)i, bs);
+
+		if (pwrite(fd, buf, bs, blk * bs) != (ssize_t)bs) {
+			perror("pwrite");
+			return 1;
+		}
+		if (sync_every && (i + 1) % sync_every == 0 && fsync(fd) < 0) {
+			perror("fsync");
+			return 1;
+		}
+	}
+	if (fsync(fd) < 0) {
+		perror("fsync");
+		return 1;
+	}
+
+	secs = now() - start;
+	printf("%lu writes of %lu bytes in %.2f s: %.0f writes/s, %.2f MB/s\n",
+	       count, bs, secs, count / secs, count * bs / secs / 1e6);
+
+	close(fd);
+	free(buf);
+	return 0;
+}